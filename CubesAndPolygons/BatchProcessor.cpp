@@ -0,0 +1,197 @@
+#include "BatchProcessor.h"
+#include "SceneFile.h"
+#include "SceneImporter.h"
+#include "TriangulationVisitor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <thread>
+
+// entities streamed from a scene file per batch
+const size_t BATCH_CHUNK_SIZE = 10000;
+
+size_t BatchProcessor::Run(const std::vector<std::string>& paths, int width, int height, unsigned threadsCount)
+{
+    if (threadsCount == 0)
+        threadsCount = std::max(1u, std::thread::hardware_concurrency());
+    threadsCount = static_cast<unsigned>(std::min<size_t>(threadsCount, paths.size()));
+
+    auto startTime = std::chrono::steady_clock::now();
+    size_t polygonCounters[TriangulationVisitor::PolygonClassesCount];
+    TriangulationVisitor::TakePolygonCounters(polygonCounters);
+
+    // files are taken one by one, so a few large ones do not leave other threads idle
+    std::vector<Result> results(paths.size());
+    std::atomic<size_t> nextPath { 0 };
+    auto work = [&]() {
+        for (size_t i = nextPath++; i < paths.size(); i = nextPath++)
+            results[i] = Process(paths[i], width, height);
+    };
+    std::vector<std::thread> threads;
+    for (unsigned t = 1; t < threadsCount; ++t)
+        threads.emplace_back(work);
+    work();
+    for (std::thread& thread : threads)
+        thread.join();
+
+    size_t failed = 0;
+    size_t trianglesCount = 0;
+    for (const Result& result : results) {
+        if (!result.loaded || result.invalidTriangles > 0)
+            ++failed;
+        trianglesCount += result.trianglesCount;
+
+        std::cout << result.path << ": ";
+        if (!result.loaded) {
+            std::cout << "failed to load" << std::endl;
+            continue;
+        }
+        std::cout << result.entitiesCount << " entities, " << result.trianglesCount << " triangles ("
+            << result.invalidTriangles << " invalid, " << result.degenerateTriangles << " degenerate), "
+            << result.visibleEntities << " entities visible, " << result.coveredPixels << " pixels covered, "
+            << result.milliseconds << " ms" << std::endl;
+    }
+
+    double seconds = std::max(std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count(), 1e-9);
+    std::cout << "Processed " << paths.size() << " files (" << failed << " failed) in " << seconds * 1000.0 << " ms: "
+        << paths.size() / seconds << " files/s, " << trianglesCount / seconds << " triangles/s, "
+        << threadsCount << " threads" << std::endl;
+    TriangulationVisitor::TakePolygonCounters(polygonCounters);
+    std::cout << "Polygons triangulated: " << polygonCounters[TriangulationVisitor::PolygonConvex] << " convex, "
+        << polygonCounters[TriangulationVisitor::PolygonMonotone] << " monotone, "
+        << polygonCounters[TriangulationVisitor::PolygonGeneral] << " general" << std::endl;
+
+    return failed;
+}
+
+BatchProcessor::Result BatchProcessor::Process(const std::string& path, int width, int height)
+{
+    auto startTime = std::chrono::steady_clock::now();
+
+    Result result;
+    result.path = path;
+
+    // the files are processed in parallel already
+    Scene scene;
+    scene.SetTriangulationThreads(1);
+    if (path.size() > 4 && path.compare(path.size() - 4, 4, ".cps") == 0) {
+        SceneFileReader reader(path);
+        if (!reader.IsValid())
+            return result;
+        while (!reader.IsFinished())
+            reader.ReadChunk(scene, BATCH_CHUNK_SIZE);
+    }
+    else if (SceneImporter::Import(scene, path, 1) == 0) {
+        return result;
+    }
+    scene.CommitPendingEntities();
+    result.loaded = true;
+    result.entitiesCount = scene.GetEntities().size();
+
+    const GLfloat* buffer = scene.GetBufferAsArray();
+    size_t floatsCount = scene.GetBufferAllocationSize() / sizeof(GLfloat);
+    result.trianglesCount = floatsCount / (3 * 3);
+    for (size_t i = 0; i < floatsCount; i += 3 * 3) {
+        const GLfloat* v = buffer + i;
+        if (!std::all_of(v, v + 3 * 3, [](GLfloat value) { return std::isfinite(value); })) {
+            ++result.invalidTriangles;
+            continue;
+        }
+        glm::vec3 a(v[0], v[1], v[2]), b(v[3], v[4], v[5]), c(v[6], v[7], v[8]);
+        if (glm::cross(b - a, c - a) == glm::vec3(0.0))
+            ++result.degenerateTriangles;
+    }
+
+    std::vector<GLuint> indices;
+    Rasterize(scene, width, height, indices, result);
+
+    result.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    return result;
+}
+
+void BatchProcessor::Rasterize(const Scene& scene, int width, int height, std::vector<GLuint>& indices, Result& result)
+{
+    // same as the window in submission order: clip space without projection, the last entity drawn wins,
+    // the buffer holds entity index + 1 like the stencil used for picking.
+    // Entities go in reverse order and only empty pixels are written, so covered tiles are skipped.
+    indices.assign(size_t(width) * height, 0);
+    const int TileSize = 8;
+    int tilesWidth = (width + TileSize - 1) / TileSize;
+    int tilesHeight = (height + TileSize - 1) / TileSize;
+    std::vector<int> tileEmpty(size_t(tilesWidth) * tilesHeight);
+    for (int ty = 0; ty < tilesHeight; ++ty) {
+        for (int tx = 0; tx < tilesWidth; ++tx)
+            tileEmpty[ty * tilesWidth + tx] = (std::min(width, (tx + 1) * TileSize) - tx * TileSize) * (std::min(height, (ty + 1) * TileSize) - ty * TileSize);
+    }
+    size_t emptyPixels = indices.size();
+    // the published view, like any reader that does not own the scene
+    std::shared_ptr<const SceneView> view = scene.GetView();
+    const GLfloat* buffer = scene.GetBufferAsArray();
+
+    for (size_t e = view->entitiesCount; e-- > 0 && emptyPixels > 0;) {
+        const glm::mat4& transform = view->GetTransform(e);
+        const GLfloat* vertices = buffer + view->GetFirstVertex(e) * 3;
+        for (GLsizei t = 0; t < view->GetEntity(e)->GetTrianglesCount(); ++t) {
+            glm::vec2 p[3];
+            for (int k = 0; k < 3; ++k) {
+                const GLfloat* v = vertices + (t * 3 + k) * 3;
+                glm::vec4 position = transform * glm::vec4(v[0], v[1], v[2], 1.0f);
+                p[k] = glm::vec2((position.x + 1.0f) * 0.5f * width, (position.y + 1.0f) * 0.5f * height);
+            }
+
+            float area = (p[1].x - p[0].x) * (p[2].y - p[0].y) - (p[1].y - p[0].y) * (p[2].x - p[0].x);
+            if (!(area != 0.0f))
+                continue;
+
+            // pixel centers inside the triangle, both windings
+            glm::vec2 frameMax = glm::vec2(width, height);
+            glm::vec2 minPoint = glm::clamp(glm::min(p[0], glm::min(p[1], p[2])), glm::vec2(0.0f), frameMax);
+            glm::vec2 maxPoint = glm::clamp(glm::max(p[0], glm::max(p[1], p[2])), glm::vec2(0.0f), frameMax);
+            int x0 = std::max(0, int(std::ceil(minPoint.x - 0.5f)));
+            int y0 = std::max(0, int(std::ceil(minPoint.y - 0.5f)));
+            int x1 = std::min(width - 1, int(std::floor(maxPoint.x - 0.5f)));
+            int y1 = std::min(height - 1, int(std::floor(maxPoint.y - 0.5f)));
+            float sign = area > 0.0f ? 1.0f : -1.0f;
+            for (int ty = y0 / TileSize; ty <= y1 / TileSize; ++ty) {
+                for (int tx = x0 / TileSize; tx <= x1 / TileSize; ++tx) {
+                    int& empty = tileEmpty[ty * tilesWidth + tx];
+                    if (empty == 0)
+                        continue;
+
+                    for (int y = std::max(y0, ty * TileSize); y <= std::min(y1, ty * TileSize + TileSize - 1); ++y) {
+                        GLuint* row = &indices[size_t(y) * width];
+                        for (int x = std::max(x0, tx * TileSize); x <= std::min(x1, tx * TileSize + TileSize - 1); ++x) {
+                            if (row[x] != 0)
+                                continue;
+
+                            glm::vec2 center(x + 0.5f, y + 0.5f);
+                            bool inside = true;
+                            for (int k = 0; k < 3 && inside; ++k) {
+                                glm::vec2 a = p[k], b = p[(k + 1) % 3];
+                                float edge = (b.x - a.x) * (center.y - a.y) - (b.y - a.y) * (center.x - a.x);
+                                inside = edge * sign >= 0.0f;
+                            }
+                            if (inside) {
+                                row[x] = static_cast<GLuint>(e + 1);
+                                --empty;
+                                --emptyPixels;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    std::vector<bool> visible(view->entitiesCount + 1, false);
+    for (GLuint index : indices) {
+        if (index != 0) {
+            ++result.coveredPixels;
+            visible[index] = true;
+        }
+    }
+    result.visibleEntities = std::count(visible.begin(), visible.end(), true);
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include "Scene.h"
+
+#include <string>
+#include <vector>
+
+// Processes scene files without a window: every file is loaded into its own Scene, triangulated,
+// validated and rasterized on the CPU into an entity index buffer, files are spread over worker threads
+class BatchProcessor
+{
+public:
+    struct Result
+    {
+        std::string path;
+        bool loaded = false;
+        size_t entitiesCount = 0;
+        size_t trianglesCount = 0;
+        // triangles with non-finite coordinates
+        size_t invalidTriangles = 0;
+        // triangles with zero area
+        size_t degenerateTriangles = 0;
+        // entities owning at least one pixel of the rasterized frame
+        size_t visibleEntities = 0;
+        size_t coveredPixels = 0;
+        double milliseconds = 0.0;
+    };
+
+    // threadsCount == 0 means one thread per hardware core, returns the number of files that failed
+    static size_t Run(const std::vector<std::string>& paths, int width, int height, unsigned threadsCount = 0);
+    static Result Process(const std::string& path, int width, int height);
+
+private:
+    static void Rasterize(const Scene& scene, int width, int height, std::vector<GLuint>& indices, Result& result);
+};
@@ -0,0 +1,38 @@
+#include "Camera.h"
+
+#include <algorithm>
+
+void Camera::GetVisibleRect(glm::vec2& minPoint, glm::vec2& maxPoint) const
+{
+    minPoint = center - glm::vec2(1.0f / zoom);
+    maxPoint = center + glm::vec2(1.0f / zoom);
+}
+
+float Camera::GetPixelSize(int width, int height) const
+{
+    return 2.0f / zoom / std::max(1, std::min(width, height));
+}
+
+glm::vec2 Camera::ScreenToWorld(double xpos, double ypos, int width, int height) const
+{
+    glm::vec2 clip(float(xpos / width - 0.5) * 2.0f, float(0.5 - ypos / height) * 2.0f);
+    return center + clip / zoom;
+}
+
+void Camera::Pan(double xdiff, double ydiff, int width, int height)
+{
+    center -= glm::vec2(float(xdiff / width), -float(ydiff / height)) * 2.0f / zoom;
+}
+
+void Camera::Zoom(float factor, double xpos, double ypos, int width, int height)
+{
+    glm::vec2 anchor = ScreenToWorld(xpos, ypos, width, height);
+    zoom = glm::clamp(zoom * factor, 1e-4f, 1e4f);
+    center += anchor - ScreenToWorld(xpos, ypos, width, height);
+}
+
+void Camera::Reset()
+{
+    center = glm::vec2(0.0f);
+    zoom = 1.0f;
+}
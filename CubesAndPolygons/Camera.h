@@ -0,0 +1,24 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// 2D camera over the scene plane. At zoom 1 the visible rectangle is the [-1, 1] square
+// the scene coordinates were made for, screen positions are in framebuffer pixels.
+class Camera
+{
+public:
+    void GetVisibleRect(glm::vec2& minPoint, glm::vec2& maxPoint) const;
+    // World units per pixel, the larger of both axes
+    float GetPixelSize(int width, int height) const;
+    glm::vec2 ScreenToWorld(double xpos, double ypos, int width, int height) const;
+
+    // Moves the scene with the cursor
+    void Pan(double xdiff, double ydiff, int width, int height);
+    // Scales the view around the cursor, the world point under it stays in place
+    void Zoom(float factor, double xpos, double ypos, int width, int height);
+    void Reset();
+
+private:
+    glm::vec2 center = glm::vec2(0.0f);
+    float zoom = 1.0f;
+};
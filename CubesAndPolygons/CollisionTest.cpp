@@ -0,0 +1,256 @@
+#include "CollisionTest.h"
+#include "ConvexShape.h"
+#include "Cube.h"
+#include "Polygon2D.h"
+#include "Scene.h"
+#include "TriangulationVisitor.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace
+{
+    size_t Fail(size_t& failures, const std::string& message)
+    {
+        if (failures++ < 10)
+            std::cout << "collisions: " << message << std::endl;
+        return failures;
+    }
+
+    // outline around the origin with the given radius function, counter-clockwise
+    template <typename Radius>
+    std::vector<glm::vec2> MakeOutline(size_t pointsCount, Radius radius)
+    {
+        std::vector<glm::vec2> points;
+        for (size_t i = 0; i < pointsCount; ++i) {
+            float angle = 6.2831853f * i / pointsCount;
+            float r = radius(i);
+            points.push_back(glm::vec2(r * std::cos(angle), r * std::sin(angle)));
+        }
+        return points;
+    }
+
+    // the shape the scene builds for the entity
+    void BuildShape(const Entity& entity, ConvexShape& shape)
+    {
+        if (entity.IsClosed()) {
+            std::vector<glm::vec3> vertices;
+            entity.GetVertices(vertices);
+            shape.BuildFromHull(vertices);
+        }
+        else {
+            std::vector<GLfloat> triangles(entity.GetTrianglesCount() * 3 * 3);
+            TriangulationVisitor triangulation(triangles, 0);
+            entity.Accept(&triangulation);
+            shape.BuildFromTriangles(triangles.data(), entity.GetTrianglesCount());
+        }
+        shape.SetTransform(entity.GetTransform());
+    }
+
+    // the triangles in the xy plane of the world, 3 points each; the faces of a cube cover its outline there
+    std::vector<glm::vec2> GetFootprint(const Entity& entity)
+    {
+        std::vector<GLfloat> triangles(entity.GetTrianglesCount() * 3 * 3);
+        TriangulationVisitor triangulation(triangles, 0);
+        entity.Accept(&triangulation);
+        glm::mat4 transform = entity.GetTransform();
+        std::vector<glm::vec2> footprint;
+        for (size_t i = 0; i < triangles.size(); i += 3)
+            footprint.push_back(glm::vec2(transform * glm::vec4(triangles[i], triangles[i + 1], triangles[i + 2], 1.0f)));
+        return footprint;
+    }
+
+    // true if some two triangles overlap by more than the tolerance along every axis of their edges
+    bool FootprintsOverlap(const std::vector<glm::vec2>& a, const glm::vec2& offset, const std::vector<glm::vec2>& b, float tolerance)
+    {
+        for (size_t i = 0; i < a.size(); i += 3) {
+            glm::vec2 first[3] = { a[i] + offset, a[i + 1] + offset, a[i + 2] + offset };
+            for (size_t j = 0; j < b.size(); j += 3) {
+                const glm::vec2* second = &b[j];
+                bool overlap = true;
+                for (int edge = 0; edge < 6 && overlap; ++edge) {
+                    const glm::vec2* points = (edge < 3) ? first : second;
+                    glm::vec2 direction = points[(edge + 1) % 3] - points[edge % 3];
+                    if (direction == glm::vec2(0.0f))
+                        continue;
+                    glm::vec2 axis = glm::normalize(glm::vec2(-direction.y, direction.x));
+                    float minA = glm::dot(first[0], axis), maxA = minA, minB = glm::dot(second[0], axis), maxB = minB;
+                    for (int k = 1; k < 3; ++k) {
+                        minA = std::min(minA, glm::dot(first[k], axis));
+                        maxA = std::max(maxA, glm::dot(first[k], axis));
+                        minB = std::min(minB, glm::dot(second[k], axis));
+                        maxB = std::max(maxB, glm::dot(second[k], axis));
+                    }
+                    overlap = std::min(maxA, maxB) - std::max(minA, minB) > tolerance;
+                }
+                if (overlap)
+                    return true;
+            }
+        }
+        return false;
+    }
+
+    std::shared_ptr<Entity> MakeEntity(std::mt19937& random, const glm::vec2& center)
+    {
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        std::shared_ptr<Entity> entity;
+        switch (random() % 3) {
+        case 0:
+            entity.reset(new Cube(glm::vec3(center, 0.0f), 0.1 + 0.1 * unit(random), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+            break;
+        case 1:
+            entity.reset(new Polygon2D(MakeOutline(3 + random() % 14, [](size_t) { return 0.1f; }),
+                glm::translate(glm::mat4(1.0f), glm::vec3(center, 0.0f))));
+            break;
+        default:
+            entity.reset(new Polygon2D(MakeOutline(6 + random() % 20, [&](size_t) { return 0.1f * (0.4f + 0.6f * unit(random)); }),
+                glm::translate(glm::mat4(1.0f), glm::vec3(center, 0.0f))));
+            break;
+        }
+        entity->Rotate(6.0f * unit(random), 6.0f * unit(random));
+        return entity;
+    }
+
+    // pairs around the origin, most of them overlapping
+    void CheckShapes(size_t pairsCount, size_t& overlapping, size_t& parted, size_t& failures)
+    {
+        std::mt19937 random(7);
+        std::uniform_real_distribution<float> offset(-0.15f, 0.15f);
+        overlapping = parted = 0;
+        for (size_t pair = 0; pair < pairsCount; ++pair) {
+            std::shared_ptr<Entity> a = MakeEntity(random, glm::vec2(offset(random), offset(random)));
+            std::shared_ptr<Entity> b = MakeEntity(random, glm::vec2(0.0f));
+            ConvexShape shapeA, shapeB;
+            BuildShape(*a, shapeA);
+            BuildShape(*b, shapeB);
+            std::vector<glm::vec2> footprintA = GetFootprint(*a), footprintB = GetFootprint(*b);
+
+            std::string which = "pair " + std::to_string(pair);
+            glm::vec2 separation;
+            if (!shapeA.Overlaps(shapeB, separation)) {
+                if (FootprintsOverlap(footprintA, glm::vec2(0.0f), footprintB, 1e-4f))
+                    Fail(failures, which + " overlaps, reported apart");
+                continue;
+            }
+            ++overlapping;
+
+            // the separation is the shortest way out of its pair of pieces: most of it leaves them overlapping
+            float depth = glm::length(separation);
+            if (depth > 1e-3f && !FootprintsOverlap(footprintA, 0.9f * separation, footprintB, 0.0f))
+                Fail(failures, which + " parts before the separation of " + std::to_string(depth));
+
+            // with one piece on each side the pieces are the shapes, and a little further than the separation parts them
+            if (shapeA.GetPiecesCount() == 1 && shapeB.GetPiecesCount() == 1) {
+                glm::vec2 shifted = 1.001f * separation;
+                shapeA.SetTransform(glm::translate(glm::mat4(1.0f), glm::vec3(shifted, 0.0f)) * a->GetTransform());
+                glm::vec2 remaining;
+                if (shapeA.Overlaps(shapeB, remaining) || FootprintsOverlap(footprintA, shifted, footprintB, 1e-6f))
+                    Fail(failures, which + " still overlaps after the separation of " + std::to_string(depth));
+                ++parted;
+            }
+        }
+    }
+}
+
+size_t CollisionTest::Run(size_t entitiesCount, size_t movesCount, size_t pairsCount)
+{
+    size_t failures = 0;
+    size_t overlapping, parted;
+    CheckShapes(pairsCount, overlapping, parted, failures);
+    std::ostringstream report;
+    report << "collisions: " << pairsCount << " shape pairs, " << overlapping << " overlapping, " << parted << " of them parted; ";
+
+    // a checkerboard of cubes and star polygons, every third one turned, with a star to drag through it
+    std::mt19937 random(5);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    size_t side = std::max<size_t>(1, size_t(std::sqrt(double(entitiesCount))));
+    float cell = 2.0f / side;
+    auto makeStar = [&](size_t pointsCount, float radius) {
+        return MakeOutline(pointsCount, [&](size_t) { return radius * (0.5f + 0.5f * unit(random)); });
+    };
+    std::vector<std::shared_ptr<Entity>> entities;
+    for (size_t i = 0; i < side; ++i) {
+        for (size_t j = 0; j < side; ++j) {
+            glm::vec2 center(-1.0f + cell * (i + 0.5f), -1.0f + cell * (j + 0.5f));
+            std::shared_ptr<Entity> entity;
+            if ((i + j) % 2)
+                entity.reset(new Cube(glm::vec3(center, 0.0f), cell * 0.35f, glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+            else
+                entity.reset(new Polygon2D(makeStar(7, cell * 0.3f), glm::translate(glm::mat4(1.0f), glm::vec3(center, 0.0f))));
+            if (entities.size() % 3 == 0)
+                entity->Rotate(0.3f, 0.2f);
+            entities.push_back(entity);
+        }
+    }
+    glm::vec2 start(-1.0f + cell * (side / 2), -1.0f + cell * (side / 2));
+    entities.push_back(std::make_shared<Polygon2D>(makeStar(9, cell * 0.2f),
+        glm::translate(glm::mat4(1.0f), glm::vec3(start, 0.0f))));
+    const Entity& dragged = *entities.back();
+
+    // the static entities do not move, their bounds are taken once
+    std::vector<glm::vec2> bounds;
+    for (const std::shared_ptr<Entity>& entity : entities) {
+        glm::vec3 minPoint, maxPoint;
+        entity->GetWorldBounds(minPoint, maxPoint);
+        bounds.push_back(glm::vec2(minPoint));
+        bounds.push_back(glm::vec2(maxPoint));
+    }
+    auto findOverlapping = [&](float tolerance, std::vector<size_t>& overlapping) {
+        glm::vec3 minPoint, maxPoint;
+        dragged.GetWorldBounds(minPoint, maxPoint);
+        std::vector<glm::vec2> footprint = GetFootprint(dragged);
+        overlapping.clear();
+        for (size_t index = 0; index + 1 < entities.size(); ++index) {
+            if (bounds[2 * index].x <= maxPoint.x && minPoint.x <= bounds[2 * index + 1].x &&
+                bounds[2 * index].y <= maxPoint.y && minPoint.y <= bounds[2 * index + 1].y &&
+                FootprintsOverlap(footprint, glm::vec2(0.0f), GetFootprint(*entities[index]), tolerance))
+                overlapping.push_back(index);
+        }
+    };
+
+    Scene scene;
+    scene.AddEntities(entities);
+    scene.CommitPendingEntities();
+    const int Width = 800, Height = 800;
+    scene.SetViewport(glm::vec2(-1.0f), glm::vec2(1.0f), 2.0f / Width);
+    scene.SetCollisions(true);
+    scene.SetSelected(int(entities.size()), 0.0, 0.0);
+    // entities overlapping at the pick are let through
+    std::vector<size_t> ignored, overlapped;
+    findOverlapping(0.0f, ignored);
+
+    // loops of a few hundred pixels, so the polygon stays among the others, up to 2.5 pixels per event
+    std::vector<double> times;
+    for (size_t move = 0; move < movesCount; ++move) {
+        double x = 300.0 * std::sin(0.005 * move), y = 300.0 * std::sin(0.0085 * move);
+        auto startTime = std::chrono::steady_clock::now();
+        scene.MouseMove(float(x), float(y), Width, Height);
+        scene.ApplyMouseMoves();
+        times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count());
+
+        findOverlapping(1e-6f, overlapped);
+        for (size_t index : overlapped) {
+            if (!std::binary_search(ignored.begin(), ignored.end(), index))
+                Fail(failures, "the dragged polygon overlaps entity " + std::to_string(index) + " after move " + std::to_string(move));
+        }
+    }
+    scene.SetSelected(0);
+
+    size_t checked, blocked;
+    double slowestCheck;
+    scene.TakeCollisionCounters(checked, blocked, slowestCheck);
+    std::sort(times.begin(), times.end());
+    std::cout << report.str() << entities.size() - 1 << " static entities, " << checked << " checked moves, "
+        << blocked << " blocked; per drag event median " << times[times.size() / 2] << " ms, 99th percentile "
+        << times[times.size() * 99 / 100] << " ms, slowest " << times.back() << " ms; " << failures << " failed checks" << std::endl;
+    return failures;
+}
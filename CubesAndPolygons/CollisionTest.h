@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+
+// Checks ConvexShape::Overlaps on pairs of cubes, convex polygons and star polygons against their
+// triangles: shapes reported apart must not overlap, a shorter translation than the separation must
+// not part them and the separation must part single pieces. Then drags a polygon through a scene of
+// static cubes and polygons in collision mode, times the drag events and checks that it never ends
+// up overlapping the entities it did not overlap when it was picked.
+class CollisionTest
+{
+public:
+    // returns the number of failed checks
+    static size_t Run(size_t entitiesCount = 100000, size_t movesCount = 3000, size_t pairsCount = 20000);
+};
@@ -0,0 +1,269 @@
+#include "ConvexShape.h"
+#include "Predicates.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+static uint64_t GetEdgeKey(uint32_t a, uint32_t b)
+{
+    return (uint64_t(a) << 32) | b;
+}
+
+void ConvexShape::BuildFromTriangles(const GLfloat* vertices, size_t trianglesCount)
+{
+    hull = false;
+    transformed = false;
+
+    // triangles share points with exactly the same coordinates
+    std::vector<glm::vec2> points;
+    std::unordered_map<uint64_t, uint32_t> pointIndices;
+    auto getPoint = [&](const GLfloat* vertex) {
+        uint32_t x, y;
+        std::memcpy(&x, vertex, sizeof(x));
+        std::memcpy(&y, vertex + 1, sizeof(y));
+        auto inserted = pointIndices.emplace(GetEdgeKey(x, y), uint32_t(points.size()));
+        if (inserted.second)
+            points.push_back(glm::vec2(vertex[0], vertex[1]));
+        return inserted.first->second;
+    };
+
+    // counter-clockwise triangles, every directed edge belongs to one piece
+    std::vector<std::vector<uint32_t>> pieces;
+    std::unordered_map<uint64_t, uint32_t> edgePieces;
+    for (size_t t = 0; t < trianglesCount; ++t) {
+        const GLfloat* triangle = vertices + t * 9;
+        uint32_t a = getPoint(triangle), b = getPoint(triangle + 3), c = getPoint(triangle + 6);
+        double orientation = Predicates::Orient2D(points[a], points[b], points[c]);
+        if (orientation == 0.0)
+            continue;
+        if (orientation < 0.0)
+            std::swap(b, c);
+        uint32_t piece = uint32_t(pieces.size());
+        pieces.push_back({ a, b, c });
+        edgePieces[GetEdgeKey(a, b)] = piece;
+        edgePieces[GetEdgeKey(b, c)] = piece;
+        edgePieces[GetEdgeKey(c, a)] = piece;
+    }
+
+    // Hertel-Mehlhorn: a diagonal is removed if the pieces on both sides stay convex at its ends
+    std::vector<bool> merged(pieces.size(), false);
+    for (uint32_t p = 0; p < pieces.size(); ++p) {
+        if (merged[p])
+            continue;
+        std::vector<uint32_t>& piece = pieces[p];
+        bool grown = true;
+        while (grown) {
+            grown = false;
+            for (size_t i = 0; i < piece.size() && !grown; ++i) {
+                size_t count = piece.size();
+                uint32_t a = piece[i], b = piece[(i + 1) % count];
+                auto found = edgePieces.find(GetEdgeKey(b, a));
+                if (found == edgePieces.end() || found->second == p)
+                    continue;
+                uint32_t q = found->second;
+                std::vector<uint32_t>& neighbour = pieces[q];
+                size_t neighbourCount = neighbour.size();
+                if (count + neighbourCount - 2 > MaxPieceVertices)
+                    continue;
+
+                // the neighbour has the edge the other way round, b then a at j
+                size_t j = 0;
+                while (neighbour[j] != a || neighbour[(j + neighbourCount - 1) % neighbourCount] != b)
+                    ++j;
+                uint32_t beforeA = piece[(i + count - 1) % count], afterA = neighbour[(j + 1) % neighbourCount];
+                uint32_t beforeB = neighbour[(j + neighbourCount - 2) % neighbourCount], afterB = piece[(i + 2) % count];
+                if (Predicates::Orient2D(points[beforeA], points[a], points[afterA]) < 0.0 ||
+                    Predicates::Orient2D(points[beforeB], points[b], points[afterB]) < 0.0)
+                    continue;
+
+                // the piece up to a, the neighbour from a to b, the piece from b on
+                std::vector<uint32_t> joined(piece.begin(), piece.begin() + i + 1);
+                for (size_t k = 1; k + 1 < neighbourCount; ++k)
+                    joined.push_back(neighbour[(j + k) % neighbourCount]);
+                joined.insert(joined.end(), piece.begin() + i + 1, piece.end());
+
+                edgePieces.erase(GetEdgeKey(a, b));
+                edgePieces.erase(GetEdgeKey(b, a));
+                for (size_t k = 0; k < neighbourCount; ++k) {
+                    auto edge = edgePieces.find(GetEdgeKey(neighbour[k], neighbour[(k + 1) % neighbourCount]));
+                    if (edge != edgePieces.end())
+                        edge->second = p;
+                }
+                neighbour.clear();
+                merged[q] = true;
+                piece.swap(joined);
+                grown = true;
+            }
+        }
+    }
+
+    localPoints.clear();
+    localStarts.assign(1, 0);
+    for (uint32_t p = 0; p < pieces.size(); ++p) {
+        if (merged[p])
+            continue;
+        for (uint32_t point : pieces[p])
+            localPoints.push_back(glm::vec3(points[point], 0.0f));
+        localStarts.push_back(uint32_t(localPoints.size()));
+    }
+}
+
+void ConvexShape::BuildFromHull(const std::vector<glm::vec3>& vertices)
+{
+    hull = true;
+    transformed = false;
+    localPoints = vertices;
+    localStarts.assign(1, 0);
+    localStarts.push_back(uint32_t(localPoints.size()));
+}
+
+void ConvexShape::SetTransform(const glm::mat4& iTransform)
+{
+    if (transformed && transform == iTransform)
+        return;
+    transform = iTransform;
+    transformed = true;
+
+    worldPoints.resize(localPoints.size());
+    for (size_t i = 0; i < localPoints.size(); ++i)
+        worldPoints[i] = glm::vec2(transform * glm::vec4(localPoints[i], 1.0f));
+    worldStarts = localStarts;
+
+    if (hull && worldPoints.size() > 2) {
+        // monotone chain, lower hull then upper hull, counter-clockwise without collinear points
+        std::vector<glm::vec2> projected(worldPoints);
+        std::sort(projected.begin(), projected.end(), [](const glm::vec2& a, const glm::vec2& b) {
+            return a.x < b.x || (a.x == b.x && a.y < b.y);
+        });
+        worldPoints.clear();
+        for (int pass = 0; pass < 2; ++pass) {
+            size_t chainStart = worldPoints.size();
+            for (size_t k = 0; k < projected.size(); ++k) {
+                const glm::vec2& point = projected[pass == 0 ? k : projected.size() - 1 - k];
+                while (worldPoints.size() >= chainStart + 2 &&
+                    Predicates::Orient2D(worldPoints[worldPoints.size() - 2], worldPoints.back(), point) <= 0.0)
+                    worldPoints.pop_back();
+                worldPoints.push_back(point);
+            }
+            // the last point of a chain starts the other one
+            worldPoints.pop_back();
+        }
+        worldStarts.assign(1, 0);
+        worldStarts.push_back(uint32_t(worldPoints.size()));
+    }
+
+    pieceBounds.resize((worldStarts.size() - 1) * 2);
+    for (size_t p = 0; p + 1 < worldStarts.size(); ++p) {
+        glm::vec2 pieceMin(std::numeric_limits<float>::max()), pieceMax(-std::numeric_limits<float>::max());
+        for (uint32_t i = worldStarts[p]; i < worldStarts[p + 1]; ++i) {
+            pieceMin = glm::min(pieceMin, worldPoints[i]);
+            pieceMax = glm::max(pieceMax, worldPoints[i]);
+        }
+        pieceBounds[2 * p] = pieceMin;
+        pieceBounds[2 * p + 1] = pieceMax;
+        minPoint = (p == 0) ? pieceMin : glm::min(minPoint, pieceMin);
+        maxPoint = (p == 0) ? pieceMax : glm::max(maxPoint, pieceMax);
+    }
+}
+
+bool ConvexShape::Overlaps(const ConvexShape& other, glm::vec2& separation) const
+{
+    glm::vec2 commonMin = glm::max(minPoint, other.minPoint);
+    glm::vec2 commonMax = glm::min(maxPoint, other.maxPoint);
+    if (GetPiecesCount() == 0 || other.GetPiecesCount() == 0 || glm::any(glm::greaterThan(commonMin, commonMax)))
+        return false;
+
+    // sweep and prune along x over the pieces of both shapes within the common bounds
+    struct Entry
+    {
+        float minX;
+        uint32_t piece;
+        bool own;
+    };
+    std::vector<Entry> entries;
+    for (int side = 0; side < 2; ++side) {
+        const ConvexShape& shape = (side == 0) ? *this : other;
+        for (uint32_t p = 0; p < shape.GetPiecesCount(); ++p) {
+            const glm::vec2& pieceMin = shape.pieceBounds[2 * p];
+            const glm::vec2& pieceMax = shape.pieceBounds[2 * p + 1];
+            if (glm::all(glm::lessThanEqual(pieceMin, commonMax)) && glm::all(glm::lessThanEqual(commonMin, pieceMax))) {
+                Entry entry = { pieceMin.x, p, side == 0 };
+                entries.push_back(entry);
+            }
+        }
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.minX < b.minX; });
+
+    std::vector<uint32_t> active[2];
+    float deepest = 0.0f;
+    for (const Entry& entry : entries) {
+        const ConvexShape& shape = entry.own ? *this : other;
+        const ConvexShape& opposite = entry.own ? other : *this;
+        std::vector<uint32_t>& candidates = active[entry.own ? 1 : 0];
+        size_t kept = 0;
+        for (uint32_t piece : candidates) {
+            if (opposite.pieceBounds[2 * piece + 1].x < entry.minX)
+                continue;
+            candidates[kept++] = piece;
+            if (shape.pieceBounds[2 * entry.piece].y > opposite.pieceBounds[2 * piece + 1].y ||
+                opposite.pieceBounds[2 * piece].y > shape.pieceBounds[2 * entry.piece + 1].y)
+                continue;
+
+            uint32_t ownPiece = entry.own ? entry.piece : piece;
+            uint32_t otherPiece = entry.own ? piece : entry.piece;
+            glm::vec2 pieceSeparation;
+            if (OverlapPieces(&worldPoints[worldStarts[ownPiece]], worldStarts[ownPiece + 1] - worldStarts[ownPiece],
+                &other.worldPoints[other.worldStarts[otherPiece]], other.worldStarts[otherPiece + 1] - other.worldStarts[otherPiece],
+                pieceSeparation) && glm::length(pieceSeparation) > deepest) {
+                deepest = glm::length(pieceSeparation);
+                separation = pieceSeparation;
+            }
+        }
+        candidates.resize(kept);
+        active[entry.own ? 0 : 1].push_back(entry.piece);
+    }
+    return deepest > 0.0f;
+}
+
+bool ConvexShape::OverlapPieces(const glm::vec2* a, size_t aCount, const glm::vec2* b, size_t bCount, glm::vec2& separation)
+{
+    float least = std::numeric_limits<float>::max();
+    for (int side = 0; side < 2; ++side) {
+        const glm::vec2* points = (side == 0) ? a : b;
+        size_t count = (side == 0) ? aCount : bCount;
+        for (size_t i = 0; i < count; ++i) {
+            glm::vec2 edge = points[(i + 1) % count] - points[i];
+            float length = glm::length(edge);
+            if (length == 0.0f)
+                continue;
+            glm::vec2 axis(-edge.y / length, edge.x / length);
+
+            float minA = std::numeric_limits<float>::max(), maxA = -minA, minB = minA, maxB = -minA;
+            for (size_t k = 0; k < aCount; ++k) {
+                float projection = glm::dot(a[k], axis);
+                minA = std::min(minA, projection);
+                maxA = std::max(maxA, projection);
+            }
+            for (size_t k = 0; k < bCount; ++k) {
+                float projection = glm::dot(b[k], axis);
+                minB = std::min(minB, projection);
+                maxB = std::max(maxB, projection);
+            }
+
+            // moving a forward along the axis by maxB - minA or back by maxA - minB separates them;
+            // overlaps within the rounding error of the extents count as touching
+            float forward = maxB - minA;
+            float backward = maxA - minB;
+            float overlap = std::min(forward, backward);
+            if (overlap <= 1e-5f * (maxA - minA + maxB - minB))
+                return false;
+            if (overlap < least) {
+                least = overlap;
+                separation = (forward < backward) ? axis * overlap : -axis * overlap;
+            }
+        }
+    }
+    return least != std::numeric_limits<float>::max();
+}
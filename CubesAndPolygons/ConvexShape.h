@@ -0,0 +1,49 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// Footprint of an entity in the xy plane of the world as convex pieces, for separating axis tests.
+// The pieces are kept in entity coordinates and transformed to the world when the transform changes.
+class ConvexShape
+{
+public:
+    // Planar entities: their triangles, 9 floats each, merged into convex pieces (Hertel-Mehlhorn).
+    // Degenerate triangles are skipped, so placeholders and unused slots cost nothing.
+    void BuildFromTriangles(const GLfloat* vertices, size_t trianglesCount);
+    // Solid entities: one piece, the convex hull of the vertices projected to the plane after the transform
+    void BuildFromHull(const std::vector<glm::vec3>& vertices);
+    void SetTransform(const glm::mat4& transform);
+
+    // true if the shapes overlap by more than touching; separation - the shortest translation of this
+    // shape out of the most deeply overlapping pair of pieces, other pairs may still overlap after it
+    bool Overlaps(const ConvexShape& other, glm::vec2& separation) const;
+
+    const glm::vec2& GetMin() const { return minPoint; }
+    const glm::vec2& GetMax() const { return maxPoint; }
+    size_t GetPiecesCount() const { return worldStarts.empty() ? 0 : worldStarts.size() - 1; }
+
+private:
+    // Overlap of two convex pieces along the axis of the least penetration, false if they are separated
+    static bool OverlapPieces(const glm::vec2* a, size_t aCount, const glm::vec2* b, size_t bCount, glm::vec2& separation);
+
+    // merged pieces get no larger, which keeps the merging and the tests of a piece short
+    static const size_t MaxPieceVertices = 16;
+
+    bool hull = false;
+    // piece i is localPoints[localStarts[i] .. localStarts[i + 1])
+    std::vector<glm::vec3> localPoints;
+    std::vector<uint32_t> localStarts;
+
+    bool transformed = false;
+    glm::mat4 transform;
+    std::vector<glm::vec2> worldPoints;
+    std::vector<uint32_t> worldStarts;
+    // min and max of every world piece
+    std::vector<glm::vec2> pieceBounds;
+    glm::vec2 minPoint = glm::vec2(0.0);
+    glm::vec2 maxPoint = glm::vec2(0.0);
+};
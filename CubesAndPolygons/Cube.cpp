@@ -2,6 +2,8 @@
 
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <cmath>
+
 Cube::Cube(glm::vec3 iCenter, double iEdgeLength, glm::vec3 iMainAxis, glm::vec3 iAuxilaryAxis)
 : edgeLength(iEdgeLength), mainAxis(iMainAxis), auxilaryAxis(iAuxilaryAxis)
 {
@@ -13,9 +15,59 @@ GLsizei Cube::GetTrianglesCount() const
     return 12;
 }
 
+void Cube::GetBounds(glm::vec3& minPoint, glm::vec3& maxPoint) const
+{
+    // sphere around the cube, does not depend on the axes
+    float radius = static_cast<float>(edgeLength * std::sqrt(3.0) / 2.0);
+    minPoint = glm::vec3(-radius);
+    maxPoint = glm::vec3(radius);
+}
+
+void Cube::GetVertices(std::vector<glm::vec3>& vertices) const
+{
+    glm::vec3 axis1 = mainAxis;
+    glm::vec3 axis2 = glm::cross(axis1, auxilaryAxis);
+    glm::vec3 axis3 = glm::cross(axis1, axis2);
+
+    double half_edge = edgeLength / 2.0;
+    axis1 = glm::normalize(axis1);
+    axis1 *= half_edge;
+    axis2 = glm::normalize(axis2);
+    axis2 *= half_edge;
+    axis3 = glm::normalize(axis3);
+    axis3 *= half_edge;
+
+    vertices.resize(8);
+    vertices[0] = axis1 + axis2 + axis3;
+    vertices[1] = axis1 + axis2 - axis3;
+    vertices[2] = axis1 - axis2 + axis3;
+    vertices[3] = axis1 - axis2 - axis3;
+    vertices[4] = -axis1 + axis2 + axis3;
+    vertices[5] = -axis1 + axis2 - axis3;
+    vertices[6] = -axis1 - axis2 + axis3;
+    vertices[7] = -axis1 - axis2 - axis3;
+}
+
 void Cube::Rotate(float xdiff, float ydiff)
 {
     glm::mat4 rotation_x = glm::rotate(glm::mat4(1.0f), xdiff, glm::vec3(0.0, 1.0, 0.0));
     glm::mat4 rotation_y = glm::rotate(glm::mat4(1.0f), ydiff, glm::vec3(1.0, 0.0, 0.0));
     rotation = rotation_y * (rotation_x * rotation);
 }
+
+void Cube::BuildDetailLevels(std::vector<DetailLevel>& levels) const
+{
+    // wound clockwise on the screen like the front faces of the cube, so culling keeps it
+    float half = static_cast<float>(edgeLength * 0.6);
+    const GLfloat square[] = {
+        -half, -half, 0.0f,  -half, half, 0.0f,  half, half, 0.0f,
+        -half, -half, 0.0f,  half, half, 0.0f,  half, -half, 0.0f
+    };
+
+    DetailLevel level;
+    level.tolerance = static_cast<float>(edgeLength / ImpostorMaxPixels);
+    level.impostor = true;
+    level.verticesCount = 6;
+    level.vertices.assign(square, square + sizeof(square) / sizeof(GLfloat));
+    levels.assign(1, level);
+}
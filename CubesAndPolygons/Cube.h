@@ -11,13 +11,23 @@ struct Cube : public Entity {
         visitor->VisitCube(this);
     }
     void Rotate(float xdiff, float ydiff) override;
+    void GetBounds(glm::vec3& minPoint, glm::vec3& maxPoint) const override;
+    // the 8 corners
+    void GetVertices(std::vector<glm::vec3>& vertices) const override;
     const float* GetColor() const override {
         static float color[4] = { 0.0f, 0.5f, 0.5f, 1.0f };
         return &color[0];
     }
+    bool IsClosed() const override { return true; }
+    // One impostor level: a square facing the screen with the average cube silhouette area
+    void BuildDetailLevels(std::vector<DetailLevel>& levels) const override;
+    GLsizei GetDetailVerticesLimit() const override { return 6; }
 
     double edgeLength;
     // defines one of the planes
     glm::vec3 mainAxis;
     glm::vec3 auxilaryAxis;
+
+    // cubes smaller on the screen are drawn as impostors
+    static const int ImpostorMaxPixels = 4;
 };
\ No newline at end of file
@@ -1,4 +1,12 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <sstream>
+#include <thread>
 #include <vector>
 
 #define GLEW_STATIC
@@ -10,103 +18,285 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "BatchProcessor.h"
+#include "Camera.h"
+#include "CollisionTest.h"
+#include "PolygonBooleanBenchmark.h"
+#include "PolygonEditorBenchmark.h"
+#include "RenderThread.h"
+#include "Renderer.h"
 #include "Scene.h"
+#include "SceneFile.h"
+#include "SceneImporter.h"
+#include "SceneStressTest.h"
+#include "SelectionTest.h"
+#include "TriangulationBenchmark.h"
+#include "VertexGridTest.h"
 
-static GLFWwindow* InitGL();
-static GLuint LinkShaders();
+struct Application;
+static GLFWwindow* InitGL(Application* app);
 
 static void CursorPosCallback(GLFWwindow* window, double xpos, double ypos);
 static void MouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
+static void ApplyPick(Application& app, GLuint pickedIndex, double xpos, double ypos);
+static void ScrollCallback(GLFWwindow* window, double xoffset, double yoffset);
 static void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mode);
+static void RefreshCallback(GLFWwindow* window);
+static void UpdateViewport(GLFWwindow* window);
 
-static void AddTestData();
+struct FrameStats;
+static void ShowFrameStats(GLFWwindow* window, FrameStats& stats);
+
+static void AddTestData(Scene& scene);
 
 const GLuint WIDTH = 800, HEIGHT = 600;
+// entities streamed from a scene file per frame
+const size_t LOAD_CHUNK_SIZE = 10000;
+// written by F5 with the triangulated geometry, loaded on startup when no scene is given
+const char* SNAPSHOT_PATH = "snapshot.cps";
 
-// Shaders
-const GLchar* vertexShaderSource = "#version 330 core\n"
-"layout (location = 0) in vec3 position;\n"
-"uniform mat4 transform;\n"
-"void main()\n"
-"{\n"
-"gl_Position = transform * vec4(position.x, position.y, position.z, 1.0);\n"
-"}\0";
-
-const GLchar* fragmentShaderSource = "#version 330 core\n"
-"out vec4 color;\n"
-"uniform vec4 col;\n"
-"void main()\n"
-"{\n"
-"color = col;\n"
-"}\n\0";
-
-int main()
+// State of the interactive window, the GLFW callbacks reach it through the window user pointer
+struct Application
+{
+    Scene scene;
+
+    // wheel zooms around the cursor, right button drag pans, Home resets
+    Camera camera;
+    bool panning = false;
+    double panX = 0.0, panY = 0.0;
+
+    // D switches between depth tested front-to-back drawing with back-face culling and plain submission order
+    bool depthMode = true;
+    // V switches the left button between dragging entities and dragging polygon vertices,
+    // S switches snapping, C collisions
+    bool vertexMode = false;
+    // Alt + left button drag selects a group with a rectangle, or with a lasso after L is pressed,
+    // G puts the group or the selected entity under a new hierarchy node,
+    // U replaces the polygons of the group by their union, I and X by their intersections with and
+    // differences from the selected one
+    bool lassoMode = false;
+    // --on-demand: draw only when the scene changes and sleep in glfwWaitEvents otherwise
+    bool onDemandMode = false;
+    bool redrawRequested = true;
+
+    // --threaded: frame snapshots are drawn by the render thread, otherwise by the renderer on the main thread
+    std::unique_ptr<Renderer> renderer;
+    std::unique_ptr<RenderThread> renderThread;
+    // cursor position of the pick waiting for the render thread, cleared when the button is released
+    bool pickPending = false;
+    double pickX = 0.0, pickY = 0.0;
+};
+
+// Counters shown in the window title once per STATS_PERIOD seconds
+const double STATS_PERIOD = 1.0;
+struct FrameStats
 {
-    GLFWwindow* window = InitGL();
-    GLuint shaderProgram = LinkShaders();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::chrono::duration<double> waitTime = std::chrono::duration<double>::zero();
+    DrawStats draw;
+};
 
-    AddTestData();
+int main(int argc, char** argv)
+{
+    auto startTime = std::chrono::steady_clock::now();
+
+    Application app;
+
+    // CubesAndPolygons [--lazy] [--on-demand] [--threaded] [--stream-budget MB] [scene.cps | scene.txt]
+    // CubesAndPolygons --batch scene.cps|scene.txt ...
+    // CubesAndPolygons --triangulation-benchmark
+    // CubesAndPolygons --vertex-edit-benchmark
+    // CubesAndPolygons --boolean-benchmark
+    // CubesAndPolygons --scene-stress
+    // CubesAndPolygons --vertex-grid-test
+    // CubesAndPolygons --collision-test
+    // CubesAndPolygons --selection-test
+    std::string path = SNAPSHOT_PATH;
+    bool hasPath = false;
+    bool threaded = false;
+    bool batchMode = false;
+    std::vector<std::string> batchPaths;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--lazy") {
+            app.scene.SetLazyTriangulation(true);
+        }
+        else if (arg == "--on-demand") {
+            app.onDemandMode = true;
+        }
+        else if (arg == "--threaded") {
+            threaded = true;
+        }
+        else if (arg == "--stream-budget" && i + 1 < argc) {
+            // low memory mode, geometry of the visible entities is streamed every frame
+            size_t megabytes = std::max(1, std::atoi(argv[++i]));
+            app.scene.SetStreamedGeometry(megabytes * 1024 * 1024);
+        }
+        else if (arg == "--triangulation-benchmark") {
+            TriangulationBenchmark::Run();
+            return 0;
+        }
+        else if (arg == "--vertex-edit-benchmark") {
+            PolygonEditorBenchmark::Run();
+            return 0;
+        }
+        else if (arg == "--boolean-benchmark") {
+            PolygonBooleanBenchmark::Run();
+            return 0;
+        }
+        else if (arg == "--scene-stress") {
+            return SceneStressTest::Run() == 0 ? 0 : 1;
+        }
+        else if (arg == "--vertex-grid-test") {
+            return VertexGridTest::Run() == 0 ? 0 : 1;
+        }
+        else if (arg == "--collision-test") {
+            return CollisionTest::Run() == 0 ? 0 : 1;
+        }
+        else if (arg == "--selection-test") {
+            return SelectionTest::Run() == 0 ? 0 : 1;
+        }
+        else if (arg == "--batch") {
+            batchMode = true;
+        }
+        else {
+            path = arg;
+            hasPath = true;
+            batchPaths.push_back(arg);
+        }
+    }
 
-    GLuint VBO, VAO;
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, Scene::Instance().GetBufferAllocationSize(), Scene::Instance().GetBufferAsArray(), GL_STATIC_DRAW);
+    if (batchMode) {
+        // headless, every file gets its own scene
+        return BatchProcessor::Run(batchPaths, WIDTH, HEIGHT) == 0 ? 0 : 1;
+    }
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (GLvoid*)0);
-    glEnableVertexAttribArray(0);
+    GLFWwindow* window = InitGL(&app);
+    UpdateViewport(window);
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    // wakes the main loop up for events, including entities added by the importer and finished background triangulation
+    app.scene.SetChangedCallback(glfwPostEmptyEvent);
 
-    glm::mat4 transformMatrix;
-    GLuint transformLoc = glGetUniformLocation(shaderProgram, "transform");
-    GLuint colorLoc = glGetUniformLocation(shaderProgram, "col");
+    std::unique_ptr<SceneFileReader> sceneReader;
+    // text scenes are imported on a background thread, the main loop commits the added entities every frame
+    std::thread importThread;
+    if (hasPath || std::ifstream(path).good()) {
+        if (path.size() > 4 && path.compare(path.size() - 4, 4, ".cps") == 0) {
+            sceneReader.reset(new SceneFileReader(path));
+            if (!sceneReader->IsValid())
+                sceneReader.reset();
+        }
+        else {
+            importThread = std::thread([&app, path] {
+                SceneImporter::Import(app.scene, path);
+            });
+        }
+    }
+    if (!sceneReader && !importThread.joinable()) {
+        AddTestData(app.scene);
+    }
+
+    if (threaded) {
+        // the render thread takes the context over
+        glfwMakeContextCurrent(nullptr);
+        app.renderThread.reset(new RenderThread(window, app.onDemandMode));
+    }
+    else {
+        app.renderer.reset(new Renderer());
+    }
+
+    bool firstFrame = true;
+    FrameSnapshot snapshot;
+    std::vector<VertexUpdate> vertexUpdates;
+    FrameStats stats;
 
     // Main loop
     while (!glfwWindowShouldClose(window))
     {
-        glfwPollEvents();
-
-        glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-        glClearStencil(0);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
-
-        glEnable(GL_STENCIL_TEST);
-        glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+        auto waitStart = std::chrono::steady_clock::now();
+        // with the render thread drawing on its own, the main thread only wakes up for events and changes
+        if ((app.onDemandMode || app.renderThread) && !app.redrawRequested && !sceneReader)
+            glfwWaitEventsTimeout(STATS_PERIOD);
+        else
+            glfwPollEvents();
+        stats.waitTime += std::chrono::steady_clock::now() - waitStart;
+
+        GLuint pickedIndex = 0;
+        if (app.renderThread && app.renderThread->TakePickResult(pickedIndex) && app.pickPending) {
+            app.pickPending = false;
+            ApplyPick(app, pickedIndex, app.pickX, app.pickY);
+        }
+        app.scene.ApplyMouseMoves();
+
+        if (sceneReader) {
+            sceneReader->ReadChunk(app.scene, LOAD_CHUNK_SIZE);
+            if (sceneReader->IsFinished()) {
+                std::chrono::duration<double, std::milli> loadTime = std::chrono::steady_clock::now() - startTime;
+                std::cout << "Scene " << path << " loaded in " << loadTime.count() << " ms"
+                    << (sceneReader->HasGeometry() ? "" : " with triangulation") << std::endl;
+                sceneReader.reset();
+            }
+        }
+        app.scene.CommitPendingEntities();
+        app.scene.UpdateTriangulation();
+        app.scene.TakeVertexUpdates(vertexUpdates);
+        if (app.renderThread) {
+            app.renderThread->UpdateGeometry(vertexUpdates);
+        }
+        else {
+            for (const VertexUpdate& update : vertexUpdates)
+                app.renderer->UpdateGeometry(update);
+        }
 
-        glUseProgram(shaderProgram);
-        glBindVertexArray(VAO);
+        // changes made by the input callbacks are drawn right away, so dragging is not delayed
+        bool redraw = app.scene.TakeChanged() || app.redrawRequested;
+        app.redrawRequested = false;
+
+        if (app.renderThread) {
+            if (redraw) {
+                app.scene.BuildFrameSnapshot(app.renderThread->GetSnapshotBuffer(), app.depthMode);
+                app.renderThread->PublishSnapshot();
+            }
+
+            std::chrono::steady_clock::time_point firstFrameTime;
+            if (app.renderThread->TakeFirstFrame(firstFrameTime)) {
+                std::chrono::duration<double, std::milli> firstFrameDuration = firstFrameTime - startTime;
+                std::cout << "First frame after " << firstFrameDuration.count() << " ms" << std::endl;
+            }
+            ShowFrameStats(window, stats);
+            continue;
+        }
 
-        size_t lastIndex = 0;
-        std::vector<std::shared_ptr<Entity>>& entities = Scene::Instance().GetEntities();
-        for (int i = 0; i < entities.size(); ++i) {
-            glStencilFunc(GL_ALWAYS, i + 1, -1);
+        if (app.onDemandMode && !redraw) {
+            ShowFrameStats(window, stats);
+            continue;
+        }
 
-            std::shared_ptr<Entity> entity = entities[i];
-            transformMatrix = entity->translation * entity->rotation;
-            glUniformMatrix4fv(transformLoc, 1, GL_FALSE, glm::value_ptr(transformMatrix));
-            glUniform4fv(colorLoc, 1, entity->GetColor());
+        if (redraw)
+            app.scene.BuildFrameSnapshot(snapshot, app.depthMode);
+        app.renderer->Draw(snapshot, stats.draw);
+        glfwSwapBuffers(window);
 
-            GLsizei verticesCount = entity->GetTrianglesCount() * 3;
-            glDrawArrays(GL_TRIANGLES, lastIndex, verticesCount);
-            lastIndex += verticesCount;
+        if (firstFrame) {
+            firstFrame = false;
+            std::chrono::duration<double, std::milli> firstFrameTime = std::chrono::steady_clock::now() - startTime;
+            std::cout << "First frame after " << firstFrameTime.count() << " ms" << std::endl;
         }
 
-        glBindVertexArray(0);
-        glfwSwapBuffers(window);
+        ShowFrameStats(window, stats);
     }
 
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
+    if (importThread.joinable())
+        importThread.join();
+    app.scene.SetChangedCallback(nullptr);
+    app.renderThread.reset();
+    app.renderer.reset();
     glfwTerminate();
     
     return 0;
 }
 
-static GLFWwindow* InitGL()
+static GLFWwindow* InitGL(Application* app)
 {
     //GLFW
     glfwInit();
@@ -122,9 +312,12 @@ static GLFWwindow* InitGL()
     glfwSetInputMode(window, GLFW_STICKY_KEYS, GLFW_TRUE);
 
     //Keys and mouse events
+    glfwSetWindowUserPointer(window, app);
     glfwSetCursorPosCallback(window, CursorPosCallback);
     glfwSetMouseButtonCallback(window, MouseButtonCallback);
+    glfwSetScrollCallback(window, ScrollCallback);
     glfwSetKeyCallback(window, KeyCallback);
+    glfwSetWindowRefreshCallback(window, RefreshCallback);
 
     glewExperimental = GL_TRUE;
 
@@ -138,105 +331,241 @@ static GLFWwindow* InitGL()
     return window;
 }
 
-static GLuint LinkShaders()
+static void CursorPosCallback(GLFWwindow* window, double xpos, double ypos)
 {
-    // Vertex shader
-    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
-
-    GLint success;
-    GLchar infoLog[512];
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
-    }
-
-    // Fragment shader
-    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
-
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-        std::cout << "Fragment shader compilation error\n" << infoLog << std::endl;
-    }
-    
-    GLuint shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-        std::cout << "Vertex shader compilation error\n" << infoLog << std::endl;
+    Application* app = static_cast<Application*>(glfwGetWindowUserPointer(window));
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+    if (app->panning) {
+        app->camera.Pan(xpos - app->panX, ypos - app->panY, width, height);
+        app->panX = xpos;
+        app->panY = ypos;
+        UpdateViewport(window);
     }
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
-
-    return shaderProgram;
-}
-
-static int GetObjectIndex(double xpos, double ypos)
-{
-    GLbyte color[4];
-    GLfloat depth;
-    GLuint index;
-
-    glReadPixels(xpos, HEIGHT - ypos - 1, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, color);
-    glReadPixels(xpos, HEIGHT - ypos - 1, 1, 1, GL_DEPTH_COMPONENT, GL_FLOAT, &depth);
-    glReadPixels(xpos, HEIGHT - ypos - 1, 1, 1, GL_STENCIL_INDEX, GL_UNSIGNED_INT, &index);
-
-    return index;
+    app->scene.MouseMove(xpos, ypos, width, height);
 }
 
-static void CursorPosCallback(GLFWwindow* window, double xpos, double ypos)
+// A pick of the background drops the multi-selection, picking an entity is resolved by the scene
+static void ApplyPick(Application& app, GLuint pickedIndex, double xpos, double ypos)
 {
-    int width, height;
-    glfwGetFramebufferSize(window, &width, &height);
-    Scene::Instance().MouseMove(xpos, ypos, width, height);
+    if (pickedIndex == 0)
+        app.scene.ClearGroup();
+    app.scene.SetSelected(pickedIndex, xpos, ypos);
 }
 
 static void MouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
 {
+    Application* app = static_cast<Application*>(glfwGetWindowUserPointer(window));
     if (button == GLFW_MOUSE_BUTTON_LEFT) {
         if (action == GLFW_PRESS) {
             double xpos, ypos;
             glfwGetCursorPos(window, &xpos, &ypos);
-            Scene::Instance().SetSelected(GetObjectIndex(xpos, ypos), xpos, ypos);
+            if (mods & GLFW_MOD_ALT) {
+                int width, height;
+                glfwGetFramebufferSize(window, &width, &height);
+                app->scene.BeginBandSelection(xpos, ypos, width, height, app->lassoMode);
+            }
+            else if (app->vertexMode) {
+                // vertices are found in the scene, no stencil read is needed
+                int width, height;
+                glfwGetFramebufferSize(window, &width, &height);
+                app->scene.SelectVertex(xpos, ypos, width, height);
+            }
+            else if (app->renderThread) {
+                // the stencil is read on the render thread, the result is applied by the main loop
+                app->renderThread->RequestPick(xpos, ypos);
+                app->pickPending = true;
+                app->pickX = xpos;
+                app->pickY = ypos;
+            }
+            else {
+                ApplyPick(*app, app->renderer->ReadStencil(xpos, ypos), xpos, ypos);
+            }
         }
         else if (action == GLFW_RELEASE) {
-            Scene::Instance().SetSelected(0);
+            app->pickPending = false;
+            if (app->scene.IsBandOpen())
+                app->scene.EndBandSelection();
+            app->scene.SetSelected(0);
         }
     }
+    else if (button == GLFW_MOUSE_BUTTON_RIGHT) {
+        app->panning = (action == GLFW_PRESS);
+        glfwGetCursorPos(window, &app->panX, &app->panY);
+    }
+}
+
+static void ScrollCallback(GLFWwindow* window, double, double yoffset)
+{
+    Application* app = static_cast<Application*>(glfwGetWindowUserPointer(window));
+    double xpos, ypos;
+    glfwGetCursorPos(window, &xpos, &ypos);
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+    app->camera.Zoom(float(std::pow(1.2, yoffset)), xpos, ypos, width, height);
+    UpdateViewport(window);
 }
 
 // Is called whenever a key is pressed/released via GLFW
 static void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mode)
 {
+    Application* app = static_cast<Application*>(glfwGetWindowUserPointer(window));
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
         glfwSetWindowShouldClose(window, GL_TRUE);
     }
+    else if (key == GLFW_KEY_D && action == GLFW_PRESS) {
+        app->depthMode = !app->depthMode;
+        app->redrawRequested = true;
+    }
+    else if (key == GLFW_KEY_V && action == GLFW_PRESS) {
+        app->vertexMode = !app->vertexMode;
+        std::cout << (app->vertexMode ? "Vertex editing" : "Entity dragging") << std::endl;
+    }
+    else if (key == GLFW_KEY_S && action == GLFW_PRESS) {
+        app->scene.SetSnapping(!app->scene.IsSnapping());
+        std::cout << "Vertex snapping " << (app->scene.IsSnapping() ? "on" : "off") << std::endl;
+    }
+    else if (key == GLFW_KEY_L && action == GLFW_PRESS) {
+        app->lassoMode = !app->lassoMode;
+        std::cout << (app->lassoMode ? "Lasso selection" : "Rectangle selection") << std::endl;
+    }
+    else if (key == GLFW_KEY_G && action == GLFW_PRESS) {
+        app->scene.GroupSelection();
+    }
+    else if (key == GLFW_KEY_U && action == GLFW_PRESS) {
+        app->scene.CombineGroup(PolygonBoolean::OperationUnion);
+    }
+    else if (key == GLFW_KEY_I && action == GLFW_PRESS) {
+        app->scene.CombineGroup(PolygonBoolean::OperationIntersection);
+    }
+    else if (key == GLFW_KEY_X && action == GLFW_PRESS) {
+        app->scene.CombineGroup(PolygonBoolean::OperationDifference);
+    }
+    else if (key == GLFW_KEY_C && action == GLFW_PRESS) {
+        app->scene.SetCollisions(!app->scene.IsColliding());
+        std::cout << "Collisions " << (app->scene.IsColliding() ? "on" : "off") << std::endl;
+    }
+    else if (key == GLFW_KEY_HOME && action == GLFW_PRESS) {
+        app->camera.Reset();
+        UpdateViewport(window);
+    }
+    else if (key == GLFW_KEY_F5 && action == GLFW_PRESS) {
+        if (SceneFile::Save(app->scene, SNAPSHOT_PATH, true))
+            std::cout << "Scene snapshot saved to " << SNAPSHOT_PATH << std::endl;
+    }
     else if (key == GLFW_KEY_LEFT_CONTROL ||
         key == GLFW_KEY_RIGHT_CONTROL ||
         key == GLFW_KEY_LEFT_SHIFT ||
         key == GLFW_KEY_RIGHT_SHIFT) {
-        Scene::Instance().SetRotationMode(action != GLFW_RELEASE);
+        app->scene.SetRotationMode(action != GLFW_RELEASE);
+    }
+}
+
+static void RefreshCallback(GLFWwindow* window)
+{
+    Application* app = static_cast<Application*>(glfwGetWindowUserPointer(window));
+    app->redrawRequested = true;
+}
+
+// Culling and detail levels follow the camera, the scene raises a redraw when they change
+static void UpdateViewport(GLFWwindow* window)
+{
+    Application* app = static_cast<Application*>(glfwGetWindowUserPointer(window));
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+    glm::vec2 minPoint, maxPoint;
+    app->camera.GetVisibleRect(minPoint, maxPoint);
+    app->scene.SetViewport(minPoint, maxPoint, app->camera.GetPixelSize(width, height));
+}
+
+static void ShowFrameStats(GLFWwindow* window, FrameStats& stats)
+{
+    Application* app = static_cast<Application*>(glfwGetWindowUserPointer(window));
+    std::chrono::duration<double> period = std::chrono::steady_clock::now() - stats.start;
+    if (period.count() < STATS_PERIOD)
+        return;
+
+    if (app->renderThread)
+        app->renderThread->TakeStats(stats.draw);
+
+    const DrawStats& draw = stats.draw;
+    std::ostringstream title;
+    title << "Cubes and polygons - " << draw.framesCount / period.count() << " fps";
+    if (draw.framesCount > 0) {
+        title << ", per frame: "
+            << draw.drawnEntities / draw.framesCount << " entities drawn, " << draw.culledEntities / draw.framesCount << " culled, "
+            << draw.drawnTriangles / draw.framesCount << " triangles drawn, " << draw.culledTriangles / draw.framesCount << " culled, "
+            << draw.simplifiedTriangles / draw.framesCount << " simplified, "
+            << draw.stateCallsIssued / draw.framesCount << " GL state calls issued, " << draw.stateCallsFiltered / draw.framesCount << " filtered";
+        if (app->scene.IsGeometryStreamed()) {
+            title << ", " << draw.streamedBytes / draw.framesCount / 1024 << " KB streamed, "
+                << draw.skippedEntities / draw.framesCount << " entities over budget, " << draw.streamStalls << " stalls";
+        }
+    }
+    if (draw.framesCount > 0) {
+        const char* detailNames[DetailKindsCount] = { "full", "simplified", "impostor" };
+        title << ", LOD entities/triangles";
+        for (int kind = 0; kind < DetailKindsCount; ++kind) {
+            title << " " << detailNames[kind] << " " << draw.detailEntities[kind] / draw.framesCount
+                << "/" << draw.detailTriangles[kind] / draw.framesCount;
+        }
+    }
+    if (draw.gpuTimeFramesCount > 0)
+        title << ", GPU " << draw.gpuTime / draw.gpuTimeFramesCount / 1e6 << " ms per frame";
+    if (draw.fragmentFramesCount > 0) {
+        int width, height;
+        glfwGetFramebufferSize(window, &width, &height);
+        double frameFragments = double(draw.fragmentsCount) / draw.fragmentFramesCount;
+        title << ", " << GLuint64(frameFragments) << " fragments shaded, overdraw " << frameFragments / (width * height)
+            << (app->depthMode ? " (depth mode)" : " (submission order)");
+    }
+    size_t receivedMoves, appliedMoves;
+    app->scene.TakeMouseMoveCounters(receivedMoves, appliedMoves);
+    if (receivedMoves > 0)
+        title << ", cursor events " << receivedMoves << " received, " << appliedMoves << " applied";
+    size_t vertexEdits[PolygonEditor::EditKindsCount];
+    double slowestVertexEdit;
+    app->scene.TakeVertexEditCounters(vertexEdits, slowestVertexEdit);
+    if (vertexEdits[PolygonEditor::EditKept] + vertexEdits[PolygonEditor::EditLocal] +
+        vertexEdits[PolygonEditor::EditFull] + vertexEdits[PolygonEditor::EditRejected] > 0) {
+        title << ", vertex edits kept/local/full/rejected " << vertexEdits[PolygonEditor::EditKept] << "/"
+            << vertexEdits[PolygonEditor::EditLocal] << "/" << vertexEdits[PolygonEditor::EditFull] << "/"
+            << vertexEdits[PolygonEditor::EditRejected] << ", slowest " << slowestVertexEdit << " ms";
     }
+    size_t snapSearches, snapsFound;
+    double slowestSnap;
+    app->scene.TakeSnapCounters(snapSearches, snapsFound, slowestSnap);
+    if (snapSearches > 0)
+        title << ", snapped " << snapsFound << " of " << snapSearches << " moves, slowest " << slowestSnap << " ms";
+    size_t groupMoves;
+    double slowestGroupMove;
+    app->scene.TakeGroupMoveCounters(groupMoves, slowestGroupMove);
+    if (groupMoves > 0)
+        title << ", group of " << app->scene.GetGroupSize() << " moved " << groupMoves << " times, slowest " << slowestGroupMove << " ms";
+    size_t hierarchyNodes, hierarchyEntities;
+    double slowestHierarchyUpdate;
+    app->scene.TakeHierarchyCounters(hierarchyNodes, hierarchyEntities, slowestHierarchyUpdate);
+    if (hierarchyNodes > 0)
+        title << ", hierarchy nodes updated " << hierarchyNodes << ", entities " << hierarchyEntities << ", slowest " << slowestHierarchyUpdate << " ms";
+    size_t collisionMoves, blockedMoves;
+    double slowestCollision;
+    app->scene.TakeCollisionCounters(collisionMoves, blockedMoves, slowestCollision);
+    if (collisionMoves > 0)
+        title << ", collision checked moves " << collisionMoves << ", blocked " << blockedMoves << ", slowest " << slowestCollision << " ms";
+    // share of the time the main thread was blocked waiting for events, the CPU is idle then
+    title << ", idle " << int(100.0 * stats.waitTime.count() / period.count()) << "%";
+    glfwSetWindowTitle(window, title.str().c_str());
+
+    stats = FrameStats();
 }
 
-static void AddTestData()
+static void AddTestData(Scene& scene)
 {
-    Scene::Instance().AddEntity(std::shared_ptr<Entity>(
+    scene.AddEntity(std::shared_ptr<Entity>(
         new Cube(glm::vec3(-0.5, 0.5, 0.0), 0.3, glm::vec3(1.0, 1.0, 1.0), glm::vec3(5.0, 0.0, 0.0)
     )));
     
-    Scene::Instance().AddEntity(std::shared_ptr<Entity>(
+    scene.AddEntity(std::shared_ptr<Entity>(
         new Cube(glm::vec3(0.5, 0.0, 0.0), 0.2, glm::vec3(1.0, 0.5, -1.0), glm::vec3(0.0, 0.2, 0.0)
     )));
     
@@ -245,7 +574,7 @@ static void AddTestData()
     vertices[1] = glm::vec2(0.1, 0.2);
     vertices[2] = glm::vec2(-0.1, -0.2);
     vertices[3] = glm::vec2(-0.2, -0.2);
-    Scene::Instance().AddEntity(std::shared_ptr<Entity>(new Polygon2D(vertices)));
+    scene.AddEntity(std::shared_ptr<Entity>(new Polygon2D(vertices)));
     
     vertices.resize(5);
     vertices[0] = glm::vec2(0.1, -0.4);
@@ -253,5 +582,5 @@ static void AddTestData()
     vertices[2] = glm::vec2(0.5, -0.5);
     vertices[3] = glm::vec2(0.4, -0.1);
     vertices[4] = glm::vec2(0.1, -0.1);
-    Scene::Instance().AddEntity(std::shared_ptr<Entity>(new Polygon2D(vertices)));
+    scene.AddEntity(std::shared_ptr<Entity>(new Polygon2D(vertices)));
 }
\ No newline at end of file
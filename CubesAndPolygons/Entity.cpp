@@ -1 +1,15 @@
 #include "Entity.h"
+
+void Entity::GetWorldBounds(glm::vec3& minPoint, glm::vec3& maxPoint) const
+{
+    glm::vec3 localMin, localMax;
+    GetBounds(localMin, localMax);
+
+    glm::mat4 transform = GetTransform();
+    for (int i = 0; i < 8; ++i) {
+        glm::vec4 corner((i & 1) ? localMax.x : localMin.x, (i & 2) ? localMax.y : localMin.y, (i & 4) ? localMax.z : localMin.z, 1.0);
+        glm::vec3 point = glm::vec3(transform * corner);
+        minPoint = (i == 0) ? point : glm::min(minPoint, point);
+        maxPoint = (i == 0) ? point : glm::max(maxPoint, point);
+    }
+}
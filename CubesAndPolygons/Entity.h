@@ -4,6 +4,21 @@
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 
+#include <vector>
+
+// Coarser version of the entity geometry drawn when it is small on the screen
+struct DetailLevel
+{
+    // the level is used while a screen pixel is at least this large, in entity units;
+    // for simplified outlines it is the largest distance from the full one
+    float tolerance;
+    // drawn facing the screen without the entity rotation
+    bool impostor;
+    GLsizei verticesCount;
+    // triangles like the full geometry, 3 floats per vertex; released once the scene does not need them
+    std::vector<GLfloat> vertices;
+};
+
 struct Entity
 {
     Entity() {}
@@ -13,10 +28,29 @@ struct Entity
     virtual void Accept(Visitor *visitor) const = 0;
     virtual void Rotate(float xdiff, float ydiff) = 0;
     virtual const float* GetColor() const = 0;
+    // closed meshes are drawn with back-face culling
+    virtual bool IsClosed() const { return false; }
+    // axis aligned bounds of the triangulated geometry before translation and rotation
+    virtual void GetBounds(glm::vec3& minPoint, glm::vec3& maxPoint) const = 0;
+    // corners of the geometry before translation and rotation, the targets of vertex snapping
+    virtual void GetVertices(std::vector<glm::vec3>& vertices) const = 0;
+
+    void GetWorldBounds(glm::vec3& minPoint, glm::vec3& maxPoint) const;
+    // Detail levels of the current geometry, finer levels first. The entity is not changed,
+    // so the triangulation worker builds them while the entity is drawn.
+    virtual void BuildDetailLevels(std::vector<DetailLevel>& levels) const { levels.clear(); }
+    // at least as many vertices as BuildDetailLevels gives, reserved when the levels are built after the entity is added
+    virtual GLsizei GetDetailVerticesLimit() const { return 0; }
+
+    std::vector<DetailLevel> detailLevels;
 
     //if space memory is limited, rotation matrix could be removed and created dynamically,
     //but need to triangulate on the end of rotation
     glm::mat4 rotation;
     glm::mat4 translation;
+    // world transform of the hierarchy node the entity is attached to, identity if there is none; set by Scene
+    glm::mat4 groupTransform;
+
+    glm::mat4 GetTransform() const { return groupTransform * translation * rotation; }
 };
 
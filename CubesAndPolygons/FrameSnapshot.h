@@ -0,0 +1,61 @@
+#pragma once
+#include "VertexFormat.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// How entities were drawn: full geometry, a simplified outline or an impostor
+enum DetailKind
+{
+    DetailFull = 0,
+    DetailSimplified = 1,
+    DetailImpostor = 2,
+    DetailKindsCount = 3
+};
+
+// One entity as it is drawn in a frame
+struct DrawItem
+{
+    // includes decoding of the packed vertices
+    glm::mat4 transform;
+    glm::vec4 color;
+    VertexFormat format;
+    GLint firstVertex;
+    GLsizei verticesCount;
+    // written to the stencil buffer for picking, entity index + 1
+    GLint stencilId;
+    bool closed;
+};
+
+// Immutable copy of everything needed to draw a frame, built by Scene::BuildFrameSnapshot,
+// so drawing does not read the scene while it is being changed
+struct FrameSnapshot
+{
+    // visible entities in draw order
+    std::vector<DrawItem> items;
+    // camera, maps the visible world rectangle to clip space
+    glm::mat4 viewProjection;
+    bool depthMode = true;
+    // set when the render thread publishes the snapshot, counts the published snapshots from 1
+    size_t sequence = 0;
+    size_t entitiesCount = 0;
+    size_t trianglesCount = 0;
+    // triangles of the visible entities left out by drawing detail levels
+    size_t simplifiedTriangles = 0;
+    // items and their triangles per DetailKind
+    size_t detailEntities[DetailKindsCount] = {};
+    size_t detailTriangles[DetailKindsCount] = {};
+
+    // Streamed geometry mode: triangles of the items expanded for this frame, every item starts
+    // on an 8 byte boundary and its firstVertex is relative to the start, in vertices of its format
+    std::vector<GLushort> streamedVertices;
+    // size of the renderer ring buffer in bytes, 0 if the geometry is resident on the GPU
+    size_t streamBudget = 0;
+    // visible entities left out because the frame exceeded its share of the budget
+    size_t skippedEntities = 0;
+
+    // rubber band of multi-selection in world coordinates drawn as a closed line, empty if there is none
+    std::vector<glm::vec2> selectionOutline;
+};
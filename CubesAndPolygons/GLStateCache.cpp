@@ -0,0 +1,81 @@
+#define GLEW_STATIC
+#include "GLStateCache.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+void GLStateCache::SetEnabled(GLenum capability, bool enabled)
+{
+    if (!Update(capabilities[capability], enabled))
+        return;
+    if (enabled)
+        glEnable(capability);
+    else
+        glDisable(capability);
+}
+
+void GLStateCache::DepthFunc(GLenum func)
+{
+    if (Update(depthFunc, func))
+        glDepthFunc(func);
+}
+
+void GLStateCache::FrontFace(GLenum mode)
+{
+    if (Update(frontFace, mode))
+        glFrontFace(mode);
+}
+
+void GLStateCache::CullFace(GLenum mode)
+{
+    if (Update(cullFace, mode))
+        glCullFace(mode);
+}
+
+void GLStateCache::StencilOp(GLenum stencilFail, GLenum depthFail, GLenum depthPass)
+{
+    if (Update(stencilOp, std::make_tuple(stencilFail, depthFail, depthPass)))
+        glStencilOp(stencilFail, depthFail, depthPass);
+}
+
+void GLStateCache::StencilFunc(GLenum func, GLint ref, GLuint mask)
+{
+    if (Update(stencilFunc, std::make_tuple(func, ref, mask)))
+        glStencilFunc(func, ref, mask);
+}
+
+void GLStateCache::ClearColor(const glm::vec4& color)
+{
+    if (Update(clearColor, color))
+        glClearColor(color.r, color.g, color.b, color.a);
+}
+
+void GLStateCache::ClearStencil(GLint value)
+{
+    if (Update(clearStencil, value))
+        glClearStencil(value);
+}
+
+void GLStateCache::UseProgram(GLuint value)
+{
+    if (Update(program, value))
+        glUseProgram(value);
+}
+
+void GLStateCache::BindVertexArray(GLuint value)
+{
+    if (Update(vertexArray, value))
+        glBindVertexArray(value);
+}
+
+void GLStateCache::Uniform4fv(GLint location, const glm::vec4& value)
+{
+    if (Update(uniforms[std::make_pair(program.value, location)], value))
+        glUniform4fv(location, 1, glm::value_ptr(value));
+}
+
+void GLStateCache::TakeCounters(size_t& issued, size_t& filtered)
+{
+    issued = issuedCalls;
+    filtered = filteredCalls;
+    issuedCalls = filteredCalls = 0;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <map>
+#include <tuple>
+#include <utility>
+
+// Shadows the GL state set through it and drops calls that would not change anything,
+// so the driver only sees actual state changes. The state it shadows is only ever set
+// through it; buffer bindings, which other code binds directly, are not shadowed.
+class GLStateCache
+{
+public:
+    void SetEnabled(GLenum capability, bool enabled);
+    void DepthFunc(GLenum func);
+    void FrontFace(GLenum mode);
+    void CullFace(GLenum mode);
+    void StencilOp(GLenum stencilFail, GLenum depthFail, GLenum depthPass);
+    void StencilFunc(GLenum func, GLint ref, GLuint mask);
+    void ClearColor(const glm::vec4& color);
+    void ClearStencil(GLint value);
+    void UseProgram(GLuint program);
+    void BindVertexArray(GLuint vertexArray);
+    // uniforms belong to the current program
+    void Uniform4fv(GLint location, const glm::vec4& value);
+
+    // Calls passed to GL and dropped since the last call
+    void TakeCounters(size_t& issued, size_t& filtered);
+
+private:
+    template <typename T>
+    struct Cached
+    {
+        T value;
+        bool known = false;
+    };
+
+    // Returns true if the call has to be issued
+    template <typename T>
+    bool Update(Cached<T>& cached, const T& value)
+    {
+        if (cached.known && cached.value == value) {
+            ++filteredCalls;
+            return false;
+        }
+        cached.value = value;
+        cached.known = true;
+        ++issuedCalls;
+        return true;
+    }
+
+    std::map<GLenum, Cached<bool>> capabilities;
+    Cached<GLenum> depthFunc;
+    Cached<GLenum> frontFace;
+    Cached<GLenum> cullFace;
+    Cached<std::tuple<GLenum, GLenum, GLenum>> stencilOp;
+    Cached<std::tuple<GLenum, GLint, GLuint>> stencilFunc;
+    Cached<glm::vec4> clearColor;
+    Cached<GLint> clearStencil;
+    Cached<GLuint> program;
+    Cached<GLuint> vertexArray;
+    std::map<std::pair<GLuint, GLint>, Cached<glm::vec4>> uniforms;
+
+    size_t issuedCalls = 0;
+    size_t filteredCalls = 0;
+};
@@ -0,0 +1,46 @@
+#include "Lasso.h"
+
+#include <algorithm>
+
+Lasso::Lasso(const std::vector<glm::vec2>& iPoints) : points(iPoints)
+{
+    if (points.empty())
+        return;
+    minPoint = maxPoint = points[0];
+    for (const glm::vec2& point : points) {
+        minPoint = glm::min(minPoint, point);
+        maxPoint = glm::max(maxPoint, point);
+    }
+
+    // about as many rows as edges, a row then holds a few edges of a hand drawn outline
+    rows.resize(points.size());
+    rowHeight = std::max((maxPoint.y - minPoint.y) / rows.size(), 1e-30f);
+    for (size_t i = 0; i < points.size(); ++i) {
+        const glm::vec2& a = points[i];
+        const glm::vec2& b = points[(i + 1) % points.size()];
+        size_t last = GetRow(std::max(a.y, b.y));
+        for (size_t row = GetRow(std::min(a.y, b.y)); row <= last; ++row)
+            rows[row].push_back(uint32_t(i));
+    }
+}
+
+bool Lasso::Contains(const glm::vec2& point) const
+{
+    if (points.size() < 3 || glm::any(glm::lessThan(point, minPoint)) || glm::any(glm::greaterThan(point, maxPoint)))
+        return false;
+
+    bool inside = false;
+    for (uint32_t i : rows[GetRow(point.y)]) {
+        const glm::vec2& a = points[i];
+        const glm::vec2& b = points[(i + 1) % points.size()];
+        if ((a.y > point.y) != (b.y > point.y) && point.x < a.x + (point.y - a.y) * (b.x - a.x) / (b.y - a.y))
+            inside = !inside;
+    }
+    return inside;
+}
+
+size_t Lasso::GetRow(float y) const
+{
+    size_t row = size_t(std::max(0.0f, (y - minPoint.y) / rowHeight));
+    return std::min(row, rows.size() - 1);
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Closed outline drawn with the cursor for selecting what is inside of it. Edges are bucketed
+// into horizontal rows, so testing a point crosses only the edges of its row.
+class Lasso
+{
+public:
+    explicit Lasso(const std::vector<glm::vec2>& iPoints);
+
+    // even-odd rule, self-intersecting outlines leave the doubly surrounded parts out
+    bool Contains(const glm::vec2& point) const;
+
+    const glm::vec2& GetMin() const { return minPoint; }
+    const glm::vec2& GetMax() const { return maxPoint; }
+
+private:
+    size_t GetRow(float y) const;
+
+    std::vector<glm::vec2> points;
+    glm::vec2 minPoint = glm::vec2(0.0);
+    glm::vec2 maxPoint = glm::vec2(0.0);
+    float rowHeight = 1.0f;
+    // edges crossing every row as the index of their first point
+    std::vector<std::vector<uint32_t>> rows;
+};
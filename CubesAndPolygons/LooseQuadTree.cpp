@@ -0,0 +1,140 @@
+#include "LooseQuadTree.h"
+
+#include <algorithm>
+
+LooseQuadTree::LooseQuadTree(const glm::vec2& iMinPoint, const glm::vec2& iMaxPoint, int iLevels)
+: minPoint(iMinPoint), size(iMaxPoint - iMinPoint), levels(iLevels)
+{
+    size_t cellsCount = 0;
+    for (int level = 0; level < levels; ++level) {
+        levelOffsets.push_back(cellsCount);
+        cellsCount += size_t(1) << (2 * level);
+    }
+    cells.resize(cellsCount);
+}
+
+void LooseQuadTree::Insert(size_t id, const glm::vec2& itemMin, const glm::vec2& itemMax)
+{
+    if (id >= items.size())
+        items.resize(id + 1);
+
+    Item& item = items[id];
+    if (item.cell != NoCell) {
+        // most moves stay in the same cell
+        Update(id, itemMin, itemMax);
+        return;
+    }
+    item.minPoint = itemMin;
+    item.maxPoint = itemMax;
+    Link(id, FindCell(itemMin, itemMax));
+}
+
+void LooseQuadTree::Update(size_t id, const glm::vec2& itemMin, const glm::vec2& itemMax)
+{
+    Item& item = items[id];
+    item.minPoint = itemMin;
+    item.maxPoint = itemMax;
+
+    size_t cell = FindCell(itemMin, itemMax);
+    if (cell != item.cell) {
+        Unlink(id);
+        Link(id, cell);
+    }
+}
+
+void LooseQuadTree::Remove(size_t id)
+{
+    if (id < items.size() && items[id].cell != NoCell)
+        Unlink(id);
+}
+
+void LooseQuadTree::Clear()
+{
+    for (std::vector<size_t>& cell : cells)
+        cell.clear();
+    items.clear();
+}
+
+void LooseQuadTree::Query(const glm::vec2& queryMin, const glm::vec2& queryMax, std::vector<size_t>& result) const
+{
+    for (int level = 0; level < levels; ++level) {
+        int resolution = 1 << level;
+        glm::vec2 cellSize = size / float(resolution);
+
+        // loose cells reach half of a cell beyond their bounds
+        glm::vec2 from = (queryMin - minPoint - cellSize * 0.5f) / cellSize;
+        glm::vec2 to = (queryMax - minPoint + cellSize * 0.5f) / cellSize;
+        // the root also keeps items outside of the tree region, so it is always checked
+        if (level > 0 && (to.x < 0.0f || to.y < 0.0f || from.x >= resolution || from.y >= resolution))
+            continue;
+
+        float last = float(resolution - 1);
+        int xFrom = int(glm::clamp(from.x, 0.0f, last)), yFrom = int(glm::clamp(from.y, 0.0f, last));
+        int xTo = int(glm::clamp(to.x, 0.0f, last)), yTo = int(glm::clamp(to.y, 0.0f, last));
+        for (int y = yFrom; y <= yTo; ++y) {
+            const std::vector<size_t>* row = &cells[levelOffsets[level] + size_t(y) * resolution];
+            for (int x = xFrom; x <= xTo; ++x) {
+                for (size_t id : row[x]) {
+                    const Item& item = items[id];
+                    if (item.minPoint.x <= queryMax.x && item.maxPoint.x >= queryMin.x &&
+                        item.minPoint.y <= queryMax.y && item.maxPoint.y >= queryMin.y)
+                        result.push_back(id);
+                }
+            }
+        }
+    }
+}
+
+void LooseQuadTree::GetBounds(size_t id, glm::vec2& itemMin, glm::vec2& itemMax) const
+{
+    itemMin = items[id].minPoint;
+    itemMax = items[id].maxPoint;
+}
+
+bool LooseQuadTree::Contains(const glm::vec2& itemMin, const glm::vec2& itemMax) const
+{
+    return itemMin.x >= minPoint.x && itemMin.y >= minPoint.y &&
+        itemMax.x <= minPoint.x + size.x && itemMax.y <= minPoint.y + size.y;
+}
+
+size_t LooseQuadTree::FindCell(const glm::vec2& itemMin, const glm::vec2& itemMax) const
+{
+    if (!Contains(itemMin, itemMax))
+        return 0;
+
+    glm::vec2 extent = itemMax - itemMin;
+    glm::vec2 center = (itemMin + itemMax) * 0.5f - minPoint;
+
+    int level = 0;
+    while (level + 1 < levels) {
+        glm::vec2 cellSize = size / float(1 << (level + 1));
+        if (extent.x > cellSize.x || extent.y > cellSize.y)
+            break;
+        ++level;
+    }
+
+    int resolution = 1 << level;
+    glm::vec2 cellSize = size / float(resolution);
+    float last = float(resolution - 1);
+    int x = int(glm::clamp(center.x / cellSize.x, 0.0f, last));
+    int y = int(glm::clamp(center.y / cellSize.y, 0.0f, last));
+    return levelOffsets[level] + size_t(y) * resolution + x;
+}
+
+void LooseQuadTree::Link(size_t id, size_t cell)
+{
+    items[id].cell = cell;
+    items[id].slot = cells[cell].size();
+    cells[cell].push_back(id);
+}
+
+void LooseQuadTree::Unlink(size_t id)
+{
+    Item& item = items[id];
+    std::vector<size_t>& cell = cells[item.cell];
+    size_t last = cell.back();
+    cell[item.slot] = last;
+    items[last].slot = item.slot;
+    cell.pop_back();
+    item.cell = NoCell;
+}
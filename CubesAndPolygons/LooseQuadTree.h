@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Loose quadtree over 2D axis aligned bounds.
+// An item is stored in the deepest level whose cell is not smaller than the item, in the cell
+// containing the item center; cells are loose by half of their size on every side, so items
+// never need to be split and moving an item is a constant time relink.
+class LooseQuadTree
+{
+public:
+    LooseQuadTree(const glm::vec2& iMinPoint, const glm::vec2& iMaxPoint, int iLevels = 8);
+
+    // Adds the item or updates it if it is in the tree already
+    void Insert(size_t id, const glm::vec2& minPoint, const glm::vec2& maxPoint);
+    void Update(size_t id, const glm::vec2& minPoint, const glm::vec2& maxPoint);
+    void Remove(size_t id);
+    void Clear();
+
+    // Appends ids of items overlapping the region
+    void Query(const glm::vec2& minPoint, const glm::vec2& maxPoint, std::vector<size_t>& result) const;
+
+    // Bounds of an item in the tree
+    void GetBounds(size_t id, glm::vec2& minPoint, glm::vec2& maxPoint) const;
+
+    // false if the bounds are outside of the tree region, such items are kept in the root
+    bool Contains(const glm::vec2& minPoint, const glm::vec2& maxPoint) const;
+
+private:
+    struct Item
+    {
+        glm::vec2 minPoint;
+        glm::vec2 maxPoint;
+        size_t cell = NoCell;
+        size_t slot = 0;
+    };
+
+    static const size_t NoCell = size_t(-1);
+
+    size_t FindCell(const glm::vec2& minPoint, const glm::vec2& maxPoint) const;
+    void Link(size_t id, size_t cell);
+    void Unlink(size_t id);
+
+    glm::vec2 minPoint;
+    glm::vec2 size;
+    int levels;
+    // cells of all levels, level l starts at levelOffsets[l] and has 2^l x 2^l cells
+    std::vector<size_t> levelOffsets;
+    std::vector<std::vector<size_t>> cells;
+    std::vector<Item> items;
+};
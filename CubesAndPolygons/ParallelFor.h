@@ -0,0 +1,21 @@
+#pragma once
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+// Calls process(begin, end) for consecutive chunks of [0, count) on up to threadsCount threads,
+// the calling thread takes the first chunk. A thread is added for every minChunk items, so short
+// ranges stay on the calling thread. threadsCount == 0 means one thread per hardware core.
+template <typename Process>
+void ParallelFor(size_t count, unsigned threadsCount, size_t minChunk, Process process)
+{
+    size_t chunksCount = threadsCount ? threadsCount : std::max(1u, std::thread::hardware_concurrency());
+    chunksCount = std::min(chunksCount, count / minChunk + 1);
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < chunksCount; ++t)
+        threads.emplace_back(process, count * t / chunksCount, count * (t + 1) / chunksCount);
+    process(size_t(0), count / chunksCount);
+    for (std::thread& thread : threads)
+        thread.join();
+}
@@ -1,7 +1,86 @@
 #include "Polygon2D.h"
+#include "TriangulationVisitor.h"
+
+#include <algorithm>
+#include <cmath>
 
 #include <glm/gtc/matrix_transform.hpp>
 
+namespace
+{
+    float DistanceToSegment(const glm::vec2& point, const glm::vec2& a, const glm::vec2& b)
+    {
+        glm::vec2 segment = b - a;
+        float lengthSquared = glm::dot(segment, segment);
+        float t = lengthSquared > 0.0f ? glm::clamp(glm::dot(point - a, segment) / lengthSquared, 0.0f, 1.0f) : 0.0f;
+        return glm::length(point - (a + segment * t));
+    }
+
+    float GetOutlineArea(const std::vector<glm::vec2>& points)
+    {
+        float area = 0.0f;
+        for (size_t i = 0; i < points.size(); ++i) {
+            const glm::vec2& next = points[(i + 1) % points.size()];
+            area += points[i].x * next.y - next.x * points[i].y;
+        }
+        return area / 2.0f;
+    }
+
+    // sum of unsigned areas, equal to the outline area unless triangles overlap
+    float GetTrianglesArea(const std::vector<GLfloat>& vertices)
+    {
+        float area = 0.0f;
+        for (size_t i = 0; i + 9 <= vertices.size(); i += 9) {
+            glm::vec2 a(vertices[i], vertices[i + 1]), b(vertices[i + 3], vertices[i + 4]), c(vertices[i + 6], vertices[i + 7]);
+            area += std::abs((b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y)) / 2.0f;
+        }
+        return area;
+    }
+
+    // Douglas-Peucker on a closed ring, split at the point farthest from the first one
+    std::vector<glm::vec2> SimplifyOutline(const std::vector<glm::vec2>& points, float tolerance)
+    {
+        size_t count = points.size();
+        size_t farthest = 0;
+        for (size_t i = 1; i < count; ++i) {
+            if (glm::length(points[i] - points[0]) > glm::length(points[farthest] - points[0]))
+                farthest = i;
+        }
+
+        std::vector<bool> keep(count, false);
+        keep[0] = keep[farthest] = true;
+        // chain ends, index count stands for the first point closing the ring
+        std::vector<std::pair<size_t, size_t>> chains = { { 0, farthest }, { farthest, count } };
+        while (!chains.empty()) {
+            size_t first = chains.back().first;
+            size_t last = chains.back().second;
+            chains.pop_back();
+
+            size_t worst = 0;
+            float worstDistance = tolerance;
+            for (size_t i = first + 1; i < last; ++i) {
+                float distance = DistanceToSegment(points[i], points[first], points[last % count]);
+                if (distance > worstDistance) {
+                    worst = i;
+                    worstDistance = distance;
+                }
+            }
+            if (worst) {
+                keep[worst] = true;
+                chains.push_back({ first, worst });
+                chains.push_back({ worst, last });
+            }
+        }
+
+        std::vector<glm::vec2> simplified;
+        for (size_t i = 0; i < count; ++i) {
+            if (keep[i])
+                simplified.push_back(points[i]);
+        }
+        return simplified;
+    }
+}
+
 Polygon2D::Polygon2D(const std::vector<glm::vec2> iPoints) : points(iPoints)
 {
     if (iPoints.size() < 3)
@@ -19,6 +98,11 @@ Polygon2D::Polygon2D(const std::vector<glm::vec2> iPoints) : points(iPoints)
     }
 }
 
+Polygon2D::Polygon2D(const std::vector<glm::vec2>& iLocalPoints, const glm::mat4& iTranslation) : points(iLocalPoints)
+{
+    translation = iTranslation;
+}
+
 glm::vec2 Polygon2D::GetCenter() const
 {
     glm::vec2 minPoint = points[0];
@@ -42,8 +126,65 @@ GLsizei Polygon2D::GetTrianglesCount() const
     return (points.size() - 2);
 }
 
+void Polygon2D::GetBounds(glm::vec3& minPoint, glm::vec3& maxPoint) const
+{
+    minPoint = maxPoint = glm::vec3(0.0);
+    for (size_t i = 0; i < points.size(); ++i) {
+        minPoint = glm::min(minPoint, glm::vec3(points[i], 0.0));
+        maxPoint = glm::max(maxPoint, glm::vec3(points[i], 0.0));
+    }
+}
+
+void Polygon2D::GetVertices(std::vector<glm::vec3>& vertices) const
+{
+    vertices.resize(points.size());
+    for (size_t i = 0; i < points.size(); ++i)
+        vertices[i] = glm::vec3(points[i], 0.0);
+}
+
 void Polygon2D::Rotate(float xdiff, float ydiff)
 {
     glm::mat4 rotation_z = glm::rotate(glm::mat4(1.0f), xdiff + ydiff, glm::vec3(0.0, 0.0, 1.0));
     rotation = rotation_z * rotation;
 }
+
+void Polygon2D::BuildDetailLevels(std::vector<DetailLevel>& levels) const
+{
+    levels.clear();
+    if (points.size() < DetailMinPoints)
+        return;
+
+    glm::vec3 minPoint, maxPoint;
+    GetBounds(minPoint, maxPoint);
+    float size = std::max(maxPoint.x - minPoint.x, maxPoint.y - minPoint.y);
+
+    size_t previousCount = points.size();
+    for (float tolerance = size / 256.0f; tolerance <= size / 4.0f; tolerance *= 4.0f) {
+        std::vector<glm::vec2> simplified = SimplifyOutline(points, tolerance);
+        if (simplified.size() < 3)
+            break;
+        if (simplified.size() * 2 > previousCount)
+            continue;
+
+        Polygon2D outline(simplified, glm::mat4(1.0f));
+
+        DetailLevel level;
+        level.tolerance = tolerance;
+        level.impostor = false;
+        level.verticesCount = outline.GetTrianglesCount() * 3;
+        level.vertices.resize(level.verticesCount * 3);
+        TriangulationVisitor traingulation(level.vertices, 0);
+        outline.Accept(&traingulation);
+        // the simplified outline may intersect itself, then its triangles overlap
+        if (GetTrianglesArea(level.vertices) > std::abs(GetOutlineArea(simplified)) * 1.001f)
+            continue;
+
+        levels.push_back(std::move(level));
+        previousCount = simplified.size();
+    }
+}
+
+GLsizei Polygon2D::GetDetailVerticesLimit() const
+{
+    return points.size() < DetailMinPoints ? 0 : GetTrianglesCount() * 3;
+}
@@ -7,6 +7,8 @@
 
 struct Polygon2D : public Entity {
     Polygon2D(const std::vector<glm::vec2> iPoints);
+    // iLocalPoints - relative to the entity origin already, they are kept as they are
+    Polygon2D(const std::vector<glm::vec2>& iLocalPoints, const glm::mat4& iTranslation);
 
     glm::vec2 GetCenter() const; //as rotation point
 
@@ -15,10 +17,21 @@ struct Polygon2D : public Entity {
         visitor->VisitPolygon2D(this);
     }
     void Rotate(float xdiff, float ydiff) override;
+    void GetBounds(glm::vec3& minPoint, glm::vec3& maxPoint) const override;
+    // the outline points, in their order
+    void GetVertices(std::vector<glm::vec3>& vertices) const override;
+    // Outlines simplified with Douglas-Peucker at growing tolerances, a level is kept
+    // only if it has at most half of the points of the previous one
+    void BuildDetailLevels(std::vector<DetailLevel>& levels) const override;
+    // every level has at most half of the triangles of the one before, so all of them fit the full geometry
+    GLsizei GetDetailVerticesLimit() const override;
     const float* GetColor() const override {
         static float color[4] = { 1.0f, 0.5f, 0.2f, 1.0f };
         return &color[0];
     }
 
     std::vector<glm::vec2> points;
+
+    // smaller polygons are cheap enough at any size
+    static const size_t DetailMinPoints = 32;
 };
@@ -0,0 +1,567 @@
+#include "PolygonBoolean.h"
+#include "Predicates.h"
+
+#include <algorithm>
+#include <cmath>
+#include <set>
+
+#include <glm/gtc/constants.hpp>
+
+// used by reference in assign
+const uint32_t PolygonBoolean::NoIndex;
+
+namespace
+{
+    bool LexLess(const glm::vec2& a, const glm::vec2& b)
+    {
+        return a.x < b.x || (a.x == b.x && a.y < b.y);
+    }
+
+    double GetArea(const std::vector<glm::vec2>& ring)
+    {
+        double area = 0.0;
+        for (size_t i = 0; i < ring.size(); ++i) {
+            const glm::vec2& next = ring[(i + 1) % ring.size()];
+            area += double(ring[i].x) * next.y - double(next.x) * ring[i].y;
+        }
+        return area / 2.0;
+    }
+
+    // p is on the line of the edge, true if it is strictly between its ends
+    bool IsWithin(const glm::vec2& from, const glm::vec2& to, const glm::vec2& p)
+    {
+        if (p == from || p == to)
+            return false;
+        glm::dvec2 direction = glm::dvec2(to) - glm::dvec2(from);
+        return glm::dot(glm::dvec2(p) - glm::dvec2(from), direction) > 0.0 &&
+            glm::dot(glm::dvec2(to) - glm::dvec2(p), direction) > 0.0;
+    }
+
+    bool IsInside(PolygonBoolean::Operation operation, int subject, int clip)
+    {
+        bool inSubject = subject != 0, inClip = clip != 0;
+        switch (operation) {
+        case PolygonBoolean::OperationUnion:
+            return inSubject || inClip;
+        case PolygonBoolean::OperationIntersection:
+            return inSubject && inClip;
+        default:
+            return inSubject && !inClip;
+        }
+    }
+}
+
+bool PolygonBoolean::SweepOrder::operator()(uint32_t a, uint32_t b) const
+{
+    if (a == b)
+        return false;
+    const SweepEdge& first = (*edges)[a];
+    const SweepEdge& second = (*edges)[b];
+    // the edge that starts later is placed against the line of the other one
+    double orientation;
+    if (first.left == second.left)
+        orientation = Predicates::Orient2D(first.left, first.right, second.right);
+    else if (LexLess(first.left, second.left)) {
+        orientation = Predicates::Orient2D(first.left, first.right, second.left);
+        if (orientation == 0.0)
+            orientation = Predicates::Orient2D(first.left, first.right, second.right);
+    }
+    else {
+        orientation = -Predicates::Orient2D(second.left, second.right, first.left);
+        if (orientation == 0.0)
+            orientation = -Predicates::Orient2D(second.left, second.right, first.right);
+    }
+    if (orientation != 0.0)
+        return orientation > 0.0;
+    return a < b;
+}
+
+void PolygonBoolean::Compute(Operation operation, const std::vector<Ring>& subject, const std::vector<Ring>& clip, std::vector<Ring>& result)
+{
+    result.clear();
+    edges.clear();
+    intersectionsCount = 0;
+    holesCount = 0;
+    AddRings(subject, 0);
+    AddRings(clip, 1);
+    edgesCount = edges.size();
+
+    for (int pass = 0; pass < MaxSplitPasses; ++pass) {
+        if (!SplitEdges(pass > 0))
+            break;
+    }
+    BuildSweepEdges();
+    Sweep(operation);
+    std::vector<uint32_t> rings;
+    LinkRings(rings);
+    JoinHoles(rings, result);
+}
+
+void PolygonBoolean::AddRings(const std::vector<Ring>& rings, uint32_t operand)
+{
+    for (const Ring& ring : rings) {
+        double area = GetArea(ring);
+        if (ring.size() < 3 || area == 0.0)
+            continue;
+        for (size_t i = 0; i < ring.size(); ++i) {
+            const glm::vec2& from = ring[i];
+            const glm::vec2& to = ring[(i + 1) % ring.size()];
+            if (from == to)
+                continue;
+            Edge edge = { area > 0.0 ? from : to, area > 0.0 ? to : from, operand, false };
+            edges.push_back(edge);
+        }
+    }
+}
+
+bool PolygonBoolean::SplitEdges(bool splitOnly)
+{
+    // rings of one operand may cross each other too, so all pairs are candidates: edges are sorted into
+    // horizontal strips about twice as high as an average edge and swept along x in every strip,
+    // a pair is tested only in the lowest strip both edges reach
+    if (edges.empty())
+        return false;
+    float minY = edges[0].from.y, maxY = minY;
+    double extent = 0.0;
+    for (const Edge& edge : edges) {
+        minY = std::min(minY, std::min(edge.from.y, edge.to.y));
+        maxY = std::max(maxY, std::max(edge.from.y, edge.to.y));
+        extent += std::abs(edge.to.y - edge.from.y);
+    }
+    // at most one strip per edge
+    float height = std::max(float(2.0 * extent / edges.size()), (maxY - minY) / edges.size());
+    if (!(height > 0.0f))
+        height = 1.0f;
+    uint32_t stripsCount = uint32_t((maxY - minY) / height) + 1;
+    auto getStrip = [&](float y) { return std::min(uint32_t((y - minY) / height), stripsCount - 1); };
+
+    lowStrips.resize(edges.size());
+    stripStarts.assign(stripsCount + 1, 0);
+    for (uint32_t i = 0; i < edges.size(); ++i) {
+        lowStrips[i] = getStrip(std::min(edges[i].from.y, edges[i].to.y));
+        uint32_t highStrip = getStrip(std::max(edges[i].from.y, edges[i].to.y));
+        for (uint32_t strip = lowStrips[i]; strip <= highStrip; ++strip)
+            ++stripStarts[strip + 1];
+    }
+    for (uint32_t strip = 0; strip < stripsCount; ++strip)
+        stripStarts[strip + 1] += stripStarts[strip];
+    order.resize(stripStarts.back());
+    {
+        std::vector<uint32_t> fill(stripStarts.begin(), stripStarts.end() - 1);
+        for (uint32_t i = 0; i < edges.size(); ++i) {
+            uint32_t highStrip = getStrip(std::max(edges[i].from.y, edges[i].to.y));
+            for (uint32_t strip = lowStrips[i]; strip <= highStrip; ++strip)
+                order[fill[strip]++] = i;
+        }
+    }
+
+    splits.clear();
+    for (uint32_t strip = 0; strip < stripsCount; ++strip) {
+        auto first = order.begin() + stripStarts[strip], last = order.begin() + stripStarts[strip + 1];
+        std::sort(first, last, [this](uint32_t a, uint32_t b) {
+            return std::min(edges[a].from.x, edges[a].to.x) < std::min(edges[b].from.x, edges[b].to.x);
+        });
+        active.clear();
+        for (auto it = first; it != last; ++it) {
+            uint32_t index = *it;
+            const Edge& edge = edges[index];
+            float minX = std::min(edge.from.x, edge.to.x);
+            float edgeMinY = std::min(edge.from.y, edge.to.y), edgeMaxY = std::max(edge.from.y, edge.to.y);
+            size_t kept = 0;
+            for (uint32_t other : active) {
+                const Edge& candidate = edges[other];
+                if (std::max(candidate.from.x, candidate.to.x) < minX)
+                    continue;
+                active[kept++] = other;
+                if (std::max(lowStrips[index], lowStrips[other]) != strip || (splitOnly && !edge.split && !candidate.split))
+                    continue;
+                if (std::min(candidate.from.y, candidate.to.y) <= edgeMaxY && std::max(candidate.from.y, candidate.to.y) >= edgeMinY)
+                    Intersect(index, other);
+            }
+            active.resize(kept);
+            active.push_back(index);
+        }
+    }
+    if (splits.empty())
+        return false;
+
+    // the points of every edge in order from its start, then the edge is replaced by the pieces between them
+    std::sort(splits.begin(), splits.end(), [this](const Split& a, const Split& b) {
+        if (a.edge != b.edge)
+            return a.edge < b.edge;
+        const Edge& edge = edges[a.edge];
+        glm::dvec2 direction = glm::dvec2(edge.to) - glm::dvec2(edge.from);
+        return glm::dot(glm::dvec2(a.point) - glm::dvec2(edge.from), direction) <
+            glm::dot(glm::dvec2(b.point) - glm::dvec2(edge.from), direction);
+    });
+    for (Edge& edge : edges)
+        edge.split = false;
+    size_t count = edges.size();
+    for (size_t s = 0; s < splits.size();) {
+        uint32_t index = splits[s].edge;
+        glm::vec2 start = edges[index].from, to = edges[index].to;
+        bool first = true;
+        for (; s < splits.size() && splits[s].edge == index; ++s) {
+            const glm::vec2& point = splits[s].point;
+            if (point == start || point == to)
+                continue;
+            if (first)
+                edges[index].to = point;
+            else
+                edges.push_back({ start, point, edges[index].operand, true });
+            edges[index].split = true;
+            first = false;
+            start = point;
+        }
+        if (!first)
+            edges.push_back({ start, to, edges[index].operand, true });
+    }
+    return edges.size() > count;
+}
+
+void PolygonBoolean::Intersect(uint32_t a, uint32_t b)
+{
+    const Edge& first = edges[a];
+    const Edge& second = edges[b];
+    // neighbours in a ring and pieces of a split edge only meet at their common end unless they overlap,
+    // which saves the exact orientations of the common end
+    bool fromShared = second.from == first.from || second.from == first.to;
+    if (fromShared || second.to == first.from || second.to == first.to) {
+        const glm::vec2& common = fromShared ? second.from : second.to;
+        const glm::vec2& other = fromShared ? second.to : second.from;
+        const glm::vec2& end = common == first.from ? first.to : first.from;
+        if (Predicates::Orient2D(first.from, first.to, other) != 0.0 ||
+            glm::dot(glm::dvec2(other) - glm::dvec2(common), glm::dvec2(end) - glm::dvec2(common)) <= 0.0)
+            return;
+    }
+    double o1 = Predicates::Orient2D(first.from, first.to, second.from);
+    double o2 = Predicates::Orient2D(first.from, first.to, second.to);
+    if ((o1 > 0.0 && o2 > 0.0) || (o1 < 0.0 && o2 < 0.0))
+        return;
+    double o3 = Predicates::Orient2D(second.from, second.to, first.from);
+    double o4 = Predicates::Orient2D(second.from, second.to, first.to);
+    if ((o3 > 0.0 && o4 > 0.0) || (o3 < 0.0 && o4 < 0.0))
+        return;
+
+    size_t count = splits.size();
+    if (o1 != 0.0 && o2 != 0.0 && o3 != 0.0 && o4 != 0.0) {
+        // a crossing inside of both edges, the areas give how far along the first edge it is
+        double t = glm::clamp(o3 / (o3 - o4), 0.0, 1.0);
+        glm::dvec2 point = glm::dvec2(first.from) + (glm::dvec2(first.to) - glm::dvec2(first.from)) * t;
+        Split split = { a, glm::vec2(point) };
+        splits.push_back(split);
+        split.edge = b;
+        splits.push_back(split);
+    }
+    else {
+        // touching or overlapping, the ends on the other edge split it
+        if (o1 == 0.0 && IsWithin(first.from, first.to, second.from))
+            splits.push_back({ a, second.from });
+        if (o2 == 0.0 && IsWithin(first.from, first.to, second.to))
+            splits.push_back({ a, second.to });
+        if (o3 == 0.0 && IsWithin(second.from, second.to, first.from))
+            splits.push_back({ b, first.from });
+        if (o4 == 0.0 && IsWithin(second.from, second.to, first.to))
+            splits.push_back({ b, first.to });
+    }
+    if (splits.size() > count)
+        ++intersectionsCount;
+}
+
+void PolygonBoolean::BuildSweepEdges()
+{
+    sweepEdges.clear();
+    sweepEdges.reserve(edges.size());
+    for (const Edge& edge : edges) {
+        SweepEdge sweepEdge = {};
+        bool forward = LexLess(edge.from, edge.to);
+        sweepEdge.left = forward ? edge.from : edge.to;
+        sweepEdge.right = forward ? edge.to : edge.from;
+        sweepEdge.delta[edge.operand] = forward ? 1 : -1;
+        sweepEdges.push_back(sweepEdge);
+    }
+
+    // edges with the same ends are one edge of the sweep, edges that cancel out do not bound anything
+    std::sort(sweepEdges.begin(), sweepEdges.end(), [](const SweepEdge& a, const SweepEdge& b) {
+        if (a.left != b.left)
+            return LexLess(a.left, b.left);
+        return LexLess(a.right, b.right);
+    });
+    size_t count = 0;
+    for (size_t i = 0; i < sweepEdges.size(); ++i) {
+        if (count > 0 && sweepEdges[count - 1].left == sweepEdges[i].left && sweepEdges[count - 1].right == sweepEdges[i].right) {
+            sweepEdges[count - 1].delta[0] += sweepEdges[i].delta[0];
+            sweepEdges[count - 1].delta[1] += sweepEdges[i].delta[1];
+            continue;
+        }
+        if (count > 0 && sweepEdges[count - 1].delta[0] == 0 && sweepEdges[count - 1].delta[1] == 0)
+            --count;
+        sweepEdges[count++] = sweepEdges[i];
+    }
+    if (count > 0 && sweepEdges[count - 1].delta[0] == 0 && sweepEdges[count - 1].delta[1] == 0)
+        --count;
+    sweepEdges.resize(count);
+
+    // edges starting at the same point from the bottom, the order they are inserted into the sweep in
+    for (size_t first = 0; first < sweepEdges.size();) {
+        size_t last = first + 1;
+        while (last < sweepEdges.size() && sweepEdges[last].left == sweepEdges[first].left)
+            ++last;
+        if (last - first > 1) {
+            std::sort(sweepEdges.begin() + first, sweepEdges.begin() + last, [](const SweepEdge& a, const SweepEdge& b) {
+                return Predicates::Orient2D(a.left, a.right, b.right) > 0.0;
+            });
+        }
+        first = last;
+    }
+}
+
+void PolygonBoolean::Sweep(Operation operation)
+{
+    std::vector<uint32_t> rightOrder(sweepEdges.size());
+    for (uint32_t i = 0; i < rightOrder.size(); ++i)
+        rightOrder[i] = i;
+    std::sort(rightOrder.begin(), rightOrder.end(), [this](uint32_t a, uint32_t b) {
+        return LexLess(sweepEdges[a].right, sweepEdges[b].right);
+    });
+
+    // the status holds the edges crossing the sweep line, which is turned slightly so points are met in
+    // the order of x, then y; edges ending at a point leave it before the edges starting there enter
+    SweepOrder sweepOrder = { &sweepEdges };
+    std::set<uint32_t, SweepOrder> status(sweepOrder);
+    std::vector<std::set<uint32_t, SweepOrder>::iterator> positions(sweepEdges.size());
+    vertices.clear();
+    size_t nextLeft = 0, nextRight = 0;
+    while (nextLeft < sweepEdges.size() || nextRight < rightOrder.size()) {
+        glm::vec2 point;
+        if (nextLeft == sweepEdges.size())
+            point = sweepEdges[rightOrder[nextRight]].right;
+        else if (nextRight == rightOrder.size() || LexLess(sweepEdges[nextLeft].left, sweepEdges[rightOrder[nextRight]].right))
+            point = sweepEdges[nextLeft].left;
+        else
+            point = sweepEdges[rightOrder[nextRight]].right;
+        uint32_t vertex = uint32_t(vertices.size());
+        vertices.push_back(point);
+
+        size_t keptEnds = 0, keptStarts = 0;
+        for (; nextRight < rightOrder.size() && sweepEdges[rightOrder[nextRight]].right == point; ++nextRight) {
+            status.erase(positions[rightOrder[nextRight]]);
+            sweepEdges[rightOrder[nextRight]].rightVertex = vertex;
+            keptEnds += sweepEdges[rightOrder[nextRight]].kept;
+        }
+        size_t firstLeft = nextLeft;
+        for (; nextLeft < sweepEdges.size() && sweepEdges[nextLeft].left == point; ++nextLeft) {
+            SweepEdge& edge = sweepEdges[nextLeft];
+            edge.leftVertex = vertex;
+            auto position = status.insert(uint32_t(nextLeft)).first;
+            positions[nextLeft] = position;
+            edge.under = NoIndex;
+            edge.below[0] = edge.below[1] = 0;
+            if (position != status.begin()) {
+                const SweepEdge& under = sweepEdges[*std::prev(position)];
+                edge.below[0] = under.below[0] + under.delta[0];
+                edge.below[1] = under.below[1] + under.delta[1];
+            }
+            bool insideBelow = IsInside(operation, edge.below[0], edge.below[1]);
+            bool insideAbove = IsInside(operation, edge.below[0] + edge.delta[0], edge.below[1] + edge.delta[1]);
+            edge.kept = insideBelow != insideAbove;
+            edge.forward = insideAbove;
+            keptStarts += edge.kept;
+        }
+
+        // more kept edges starting than ending make the point the first vertex of a ring, a hole if the result is
+        // below its lowest edge; the edges passed on the way down bound nothing, so it can be bridged to the first kept one
+        if (keptStarts <= keptEnds)
+            continue;
+        for (size_t e = firstLeft; e < nextLeft; ++e) {
+            SweepEdge& edge = sweepEdges[e];
+            if (!edge.kept || edge.forward)
+                continue;
+            for (auto below = positions[e]; below != status.begin();) {
+                --below;
+                if (sweepEdges[*below].kept) {
+                    edge.under = *below;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+void PolygonBoolean::LinkRings(std::vector<uint32_t>& rings)
+{
+    // kept edges by their start vertex
+    std::vector<uint32_t> outStarts(vertices.size() + 1, 0);
+    for (const SweepEdge& edge : sweepEdges) {
+        if (edge.kept)
+            ++outStarts[GetStartVertex(edge) + 1];
+    }
+    for (size_t v = 1; v < outStarts.size(); ++v)
+        outStarts[v] += outStarts[v - 1];
+    std::vector<uint32_t> outEdges(outStarts.back());
+    std::vector<uint32_t> outFill(outStarts.begin(), outStarts.end() - 1);
+    for (uint32_t e = 0; e < sweepEdges.size(); ++e) {
+        if (sweepEdges[e].kept)
+            outEdges[outFill[GetStartVertex(sweepEdges[e])]++] = e;
+    }
+
+    // where several rings meet, the next edge is the first one clockwise from the edge back, so the result
+    // stays on the left and rings touching at a point are kept apart
+    nextEdges.assign(sweepEdges.size(), NoIndex);
+    for (uint32_t e = 0; e < sweepEdges.size(); ++e) {
+        const SweepEdge& edge = sweepEdges[e];
+        if (!edge.kept)
+            continue;
+        uint32_t end = edge.forward ? edge.rightVertex : edge.leftVertex;
+        uint32_t first = outStarts[end], last = outStarts[end + 1];
+        if (last - first == 1) {
+            nextEdges[e] = outEdges[first];
+            continue;
+        }
+        glm::dvec2 back = glm::dvec2(vertices[GetStartVertex(edge)]) - glm::dvec2(vertices[end]);
+        double backAngle = std::atan2(back.y, back.x);
+        double nearest = 3.0 * glm::pi<double>();
+        for (uint32_t k = first; k < last; ++k) {
+            const SweepEdge& out = sweepEdges[outEdges[k]];
+            uint32_t outEnd = out.forward ? out.rightVertex : out.leftVertex;
+            glm::dvec2 direction = glm::dvec2(vertices[outEnd]) - glm::dvec2(vertices[end]);
+            double turn = backAngle - std::atan2(direction.y, direction.x);
+            while (turn <= 0.0)
+                turn += 2.0 * glm::pi<double>();
+            if (turn < nearest) {
+                nearest = turn;
+                nextEdges[e] = outEdges[k];
+            }
+        }
+    }
+
+    rings.clear();
+    nodePoints.clear();
+    nodeNext.clear();
+    nodePrevious.clear();
+    for (SweepEdge& edge : sweepEdges)
+        edge.ring = NoIndex;
+    std::vector<uint32_t> ringEdges;
+    for (uint32_t e = 0; e < sweepEdges.size(); ++e) {
+        if (!sweepEdges[e].kept || sweepEdges[e].ring != NoIndex)
+            continue;
+        // a ring broken by rounding is dropped
+        uint32_t ring = uint32_t(rings.size());
+        ringEdges.clear();
+        uint32_t current = e;
+        while (current != NoIndex && sweepEdges[current].kept && sweepEdges[current].ring == NoIndex) {
+            sweepEdges[current].ring = ring;
+            ringEdges.push_back(current);
+            current = nextEdges[current];
+        }
+        if (current != e || ringEdges.size() < 3) {
+            for (uint32_t dropped : ringEdges) {
+                sweepEdges[dropped].kept = false;
+                sweepEdges[dropped].ring = NoIndex;
+            }
+            continue;
+        }
+
+        uint32_t firstNode = uint32_t(nodePoints.size());
+        for (size_t k = 0; k < ringEdges.size(); ++k) {
+            SweepEdge& edge = sweepEdges[ringEdges[k]];
+            edge.node = uint32_t(nodePoints.size());
+            nodePoints.push_back(vertices[GetStartVertex(edge)]);
+            nodeNext.push_back(k + 1 < ringEdges.size() ? edge.node + 1 : firstNode);
+            nodePrevious.push_back(k > 0 ? edge.node - 1 : firstNode + uint32_t(ringEdges.size()) - 1);
+        }
+        rings.push_back(e);
+    }
+}
+
+void PolygonBoolean::JoinHoles(const std::vector<uint32_t>& rings, std::vector<Ring>& result)
+{
+    std::vector<glm::vec2> ring;
+    auto collect = [&](uint32_t firstNode) {
+        ring.clear();
+        uint32_t node = firstNode;
+        do {
+            if (ring.empty() || nodePoints[node] != ring.back())
+                ring.push_back(nodePoints[node]);
+            node = nodeNext[node];
+        } while (node != firstNode);
+        while (ring.size() > 1 && ring.back() == ring.front())
+            ring.pop_back();
+    };
+
+    // holes are the clockwise rings, each with the lowest of its edges at its first vertex in the sweep
+    struct Hole
+    {
+        uint32_t vertex;
+        uint32_t lowest;
+        uint32_t node;
+    };
+    std::vector<Hole> holes;
+    std::vector<bool> outer(rings.size(), false);
+    for (uint32_t r = 0; r < rings.size(); ++r) {
+        collect(sweepEdges[rings[r]].node);
+        double area = GetArea(ring);
+        outer[r] = area > 0.0;
+        if (area >= 0.0)
+            continue;
+
+        Hole hole = { NoIndex, NoIndex, NoIndex };
+        uint32_t e = rings[r];
+        do {
+            const SweepEdge& edge = sweepEdges[e];
+            uint32_t start = GetStartVertex(edge);
+            if (hole.vertex == NoIndex || start < hole.vertex) {
+                hole.vertex = start;
+                hole.node = edge.node;
+            }
+            e = nextEdges[e];
+        } while (e != rings[r]);
+        do {
+            const SweepEdge& edge = sweepEdges[e];
+            if (edge.leftVertex == hole.vertex && (hole.lowest == NoIndex ||
+                Predicates::Orient2D(edge.left, edge.right, sweepEdges[hole.lowest].right) > 0.0))
+                hole.lowest = e;
+            e = nextEdges[e];
+        } while (e != rings[r]);
+        holes.push_back(hole);
+    }
+
+    // from right to left, so a hole joined to an edge is left of the holes joined to it before;
+    // the bridge goes straight down to the kept edge the sweep found under the first vertex
+    std::sort(holes.begin(), holes.end(), [](const Hole& a, const Hole& b) { return a.vertex > b.vertex; });
+    for (const Hole& hole : holes) {
+        uint32_t target = sweepEdges[hole.lowest].under;
+        if (target == NoIndex)
+            continue;
+
+        const SweepEdge& edge = sweepEdges[target];
+        glm::vec2 point = vertices[hole.vertex];
+        glm::vec2 foot = edge.left;
+        if (point.x > edge.left.x && edge.right.x > edge.left.x) {
+            double t = (double(point.x) - edge.left.x) / (double(edge.right.x) - edge.left.x);
+            foot = glm::vec2(point.x, float(edge.left.y + (double(edge.right.y) - edge.left.y) * t));
+        }
+
+        // after the left end going forward, before it going back
+        uint32_t after = edge.forward ? edge.node : nodePrevious[sweepEdges[nextEdges[target]].node];
+        uint32_t before = nodeNext[after];
+        uint32_t last = nodePrevious[hole.node];
+        uint32_t bridge = uint32_t(nodePoints.size());
+        nodePoints.insert(nodePoints.end(), { foot, point, foot });
+        nodeNext.insert(nodeNext.end(), { hole.node, bridge + 2, before });
+        nodePrevious.insert(nodePrevious.end(), { after, last, bridge + 1 });
+        nodeNext[after] = bridge;
+        nodePrevious[hole.node] = bridge;
+        nodeNext[last] = bridge + 1;
+        nodePrevious[before] = bridge + 2;
+        ++holesCount;
+    }
+
+    for (uint32_t r = 0; r < rings.size(); ++r) {
+        if (!outer[r])
+            continue;
+        collect(sweepEdges[rings[r]].node);
+        if (ring.size() >= 3)
+            result.push_back(ring);
+    }
+}
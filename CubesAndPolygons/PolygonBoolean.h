@@ -0,0 +1,111 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// Union, intersection and difference of polygons with a sweep line. Edges of both operands are split
+// where they cross or touch, a sweep over the split edges finds the winding numbers of both operands on
+// each side of every edge, and the edges between the inside and the outside of the result are linked into
+// outlines. Holes are joined to the outline around them through the edge the sweep found below them.
+// An instance keeps its buffers between calls and is used by one thread at a time, independent polygon
+// pairs are computed in parallel with an instance per thread.
+class PolygonBoolean
+{
+public:
+    enum Operation
+    {
+        OperationUnion = 0,
+        OperationIntersection = 1,
+        OperationDifference = 2
+    };
+
+    typedef std::vector<glm::vec2> Ring;
+
+    // Every operand is the union of its rings by the nonzero rule, every ring counts as counter-clockwise,
+    // so outlines of either orientation, overlapping ones and the outlines of earlier results can be mixed.
+    // result - one counter-clockwise outline per region, its holes joined to it by zero width bridges,
+    // which is the form Polygon2D and the ear clipper take
+    void Compute(Operation operation, const std::vector<Ring>& subject, const std::vector<Ring>& clip, std::vector<Ring>& result);
+
+    // of the last Compute
+    size_t GetEdgesCount() const { return edgesCount; }
+    size_t GetIntersectionsCount() const { return intersectionsCount; }
+    size_t GetHolesCount() const { return holesCount; }
+
+private:
+    static const uint32_t NoIndex = uint32_t(-1);
+    // splitting rounds the crossings to float, passes after the first test only the edges that were split
+    static const int MaxSplitPasses = 4;
+
+    struct Edge
+    {
+        glm::vec2 from;
+        glm::vec2 to;
+        uint32_t operand;
+        bool split;
+    };
+    struct Split
+    {
+        uint32_t edge;
+        glm::vec2 point;
+    };
+    // edge of the sweep, merged from the split edges with the same ends
+    struct SweepEdge
+    {
+        glm::vec2 left;
+        glm::vec2 right;
+        // winding change of each operand from below the edge to above it
+        int delta[2];
+        // winding numbers below the edge
+        int below[2];
+        // for the lowest edge at the first vertex of a hole the kept edge right below its left end, else NoIndex
+        uint32_t under;
+        uint32_t leftVertex;
+        uint32_t rightVertex;
+        // on the boundary of the result, then the result is on its left going forward (left to right) or back
+        bool kept;
+        bool forward;
+        uint32_t ring;
+        uint32_t node;
+    };
+    // Order of the edges crossing the sweep line from the bottom, for edges that do not cross
+    struct SweepOrder
+    {
+        const std::vector<SweepEdge>* edges;
+        bool operator()(uint32_t a, uint32_t b) const;
+    };
+
+    void AddRings(const std::vector<Ring>& rings, uint32_t operand);
+    // Splits edges at their crossings and at the ends touching another edge,
+    // returns false if there was nothing to split
+    bool SplitEdges(bool splitOnly);
+    void Intersect(uint32_t a, uint32_t b);
+    void BuildSweepEdges();
+    void Sweep(Operation operation);
+    // Links the kept edges into rings, returns the indices of their first edges
+    void LinkRings(std::vector<uint32_t>& rings);
+    void JoinHoles(const std::vector<uint32_t>& rings, std::vector<Ring>& result);
+    uint32_t GetStartVertex(const SweepEdge& edge) const { return edge.forward ? edge.leftVertex : edge.rightVertex; }
+
+    std::vector<Edge> edges;
+    std::vector<Split> splits;
+    // edges by horizontal strip, the strip of the lowest end of every edge
+    std::vector<uint32_t> order;
+    std::vector<uint32_t> stripStarts;
+    std::vector<uint32_t> lowStrips;
+    std::vector<uint32_t> active;
+    std::vector<SweepEdge> sweepEdges;
+    std::vector<glm::vec2> vertices;
+    // next kept edge of every kept edge
+    std::vector<uint32_t> nextEdges;
+    // rings as linked nodes, holes are spliced into the rings around them
+    std::vector<glm::vec2> nodePoints;
+    std::vector<uint32_t> nodeNext;
+    std::vector<uint32_t> nodePrevious;
+
+    size_t edgesCount = 0;
+    size_t intersectionsCount = 0;
+    size_t holesCount = 0;
+};
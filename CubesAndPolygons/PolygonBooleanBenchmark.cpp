@@ -0,0 +1,70 @@
+#include "PolygonBooleanBenchmark.h"
+#include "PolygonBoolean.h"
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+    // outline around the origin with the given radius function, counter-clockwise
+    template <typename Radius>
+    std::vector<glm::vec2> MakeOutline(size_t pointsCount, Radius radius)
+    {
+        std::vector<glm::vec2> points;
+        for (size_t i = 0; i < pointsCount; ++i) {
+            float angle = 6.2831853f * i / pointsCount;
+            float r = radius(i);
+            points.push_back(glm::vec2(r * std::cos(angle), r * std::sin(angle)));
+        }
+        return points;
+    }
+}
+
+void PolygonBooleanBenchmark::Run(size_t edgesCount, size_t holesPerSide)
+{
+    // two wavy outlines with different numbers of lobes, so they cross all around
+    auto makeOutline = [&](glm::vec2 center, float radius, float amplitude, int lobes, float phase) {
+        std::vector<glm::vec2> points = MakeOutline(edgesCount, [&](size_t i) {
+            float angle = 6.2831853f * i / edgesCount;
+            return radius + amplitude * std::sin(lobes * angle + phase);
+        });
+        for (glm::vec2& point : points)
+            point += center;
+        return points;
+    };
+    std::vector<PolygonBoolean::Ring> subject { makeOutline(glm::vec2(0.0f), 0.6f, 0.2f, 37, 0.0f) };
+    std::vector<PolygonBoolean::Ring> clip { makeOutline(glm::vec2(0.1f, 0.05f), 0.55f, 0.25f, 41, 1.0f) };
+
+    const char* OperationNames[] = { "union", "intersection", "difference" };
+    PolygonBoolean boolean;
+    std::vector<PolygonBoolean::Ring> result;
+    for (int operation = PolygonBoolean::OperationUnion; operation <= PolygonBoolean::OperationDifference; ++operation) {
+        auto startTime = std::chrono::steady_clock::now();
+        boolean.Compute(static_cast<PolygonBoolean::Operation>(operation), subject, clip, result);
+        double time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+        std::cout << "boolean " << OperationNames[operation] << ": 2 outlines, "
+            << boolean.GetEdgesCount() << " edges split at " << boolean.GetIntersectionsCount()
+            << " intersections, " << result.size() << " outlines in " << time << " ms" << std::endl;
+    }
+
+    // square holes on a grid, the ones near the border of the square stay outside of it
+    const float Spacing = 0.006f, HoleSize = 0.003f;
+    subject.assign(1, PolygonBoolean::Ring { { -0.8f, -0.8f }, { 0.8f, -0.8f }, { 0.8f, 0.8f }, { -0.8f, 0.8f } });
+    clip.clear();
+    for (size_t row = 0; row < holesPerSide; ++row) {
+        for (size_t column = 0; column < holesPerSide; ++column) {
+            glm::vec2 corner(-0.9f + Spacing * column, -0.9f + Spacing * row);
+            clip.push_back({ corner, corner + glm::vec2(HoleSize, 0.0f), corner + glm::vec2(HoleSize), corner + glm::vec2(0.0f, HoleSize) });
+        }
+    }
+    auto startTime = std::chrono::steady_clock::now();
+    boolean.Compute(PolygonBoolean::OperationDifference, subject, clip, result);
+    double time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    size_t pointsCount = 0;
+    for (const PolygonBoolean::Ring& ring : result)
+        pointsCount += ring.size();
+    std::cout << "boolean holes: square minus " << clip.size() << " squares, " << boolean.GetHolesCount() << " holes joined, "
+        << result.size() << " outlines of " << pointsCount << " points in " << time << " ms" << std::endl;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstddef>
+
+// Times union, intersection and difference of two wavy outlines crossing all around,
+// then a square minus a grid of square holes, where the holes are joined to the outline
+class PolygonBooleanBenchmark
+{
+public:
+    static void Run(size_t edgesCount = 500000, size_t holesPerSide = 300);
+};
@@ -0,0 +1,418 @@
+#include "PolygonEditor.h"
+#include "Predicates.h"
+#include "TriangulationVisitor.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+
+// used by reference in make_pair
+const size_t PolygonEditor::NoTriangle;
+
+namespace
+{
+    uint64_t PointKey(float x, float y)
+    {
+        uint32_t xBits, yBits;
+        memcpy(&xBits, &x, sizeof(xBits));
+        memcpy(&yBits, &y, sizeof(yBits));
+        return (uint64_t(xBits) << 32) | yBits;
+    }
+
+    // false only if an edge of one triangle separates them, either winding; degenerate triangles overlap
+    bool TrianglesOverlap(const glm::vec2 first[3], const glm::vec2 second[3])
+    {
+        const glm::vec2* shapes[2] = { first, second };
+        for (int s = 0; s < 2; ++s) {
+            const glm::vec2* shape = shapes[s];
+            const glm::vec2* other = shapes[1 - s];
+            for (int k = 0; k < 3; ++k) {
+                glm::vec2 a = shape[k], b = shape[(k + 1) % 3];
+                auto side = [&](const glm::vec2& p) { return (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x); };
+                float inside = side(shape[(k + 2) % 3]);
+                if (inside == 0.0f)
+                    continue;
+                bool separated = true;
+                for (int j = 0; j < 3 && separated; ++j)
+                    separated = side(other[j]) * inside < 0.0f;
+                if (separated)
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    // cheap rejection before the exact test
+    bool BoundsOverlap(const glm::vec2& a, const glm::vec2& b, const glm::vec2& c, const glm::vec2& d)
+    {
+        return std::max(a.x, b.x) >= std::min(c.x, d.x) && std::max(c.x, d.x) >= std::min(a.x, b.x) &&
+            std::max(a.y, b.y) >= std::min(c.y, d.y) && std::max(c.y, d.y) >= std::min(a.y, b.y);
+    }
+}
+
+PolygonEditor::PolygonEditor(std::shared_ptr<Polygon2D> iPolygon, const GLfloat* vertices) : polygon(iPolygon)
+{
+    const std::vector<glm::vec2>& points = polygon->points;
+    orientation = TriangulationVisitor::GetOrientation(points);
+
+    // the geometry was written from the points, so their coordinates match exactly
+    std::unordered_map<uint64_t, size_t> indices;
+    indices.reserve(points.size());
+    bool matched = true;
+    for (size_t i = 0; i < points.size() && matched; ++i)
+        matched = indices.emplace(PointKey(points[i].x, points[i].y), i).second;
+
+    triangles.resize(polygon->GetTrianglesCount() * 3);
+    for (size_t v = 0; v < triangles.size() && matched; ++v) {
+        auto found = indices.find(PointKey(vertices[v * 3], vertices[v * 3 + 1]));
+        matched = (found != indices.end());
+        if (matched)
+            triangles[v] = found->second;
+    }
+
+    // repeated points or geometry from another source
+    if (!matched)
+        Triangulate();
+    LinkTriangles();
+}
+
+PolygonEditor::EditKind PolygonEditor::MoveVertex(size_t vertex, const glm::vec2& position)
+{
+    std::vector<glm::vec2>& points = polygon->points;
+    if (vertex >= points.size() || !IsOutlineSimple(vertex, position))
+        return EditRejected;
+
+    std::vector<size_t> chain, fan;
+    bool star = GetStar(vertex, chain, fan);
+    if (star && IsFanValid(position, chain)) {
+        points[vertex] = position;
+        for (size_t triangle : fan)
+            MarkChanged(triangle);
+        return EditKept;
+    }
+    if (star && RetriangulateRegion(vertex, position, fan)) {
+        points[vertex] = position;
+        return EditLocal;
+    }
+
+    // the vertex jumped over other triangles, only small outlines are triangulated whole,
+    // the general triangulation is quadratic
+    if (points.size() > MaxRegionTriangles)
+        return EditRejected;
+    points[vertex] = position;
+    Triangulate();
+    LinkTriangles();
+    return EditFull;
+}
+
+void PolygonEditor::TakeChangedTriangles(std::vector<size_t>& changed)
+{
+    changed.clear();
+    if (allChanged) {
+        for (size_t i = 0; i < triangles.size() / 3; ++i)
+            changed.push_back(i);
+    }
+    else {
+        changed.swap(changedTriangles);
+        std::sort(changed.begin(), changed.end());
+        changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+    }
+    changedTriangles.clear();
+    allChanged = false;
+}
+
+void PolygonEditor::GetTriangle(size_t triangle, GLfloat* vertices) const
+{
+    for (int k = 0; k < 3; ++k) {
+        const glm::vec2& point = polygon->points[triangles[triangle * 3 + k]];
+        vertices[k * 3] = point.x;
+        vertices[k * 3 + 1] = point.y;
+        vertices[k * 3 + 2] = 0.0f;
+    }
+}
+
+void PolygonEditor::Triangulate()
+{
+    TriangulationVisitor::TriangulatePolygon(polygon->points, triangles);
+    orientation = TriangulationVisitor::GetOrientation(polygon->points);
+    allChanged = true;
+}
+
+void PolygonEditor::LinkTriangles()
+{
+    pointTriangles.assign(polygon->points.size(), std::vector<size_t>());
+    for (size_t v = 0; v < triangles.size(); ++v)
+        pointTriangles[triangles[v]].push_back(v / 3);
+}
+
+void PolygonEditor::SetTriangle(size_t triangle, size_t a, size_t b, size_t c)
+{
+    for (int k = 0; k < 3; ++k) {
+        std::vector<size_t>& around = pointTriangles[triangles[triangle * 3 + k]];
+        auto found = std::find(around.begin(), around.end(), triangle);
+        if (found != around.end()) {
+            *found = around.back();
+            around.pop_back();
+        }
+    }
+
+    const size_t corners[3] = { a, b, c };
+    for (int k = 0; k < 3; ++k) {
+        triangles[triangle * 3 + k] = corners[k];
+        pointTriangles[corners[k]].push_back(triangle);
+    }
+    MarkChanged(triangle);
+}
+
+bool PolygonEditor::GetStar(size_t vertex, std::vector<size_t>& chain, std::vector<size_t>& fan) const
+{
+    size_t count = polygon->points.size();
+    size_t next = (vertex + 1) % count;
+    size_t previous = (vertex + count - 1) % count;
+    const std::vector<size_t>& around = pointTriangles[vertex];
+
+    // the other corners of the triangles, looked up by point
+    std::vector<std::pair<size_t, size_t>> corners;
+    corners.reserve(around.size() * 2);
+    for (size_t triangle : around) {
+        for (int k = 0; k < 3; ++k) {
+            size_t point = triangles[triangle * 3 + k];
+            if (point != vertex)
+                corners.push_back({ point, triangle });
+        }
+    }
+    std::sort(corners.begin(), corners.end());
+
+    // from the outline edge to the next point across the triangles sharing the edges to the vertex
+    chain.assign(1, next);
+    fan.clear();
+    size_t triangle = size_t(-1);
+    while (chain.back() != previous && fan.size() < around.size()) {
+        auto first = std::lower_bound(corners.begin(), corners.end(), std::make_pair(chain.back(), size_t(0)));
+        auto last = first;
+        while (last != corners.end() && last->first == chain.back())
+            ++last;
+        if (last - first != (fan.empty() ? 1 : 2))
+            return false;
+        triangle = (first->second != triangle) ? first->second : (first + 1)->second;
+        fan.push_back(triangle);
+
+        size_t other = size_t(-1);
+        for (int k = 0; k < 3; ++k) {
+            size_t point = triangles[triangle * 3 + k];
+            if (point != vertex && point != chain.back())
+                other = point;
+        }
+        if (other == size_t(-1))
+            return false;
+        chain.push_back(other);
+    }
+    return chain.back() == previous && fan.size() == around.size();
+}
+
+bool PolygonEditor::IsOutlineSimple(size_t vertex, const glm::vec2& position) const
+{
+    const std::vector<glm::vec2>& points = polygon->points;
+    size_t count = points.size();
+    size_t next = (vertex + 1) % count;
+    size_t previous = (vertex + count - 1) % count;
+
+    // one pass over the outline with bounds rejection, that is most of the cost of an edit;
+    // edges sharing an end with a new edge only touch it there
+    const glm::vec2 ends[2][2] = { { points[previous], position }, { position, points[next] } };
+    glm::vec2 low[2], high[2];
+    for (int e = 0; e < 2; ++e) {
+        low[e] = glm::min(ends[e][0], ends[e][1]);
+        high[e] = glm::max(ends[e][0], ends[e][1]);
+    }
+    glm::vec2 allLow = glm::min(low[0], low[1]);
+    glm::vec2 allHigh = glm::max(high[0], high[1]);
+
+    for (size_t i = 0; i < count; ++i) {
+        size_t j = (i + 1 == count) ? 0 : i + 1;
+        const glm::vec2& a = points[i];
+        const glm::vec2& b = points[j];
+        if (std::max(a.x, b.x) < allLow.x || std::min(a.x, b.x) > allHigh.x ||
+            std::max(a.y, b.y) < allLow.y || std::min(a.y, b.y) > allHigh.y)
+            continue;
+        if (i == vertex || j == vertex)
+            continue;
+        if (i != previous && j != previous && BoundsOverlap(a, b, ends[0][0], ends[0][1]) &&
+            Predicates::SegmentsIntersect(a, b, ends[0][0], ends[0][1]))
+            return false;
+        if (i != next && j != next && BoundsOverlap(a, b, ends[1][0], ends[1][1]) &&
+            Predicates::SegmentsIntersect(a, b, ends[1][0], ends[1][1]))
+            return false;
+    }
+    return true;
+}
+
+bool PolygonEditor::IsFanValid(const glm::vec2& position, const std::vector<size_t>& chain) const
+{
+    const std::vector<glm::vec2>& points = polygon->points;
+    for (size_t i = 0; i + 1 < chain.size(); ++i) {
+        if (Predicates::Orient2D(position, points[chain[i]], points[chain[i + 1]]) * orientation <= 0.0)
+            return false;
+    }
+
+    // every triangle turns less than half a circle, the fan overlaps itself if it passes the first chain point again
+    const glm::vec2& first = points[chain[0]];
+    for (size_t i = 1; i + 1 < chain.size(); ++i) {
+        if (Predicates::Orient2D(position, points[chain[i]], first) * orientation > 0.0 &&
+            Predicates::Orient2D(position, first, points[chain[i + 1]]) * orientation >= 0.0)
+            return false;
+    }
+    return true;
+}
+
+bool PolygonEditor::RetriangulateRegion(size_t vertex, const glm::vec2& position, const std::vector<size_t>& fan)
+{
+    const std::vector<glm::vec2>& points = polygon->points;
+    size_t count = points.size();
+    // the outline between the old and the new position of the vertex
+    const glm::vec2 swept[2][3] = {
+        { points[(vertex + count - 1) % count], points[vertex], position },
+        { points[vertex], points[(vertex + 1) % count], position }
+    };
+
+    // the fan and the triangles connected to it the outline moves over
+    std::vector<size_t> region(fan);
+    std::unordered_set<size_t> inRegion(fan.begin(), fan.end());
+    for (size_t i = 0; i < region.size() && region.size() < MaxRegionTriangles; ++i) {
+        for (int k = 0; k < 3; ++k) {
+            size_t a = triangles[region[i] * 3 + k];
+            size_t b = triangles[region[i] * 3 + (k + 1) % 3];
+            size_t triangle = GetNeighbour(a, b, inRegion);
+            if (triangle == NoTriangle)
+                continue;
+            glm::vec2 corners[3];
+            for (int j = 0; j < 3; ++j)
+                corners[j] = points[triangles[triangle * 3 + j]];
+            if (TrianglesOverlap(corners, swept[0]) || TrianglesOverlap(corners, swept[1])) {
+                region.push_back(triangle);
+                inRegion.insert(triangle);
+            }
+        }
+    }
+
+    // a region touching itself at a point or not covering the new edges gets a few rings of neighbours
+    std::vector<size_t> outline;
+    for (int ring = 0; ring <= MaxRegionRings && region.size() < MaxRegionTriangles; ++ring) {
+        if (GetRegionOutline(vertex, region, outline) && TriangulateRegion(vertex, position, region, outline))
+            return true;
+
+        size_t regionSize = region.size();
+        for (size_t i = 0; i < regionSize; ++i) {
+            for (int k = 0; k < 3; ++k) {
+                size_t triangle = GetNeighbour(triangles[region[i] * 3 + k], triangles[region[i] * 3 + (k + 1) % 3], inRegion);
+                if (triangle != NoTriangle) {
+                    region.push_back(triangle);
+                    inRegion.insert(triangle);
+                }
+            }
+        }
+        if (region.size() == regionSize)
+            return false;
+    }
+    return false;
+}
+
+bool PolygonEditor::GetRegionOutline(size_t vertex, const std::vector<size_t>& region, std::vector<size_t>& outline) const
+{
+    // edges used by one region triangle
+    std::unordered_map<uint64_t, int> edges;
+    for (size_t triangle : region) {
+        for (int k = 0; k < 3; ++k) {
+            size_t a = triangles[triangle * 3 + k];
+            size_t b = triangles[triangle * 3 + (k + 1) % 3];
+            ++edges[(uint64_t(std::min(a, b)) << 32) | std::max(a, b)];
+        }
+    }
+
+    // a disk without inner points has every outline point on two outline edges
+    std::unordered_map<size_t, std::pair<size_t, size_t>> neighbours;
+    size_t outlineEdges = 0;
+    for (const std::pair<const uint64_t, int>& edge : edges) {
+        if (edge.second != 1)
+            continue;
+        size_t ends[2] = { size_t(edge.first >> 32), size_t(edge.first & 0xffffffffu) };
+        for (int k = 0; k < 2; ++k) {
+            auto inserted = neighbours.emplace(ends[k], std::make_pair(ends[1 - k], NoTriangle));
+            if (!inserted.second) {
+                if (inserted.first->second.second != NoTriangle)
+                    return false;
+                inserted.first->second.second = ends[1 - k];
+            }
+        }
+        ++outlineEdges;
+    }
+
+    // from the vertex along its outline edge to the next point
+    size_t next = (vertex + 1) % polygon->points.size();
+    outline.assign(1, vertex);
+    size_t previous = vertex;
+    size_t current = next;
+    while (current != vertex && outline.size() <= outlineEdges) {
+        auto found = neighbours.find(current);
+        if (found == neighbours.end() || found->second.second == NoTriangle)
+            return false;
+        outline.push_back(current);
+        size_t following = (found->second.first != previous) ? found->second.first : found->second.second;
+        previous = current;
+        current = following;
+    }
+    return current == vertex && outline.size() == outlineEdges && outline.size() == region.size() + 2;
+}
+
+bool PolygonEditor::TriangulateRegion(size_t vertex, const glm::vec2& position, const std::vector<size_t>& region, const std::vector<size_t>& outline)
+{
+    const std::vector<glm::vec2>& points = polygon->points;
+
+    // the region with the vertex at its new position has to stay a simple outline of the
+    // polygon orientation, then it does not overlap the other triangles
+    std::vector<glm::vec2> moved(1, position);
+    for (size_t i = 1; i < outline.size(); ++i)
+        moved.push_back(points[outline[i]]);
+
+    size_t last = moved.size() - 1;
+    for (size_t i = 1; i < last; ++i) {
+        const glm::vec2& a = moved[i];
+        const glm::vec2& b = moved[i + 1];
+        if (i != 1 && BoundsOverlap(a, b, position, moved[1]) && Predicates::SegmentsIntersect(a, b, position, moved[1]))
+            return false;
+        if (i + 1 != last && BoundsOverlap(a, b, moved[last], position) && Predicates::SegmentsIntersect(a, b, moved[last], position))
+            return false;
+    }
+    if (TriangulationVisitor::GetOrientation(moved) != orientation)
+        return false;
+
+    std::vector<size_t> local;
+    TriangulationVisitor::TriangulatePolygon(moved, local);
+    if (local.size() != region.size() * 3)
+        return false;
+
+    auto toPoint = [&](size_t index) { return index == 0 ? vertex : outline[index]; };
+    for (size_t t = 0; t < region.size(); ++t)
+        SetTriangle(region[t], toPoint(local[t * 3]), toPoint(local[t * 3 + 1]), toPoint(local[t * 3 + 2]));
+    return true;
+}
+
+size_t PolygonEditor::GetNeighbour(size_t a, size_t b, const std::unordered_set<size_t>& excluded) const
+{
+    const std::vector<size_t>& around = pointTriangles[a].size() < pointTriangles[b].size() ? pointTriangles[a] : pointTriangles[b];
+    for (size_t triangle : around) {
+        const size_t* corners = &triangles[triangle * 3];
+        bool hasA = (corners[0] == a || corners[1] == a || corners[2] == a);
+        bool hasB = (corners[0] == b || corners[1] == b || corners[2] == b);
+        if (hasA && hasB && !excluded.count(triangle))
+            return triangle;
+    }
+    return NoTriangle;
+}
+
+void PolygonEditor::MarkChanged(size_t triangle)
+{
+    if (!allChanged)
+        changedTriangles.push_back(triangle);
+}
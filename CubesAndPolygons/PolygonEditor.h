@@ -0,0 +1,70 @@
+#pragma once
+#include "Polygon2D.h"
+
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+// Moves vertices of one polygon and keeps its triangulation valid by changing only the
+// triangles around the moved vertex. Triangles keep their slots, so the caller rewrites
+// just the slots reported by TakeChangedTriangles(), the triangle count never changes.
+class PolygonEditor
+{
+public:
+    // vertices - the current triangles of the polygon, 3 floats per vertex; they are matched
+    // to the outline points, if that fails the outline is triangulated again and all triangles change
+    PolygonEditor(std::shared_ptr<Polygon2D> iPolygon, const GLfloat* vertices);
+
+    // How a move was applied
+    enum EditKind
+    {
+        EditKept = 0,     // triangles around the vertex stay valid as they are
+        EditLocal = 1,    // the region around the vertex is triangulated again
+        EditFull = 2,     // the whole outline is triangulated again, small polygons only
+        EditRejected = 3, // the outline would intersect itself or the change is not local, the vertex stays
+        EditKindsCount = 4
+    };
+
+    // position is in polygon coordinates
+    EditKind MoveVertex(size_t vertex, const glm::vec2& position);
+    // Triangle slots changed since the last call, sorted
+    void TakeChangedTriangles(std::vector<size_t>& changed);
+    // Writes the 3 vertices of the triangle, 9 floats
+    void GetTriangle(size_t triangle, GLfloat* vertices) const;
+
+    const std::shared_ptr<Polygon2D>& GetPolygon() const { return polygon; }
+
+private:
+    void Triangulate();
+    void LinkTriangles();
+    void SetTriangle(size_t triangle, size_t a, size_t b, size_t c);
+    // Outline vertices around the vertex from the next to the previous one, and the triangles
+    // between them in the same order; false if the triangles do not form a fan
+    bool GetStar(size_t vertex, std::vector<size_t>& chain, std::vector<size_t>& fan) const;
+    // true if the edges from the position to the outline neighbours of the vertex cross no other edge
+    bool IsOutlineSimple(size_t vertex, const glm::vec2& position) const;
+    bool IsFanValid(const glm::vec2& position, const std::vector<size_t>& chain) const;
+    // Triangulates the fan and the triangles the outline moves over again with the vertex moved,
+    // false if the region is not a disk or gets too large
+    bool RetriangulateRegion(size_t vertex, const glm::vec2& position, const std::vector<size_t>& fan);
+    // Outline points of the region starting at the vertex and its next point, false if it is not a disk
+    bool GetRegionOutline(size_t vertex, const std::vector<size_t>& region, std::vector<size_t>& outline) const;
+    bool TriangulateRegion(size_t vertex, const glm::vec2& position, const std::vector<size_t>& region, const std::vector<size_t>& outline);
+    // Triangle with the edge ab that is not excluded, NoTriangle for outline edges
+    size_t GetNeighbour(size_t a, size_t b, const std::unordered_set<size_t>& excluded) const;
+    void MarkChanged(size_t triangle);
+
+    static const size_t NoTriangle = size_t(-1);
+    // larger regions are not triangulated again, neither are larger outlines as a whole
+    static const size_t MaxRegionTriangles = 1024;
+    static const int MaxRegionRings = 4;
+
+    std::shared_ptr<Polygon2D> polygon;
+    int orientation = 1;
+    // 3 point indices per triangle
+    std::vector<size_t> triangles;
+    // triangles using every point
+    std::vector<std::vector<size_t>> pointTriangles;
+    std::vector<size_t> changedTriangles;
+    bool allChanged = false;
+};
@@ -0,0 +1,58 @@
+#include "PolygonEditorBenchmark.h"
+#include "Polygon2D.h"
+#include "PolygonEditor.h"
+#include "TriangulationVisitor.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+void PolygonEditorBenchmark::Run(size_t pointsCount, size_t movesCount)
+{
+    // a band with noisy top and bottom chains, x-monotone so the initial triangulation is quick
+    std::mt19937 random(2);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    size_t half = pointsCount / 2;
+    float spacing = 2.0f / half;
+    std::vector<glm::vec2> points;
+    for (size_t i = 0; i < half; ++i)
+        points.push_back(glm::vec2(-1.0f + spacing * i, -0.5f - 0.1f * unit(random)));
+    for (size_t i = half; i-- > 0;)
+        points.push_back(glm::vec2(-1.0f + spacing * i + spacing / 2.0f, 0.5f + 0.1f * unit(random)));
+
+    std::shared_ptr<Polygon2D> polygon = std::make_shared<Polygon2D>(points);
+    std::vector<GLfloat> buffer(polygon->GetTrianglesCount() * 3 * 3);
+    TriangulationVisitor triangulation(buffer, 0);
+    polygon->Accept(&triangulation);
+    PolygonEditor editor(polygon, buffer.data());
+
+    // drag steps of a few point spacings, every tenth one much longer
+    size_t counts[PolygonEditor::EditKindsCount] = {};
+    size_t changedCount = 0;
+    double totalTime = 0.0, slowestTime = 0.0;
+    std::vector<size_t> changed;
+    for (size_t move = 0; move < movesCount; ++move) {
+        size_t vertex = random() % polygon->points.size();
+        float step = spacing * ((move % 10 == 0) ? 40.0f : 4.0f);
+        glm::vec2 position = polygon->points[vertex] + glm::vec2(unit(random) - 0.5f, unit(random) - 0.5f) * step;
+
+        auto startTime = std::chrono::steady_clock::now();
+        ++counts[editor.MoveVertex(vertex, position)];
+        editor.TakeChangedTriangles(changed);
+        for (size_t triangle : changed)
+            editor.GetTriangle(triangle, &buffer[triangle * 9]);
+        double time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+        totalTime += time;
+        slowestTime = std::max(slowestTime, time);
+        changedCount += changed.size();
+    }
+
+    std::cout << "vertex edits: " << polygon->points.size() << " points, " << movesCount << " moves, "
+        << counts[PolygonEditor::EditKept] << " kept, " << counts[PolygonEditor::EditLocal] << " local, "
+        << counts[PolygonEditor::EditFull] << " full, " << counts[PolygonEditor::EditRejected] << " rejected; "
+        << totalTime / movesCount << " ms per move, slowest " << slowestTime << " ms, "
+        << double(changedCount) / movesCount << " triangles rewritten per move" << std::endl;
+}
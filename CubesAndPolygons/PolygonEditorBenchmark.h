@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstddef>
+
+// Drags vertices of a large x-monotone polygon with PolygonEditor, mostly by a few point spacings,
+// and times the re-triangulation of every move with the triangles it rewrites
+class PolygonEditorBenchmark
+{
+public:
+    static void Run(size_t pointsCount = 100000, size_t movesCount = 10000);
+};
@@ -0,0 +1,182 @@
+#include "Predicates.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace
+{
+    const double Epsilon = std::numeric_limits<double>::epsilon() / 2.0;
+    const double OrientBound = (3.0 + 16.0 * Epsilon) * Epsilon;
+    const double InCircleBound = (10.0 + 96.0 * Epsilon) * Epsilon;
+
+    // Nonoverlapping components in increasing magnitude, their exact sum is the value
+    typedef std::vector<double> Expansion;
+
+    void TwoSum(double a, double b, double& sum, double& error)
+    {
+        sum = a + b;
+        double bVirtual = sum - a;
+        double aVirtual = sum - bVirtual;
+        error = (a - aVirtual) + (b - bVirtual);
+    }
+
+    void Split(double a, double& high, double& low)
+    {
+        const double Splitter = 134217729.0; // 2^27 + 1
+        double c = Splitter * a;
+        high = c - (c - a);
+        low = a - high;
+    }
+
+    void TwoProduct(double a, double b, double& product, double& error)
+    {
+        product = a * b;
+        double aHigh, aLow, bHigh, bLow;
+        Split(a, aHigh, aLow);
+        Split(b, bHigh, bLow);
+        error = aLow * bLow - (((product - aHigh * bHigh) - aLow * bHigh) - aHigh * bLow);
+    }
+
+    Expansion Difference(double a, double b)
+    {
+        double sum, error;
+        TwoSum(a, -b, sum, error);
+        return { error, sum };
+    }
+
+    Expansion Add(const Expansion& e, const Expansion& f)
+    {
+        Expansion result = e;
+        for (double component : f) {
+            // grow the expansion by one component, dropping zeros
+            Expansion grown;
+            double q = component;
+            for (double existing : result) {
+                double error;
+                TwoSum(q, existing, q, error);
+                if (error != 0.0)
+                    grown.push_back(error);
+            }
+            grown.push_back(q);
+            result.swap(grown);
+        }
+        return result;
+    }
+
+    Expansion Negate(Expansion e)
+    {
+        for (double& component : e)
+            component = -component;
+        return e;
+    }
+
+    Expansion Multiply(const Expansion& e, const Expansion& f)
+    {
+        Expansion result = { 0.0 };
+        for (double b : f) {
+            Expansion scaled;
+            for (double a : e) {
+                double product, error;
+                TwoProduct(a, b, product, error);
+                scaled.push_back(error);
+                scaled.push_back(product);
+            }
+            // the pairs overlap each other, Add restores the invariant
+            result = Add(result, scaled);
+        }
+        return result;
+    }
+
+    double Sign(const Expansion& e)
+    {
+        for (auto it = e.rbegin(); it != e.rend(); ++it) {
+            if (*it != 0.0)
+                return *it;
+        }
+        return 0.0;
+    }
+
+    double Orient2DExact(const glm::vec2& a, const glm::vec2& b, const glm::vec2& c)
+    {
+        Expansion left = Multiply(Difference(a.x, c.x), Difference(b.y, c.y));
+        Expansion right = Multiply(Difference(a.y, c.y), Difference(b.x, c.x));
+        return Sign(Add(left, Negate(right)));
+    }
+
+    double InCircleExact(const glm::vec2& a, const glm::vec2& b, const glm::vec2& c, const glm::vec2& d)
+    {
+        Expansion adx = Difference(a.x, d.x), ady = Difference(a.y, d.y);
+        Expansion bdx = Difference(b.x, d.x), bdy = Difference(b.y, d.y);
+        Expansion cdx = Difference(c.x, d.x), cdy = Difference(c.y, d.y);
+
+        Expansion aLift = Add(Multiply(adx, adx), Multiply(ady, ady));
+        Expansion bLift = Add(Multiply(bdx, bdx), Multiply(bdy, bdy));
+        Expansion cLift = Add(Multiply(cdx, cdx), Multiply(cdy, cdy));
+
+        Expansion bc = Add(Multiply(bdx, cdy), Negate(Multiply(cdx, bdy)));
+        Expansion ca = Add(Multiply(cdx, ady), Negate(Multiply(adx, cdy)));
+        Expansion ab = Add(Multiply(adx, bdy), Negate(Multiply(bdx, ady)));
+        return Sign(Add(Add(Multiply(aLift, bc), Multiply(bLift, ca)), Multiply(cLift, ab)));
+    }
+}
+
+double Predicates::Orient2D(const glm::vec2& a, const glm::vec2& b, const glm::vec2& c)
+{
+    double left = (double(a.x) - c.x) * (double(b.y) - c.y);
+    double right = (double(a.y) - c.y) * (double(b.x) - c.x);
+    double determinant = left - right;
+    if (std::abs(determinant) > OrientBound * (std::abs(left) + std::abs(right)))
+        return determinant;
+    return Orient2DExact(a, b, c);
+}
+
+double Predicates::InCircle(const glm::vec2& a, const glm::vec2& b, const glm::vec2& c, const glm::vec2& d)
+{
+    double adx = double(a.x) - d.x, ady = double(a.y) - d.y;
+    double bdx = double(b.x) - d.x, bdy = double(b.y) - d.y;
+    double cdx = double(c.x) - d.x, cdy = double(c.y) - d.y;
+
+    double bdxcdy = bdx * cdy, cdxbdy = cdx * bdy;
+    double cdxady = cdx * ady, adxcdy = adx * cdy;
+    double adxbdy = adx * bdy, bdxady = bdx * ady;
+    double aLift = adx * adx + ady * ady;
+    double bLift = bdx * bdx + bdy * bdy;
+    double cLift = cdx * cdx + cdy * cdy;
+
+    double determinant = aLift * (bdxcdy - cdxbdy) + bLift * (cdxady - adxcdy) + cLift * (adxbdy - bdxady);
+    double permanent = aLift * (std::abs(bdxcdy) + std::abs(cdxbdy)) + bLift * (std::abs(cdxady) + std::abs(adxcdy)) +
+        cLift * (std::abs(adxbdy) + std::abs(bdxady));
+    if (std::abs(determinant) > InCircleBound * permanent)
+        return determinant;
+    return InCircleExact(a, b, c, d);
+}
+
+bool Predicates::SegmentsIntersect(const glm::vec2& a, const glm::vec2& b, const glm::vec2& c, const glm::vec2& d)
+{
+    double abc = Orient2D(a, b, c), abd = Orient2D(a, b, d);
+    double cda = Orient2D(c, d, a), cdb = Orient2D(c, d, b);
+    if (((abc > 0.0 && abd < 0.0) || (abc < 0.0 && abd > 0.0)) &&
+        ((cda > 0.0 && cdb < 0.0) || (cda < 0.0 && cdb > 0.0)))
+        return true;
+
+    // touching or collinear: an end point on the other segment
+    auto onSegment = [](const glm::vec2& p, const glm::vec2& q, const glm::vec2& r) {
+        return std::min(p.x, q.x) <= r.x && r.x <= std::max(p.x, q.x) &&
+            std::min(p.y, q.y) <= r.y && r.y <= std::max(p.y, q.y);
+    };
+    return (abc == 0.0 && onSegment(a, b, c)) || (abd == 0.0 && onSegment(a, b, d)) ||
+        (cda == 0.0 && onSegment(c, d, a)) || (cdb == 0.0 && onSegment(c, d, b));
+}
+
+bool Predicates::InTriangle(const glm::vec2& a, const glm::vec2& b, const glm::vec2& c, const glm::vec2& p, int orientation)
+{
+    // bounding box rejects most points without evaluating a determinant
+    if (p.x < std::min(a.x, std::min(b.x, c.x)) || p.x > std::max(a.x, std::max(b.x, c.x)) ||
+        p.y < std::min(a.y, std::min(b.y, c.y)) || p.y > std::max(a.y, std::max(b.y, c.y)))
+        return false;
+    return Orient2D(a, b, p) * orientation >= 0.0 &&
+        Orient2D(b, c, p) * orientation >= 0.0 &&
+        Orient2D(c, a, p) * orientation >= 0.0;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// Geometric predicates with exact signs. Every predicate evaluates the determinant in double
+// first and returns it when it is larger than the rounding error bound of that evaluation;
+// only nearly degenerate inputs fall back to exact expansion arithmetic (Shewchuk's method).
+namespace Predicates
+{
+    // > 0 if a, b, c turn counter-clockwise, < 0 if clockwise, 0 if collinear
+    double Orient2D(const glm::vec2& a, const glm::vec2& b, const glm::vec2& c);
+    // > 0 if d is inside the circle through the counter-clockwise a, b, c, < 0 outside, 0 on it
+    double InCircle(const glm::vec2& a, const glm::vec2& b, const glm::vec2& c, const glm::vec2& d);
+    // true if the closed segments ab and cd share a point
+    bool SegmentsIntersect(const glm::vec2& a, const glm::vec2& b, const glm::vec2& c, const glm::vec2& d);
+    // true if p is inside or on the boundary of the triangle with the given orientation sign
+    bool InTriangle(const glm::vec2& a, const glm::vec2& b, const glm::vec2& c, const glm::vec2& p, int orientation);
+}
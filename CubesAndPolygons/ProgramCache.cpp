@@ -0,0 +1,165 @@
+#define GLEW_STATIC
+#include "ProgramCache.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+    const uint32_t CacheMagic = 0x50425043; // "CPBP"
+
+    struct CacheHeader
+    {
+        uint32_t magic;
+        uint32_t key;
+        uint32_t format;
+        uint32_t length;
+    };
+
+    // FNV-1a
+    uint32_t Hash(uint32_t value, const char* text)
+    {
+        for (; text && *text; ++text)
+            value = (value ^ static_cast<unsigned char>(*text)) * 16777619u;
+        // separator, so moving characters between the strings changes the hash
+        return (value ^ 0xff) * 16777619u;
+    }
+
+    bool IsBinarySupported()
+    {
+        if (!GLEW_VERSION_4_1 && !GLEW_ARB_get_program_binary)
+            return false;
+        GLint formatsCount = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatsCount);
+        return formatsCount > 0;
+    }
+}
+
+GLuint ProgramCache::Load(const GLchar* vertexSource, const GLchar* fragmentSource, const std::string& directory)
+{
+    auto startTime = std::chrono::steady_clock::now();
+
+    bool binarySupported = IsBinarySupported();
+    uint32_t key = 2166136261u;
+    key = Hash(key, vertexSource);
+    key = Hash(key, fragmentSource);
+    key = Hash(key, reinterpret_cast<const char*>(glGetString(GL_VENDOR)));
+    key = Hash(key, reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+    key = Hash(key, reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+
+    char fileName[32];
+    snprintf(fileName, sizeof(fileName), "program_%08x.bin", key);
+    std::string path = directory.empty() ? fileName : directory + "/" + fileName;
+
+    GLuint program = binarySupported ? LoadBinary(path, key) : 0;
+    bool cached = program != 0;
+    if (!cached) {
+        program = Compile(vertexSource, fragmentSource, binarySupported);
+        if (binarySupported)
+            SaveBinary(program, path, key);
+    }
+
+    std::chrono::duration<double, std::milli> loadTime = std::chrono::steady_clock::now() - startTime;
+    std::cout << "Shader program " << (cached ? "loaded from " + path : std::string("compiled"))
+        << " in " << loadTime.count() << " ms" << (binarySupported ? "" : ", program binaries are not supported") << std::endl;
+    return program;
+}
+
+GLuint ProgramCache::Compile(const GLchar* vertexSource, const GLchar* fragmentSource, bool retrievable)
+{
+    // Vertex shader
+    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(vertexShader, 1, &vertexSource, NULL);
+    glCompileShader(vertexShader);
+
+    GLint success;
+    GLchar infoLog[512];
+    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
+        std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+    }
+
+    // Fragment shader
+    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(fragmentShader, 1, &fragmentSource, NULL);
+    glCompileShader(fragmentShader);
+
+    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
+        std::cout << "Fragment shader compilation error\n" << infoLog << std::endl;
+    }
+    
+    GLuint shaderProgram = glCreateProgram();
+    if (retrievable)
+        glProgramParameteri(shaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glAttachShader(shaderProgram, vertexShader);
+    glAttachShader(shaderProgram, fragmentShader);
+    glLinkProgram(shaderProgram);
+
+    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
+    if (!success) {
+        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
+        std::cout << "Vertex shader compilation error\n" << infoLog << std::endl;
+    }
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    return shaderProgram;
+}
+
+GLuint ProgramCache::LoadBinary(const std::string& path, uint32_t key)
+{
+    std::ifstream in(path, std::ios::binary);
+    CacheHeader header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        header.magic != CacheMagic || header.key != key || header.length == 0)
+        return 0;
+
+    std::vector<char> binary(header.length);
+    if (!in.read(binary.data(), binary.size()))
+        return 0;
+
+    // the driver rejects binaries of another version or hardware, the program is compiled then
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, header.format, binary.data(), header.length);
+    GLint success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+void ProgramCache::SaveBinary(GLuint program, const std::string& path, uint32_t key)
+{
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    CacheHeader header;
+    header.magic = CacheMagic;
+    header.key = key;
+    std::vector<char> binary(length);
+    GLsizei written = 0;
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &written, &format, binary.data());
+    if (written <= 0)
+        return;
+    header.format = format;
+    header.length = written;
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(binary.data(), written);
+    if (!out)
+        std::cout << "Can't write shader program cache: " << path << std::endl;
+}
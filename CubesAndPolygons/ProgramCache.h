@@ -0,0 +1,21 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <string>
+
+// Links shader programs, reusing program binaries cached on disk when the driver supports them.
+// Cache files are keyed by the shader sources and the driver strings, so a changed shader or an
+// updated driver does not match and the program is compiled again; any failure falls back to compiling.
+class ProgramCache
+{
+public:
+    // Returns the linked program, directory - where the cache files are kept, empty for the working directory
+    static GLuint Load(const GLchar* vertexSource, const GLchar* fragmentSource, const std::string& directory = "");
+
+private:
+    static GLuint Compile(const GLchar* vertexSource, const GLchar* fragmentSource, bool retrievable);
+    static GLuint LoadBinary(const std::string& path, uint32_t key);
+    static void SaveBinary(GLuint program, const std::string& path, uint32_t key);
+};
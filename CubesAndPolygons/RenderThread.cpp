@@ -0,0 +1,156 @@
+#define GLEW_STATIC
+#include "RenderThread.h"
+
+RenderThread::RenderThread(GLFWwindow* iWindow, bool onDemand) : window(iWindow), onDemandMode(onDemand)
+{
+    thread = std::thread(&RenderThread::Run, this);
+}
+
+RenderThread::~RenderThread()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopped = true;
+    }
+    wakeCondition.notify_one();
+    thread.join();
+}
+
+void RenderThread::UpdateGeometry(std::vector<VertexUpdate>& updates)
+{
+    if (updates.empty())
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t snapshot = publishedCount + 1;
+    if (geometryBatches.empty() || geometryBatches.back().snapshot != snapshot)
+        geometryBatches.push_back({ snapshot, std::vector<VertexUpdate>() });
+    std::vector<VertexUpdate>& batch = geometryBatches.back().updates;
+    for (VertexUpdate& update : updates)
+        batch.push_back(std::move(update));
+    updates.clear();
+}
+
+void RenderThread::PublishSnapshot()
+{
+    snapshots.GetWriteBuffer().sequence = ++publishedCount;
+    snapshots.Publish();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        snapshotPublished = true;
+    }
+    wakeCondition.notify_one();
+}
+
+void RenderThread::RequestPick(double xpos, double ypos)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pickRequested = true;
+        pickReady = false;
+        pickX = xpos;
+        pickY = ypos;
+    }
+    wakeCondition.notify_one();
+}
+
+bool RenderThread::TakePickResult(GLuint& index)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!pickReady)
+        return false;
+    pickReady = false;
+    index = pickResult;
+    return true;
+}
+
+void RenderThread::TakeStats(DrawStats& total)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    total.Add(stats);
+    stats = DrawStats();
+}
+
+bool RenderThread::TakeFirstFrame(std::chrono::steady_clock::time_point& time)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!firstFrameReady || firstFrameTaken)
+        return false;
+    firstFrameTaken = true;
+    time = firstFrameTime;
+    return true;
+}
+
+void RenderThread::Run()
+{
+    glfwMakeContextCurrent(window);
+    {
+        Renderer renderer;
+        bool hasSnapshot = false;
+        std::vector<GeometryBatch> batches;
+        for (;;) {
+            bool pick = false;
+            double xpos = 0.0, ypos = 0.0;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                if (onDemandMode) {
+                    // updates are drawn with the snapshot published after them
+                    wakeCondition.wait(lock, [this] { return stopped || snapshotPublished || pickRequested; });
+                }
+                snapshotPublished = false;
+                if (stopped)
+                    break;
+            }
+
+            // the updates the snapshot refers to were queued before it was published, the ones queued
+            // after it may move vertex ranges it still uses and are left for the snapshot published after them
+            bool fresh = snapshots.Acquire();
+            hasSnapshot = hasSnapshot || fresh;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                while (hasSnapshot && !geometryBatches.empty() && geometryBatches.front().snapshot <= snapshots.GetReadBuffer().sequence) {
+                    batches.push_back(std::move(geometryBatches.front()));
+                    geometryBatches.pop_front();
+                }
+                // a pick needs a drawn frame, it waits for the first snapshot
+                pick = pickRequested && hasSnapshot;
+                pickRequested = pickRequested && !pick;
+                xpos = pickX;
+                ypos = pickY;
+            }
+
+            for (const GeometryBatch& batch : batches) {
+                for (const VertexUpdate& update : batch.updates)
+                    renderer.UpdateGeometry(update);
+            }
+            batches.clear();
+
+            if (!hasSnapshot || (onDemandMode && !fresh && !pick))
+                continue;
+
+            DrawStats frameStats;
+            renderer.Draw(snapshots.GetReadBuffer(), frameStats);
+            GLuint index = pick ? renderer.ReadStencil(xpos, ypos) : 0;
+            glfwSwapBuffers(window);
+
+            bool notify = pick;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stats.Add(frameStats);
+                if (pick) {
+                    pickResult = index;
+                    pickReady = true;
+                }
+                if (!firstFrameReady) {
+                    firstFrameReady = true;
+                    firstFrameTime = std::chrono::steady_clock::now();
+                    notify = true;
+                }
+            }
+            // the main thread may be waiting for events
+            if (notify)
+                glfwPostEmptyEvent();
+        }
+    }
+    glfwMakeContextCurrent(nullptr);
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include "Renderer.h"
+#include "Scene.h"
+#include "TripleBuffer.h"
+
+#include <GLFW/glfw3.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+// Draws frame snapshots on its own thread with the window GL context,
+// so input handling and scene updates on the main thread never wait for the GPU.
+// The context must not be current on the calling thread when it is constructed.
+class RenderThread
+{
+public:
+    // onDemand - draw only newly published snapshots instead of redrawing the last one continuously
+    RenderThread(GLFWwindow* window, bool onDemand);
+    ~RenderThread();
+
+    RenderThread(const RenderThread&) = delete;
+    RenderThread& operator=(const RenderThread&) = delete;
+
+    // Takes the updates over, they are uploaded right before the next published snapshot is drawn.
+    // Called on the thread that publishes the snapshots.
+    void UpdateGeometry(std::vector<VertexUpdate>& updates);
+
+    // Fill the write buffer and publish it, the render thread always draws the latest published one
+    FrameSnapshot& GetSnapshotBuffer() { return snapshots.GetWriteBuffer(); }
+    void PublishSnapshot();
+
+    // The stencil is read after the next frame is drawn, the main thread is woken up with the result
+    void RequestPick(double xpos, double ypos);
+    bool TakePickResult(GLuint& index);
+
+    // Adds the counters accumulated since the last call
+    void TakeStats(DrawStats& stats);
+    // Returns true once, after the first frame was swapped
+    bool TakeFirstFrame(std::chrono::steady_clock::time_point& time);
+
+private:
+    // Updates queued before the snapshot with the given sequence was published; a snapshot published
+    // earlier may refer to the vertex ranges they move, so they wait until their snapshot is drawn
+    struct GeometryBatch
+    {
+        size_t snapshot;
+        std::vector<VertexUpdate> updates;
+    };
+
+    void Run();
+
+    GLFWwindow* window;
+    bool onDemandMode;
+    TripleBuffer<FrameSnapshot> snapshots;
+    // snapshots published so far, only used by the publishing thread
+    size_t publishedCount = 0;
+
+    std::mutex mutex;
+    std::condition_variable wakeCondition;
+    bool stopped = false;
+    bool snapshotPublished = false;
+    std::deque<GeometryBatch> geometryBatches;
+    bool pickRequested = false;
+    double pickX = 0.0;
+    double pickY = 0.0;
+    bool pickReady = false;
+    GLuint pickResult = 0;
+    DrawStats stats;
+    bool firstFrameReady = false;
+    bool firstFrameTaken = false;
+    std::chrono::steady_clock::time_point firstFrameTime;
+
+    std::thread thread;
+};
@@ -0,0 +1,278 @@
+#define GLEW_STATIC
+#include "Renderer.h"
+#include "ProgramCache.h"
+
+#include <algorithm>
+
+#include <glm/gtc/type_ptr.hpp>
+
+// Shaders
+const GLchar* vertexShaderSource = "#version 330 core\n"
+"layout (location = 0) in vec3 position;\n"
+"uniform mat4 transform;\n"
+"uniform mat4 viewProjection;\n"
+"void main()\n"
+"{\n"
+"gl_Position = viewProjection * transform * vec4(position.x, position.y, position.z, 1.0);\n"
+"}\0";
+
+const GLchar* fragmentShaderSource = "#version 330 core\n"
+"out vec4 color;\n"
+"uniform vec4 col;\n"
+"void main()\n"
+"{\n"
+"color = col;\n"
+"}\n\0";
+
+void DrawStats::Add(const DrawStats& other)
+{
+    framesCount += other.framesCount;
+    drawnEntities += other.drawnEntities;
+    drawnTriangles += other.drawnTriangles;
+    culledEntities += other.culledEntities;
+    culledTriangles += other.culledTriangles;
+    simplifiedTriangles += other.simplifiedTriangles;
+    for (int kind = 0; kind < DetailKindsCount; ++kind) {
+        detailEntities[kind] += other.detailEntities[kind];
+        detailTriangles[kind] += other.detailTriangles[kind];
+    }
+    gpuTime += other.gpuTime;
+    gpuTimeFramesCount += other.gpuTimeFramesCount;
+    fragmentsCount += other.fragmentsCount;
+    fragmentFramesCount += other.fragmentFramesCount;
+    stateCallsIssued += other.stateCallsIssued;
+    stateCallsFiltered += other.stateCallsFiltered;
+    streamedBytes += other.streamedBytes;
+    skippedEntities += other.skippedEntities;
+    streamStalls += other.streamStalls;
+}
+
+Renderer::Renderer()
+{
+    shaderProgram = ProgramCache::Load(vertexShaderSource, fragmentShaderSource);
+    transformLoc = glGetUniformLocation(shaderProgram, "transform");
+    viewProjectionLoc = glGetUniformLocation(shaderProgram, "viewProjection");
+    colorLoc = glGetUniformLocation(shaderProgram, "col");
+
+    for (VertexStream& stream : streams)
+        glGenVertexArrays(1, &stream.VAO);
+    glGenVertexArrays(1, &outlineVAO);
+    glGenBuffers(1, &outlineVBO);
+    glGenQueries(2, fragmentQueries);
+    glGenQueries(2, timeQueries);
+}
+
+Renderer::~Renderer()
+{
+    glDeleteQueries(2, fragmentQueries);
+    glDeleteQueries(2, timeQueries);
+    glDeleteVertexArrays(VertexFormatsCount, streamVAOs);
+    glDeleteVertexArrays(1, &outlineVAO);
+    glDeleteBuffers(1, &outlineVBO);
+    streamRing.reset();
+    for (VertexStream& stream : streams) {
+        glDeleteVertexArrays(1, &stream.VAO);
+        glDeleteBuffers(1, &stream.VBO);
+    }
+    glDeleteProgram(shaderProgram);
+}
+
+void Renderer::UpdateGeometry(const VertexUpdate& update)
+{
+    VertexStream& stream = streams[update.format];
+    size_t vertexSize = VertexComponents[update.format] * sizeof(GLushort);
+    if (update.totalVertices > stream.capacity) {
+        // grow geometrically and copy on the GPU, so streamed scenes are not uploaded again on every chunk
+        size_t capacity = std::max(update.totalVertices, stream.capacity * 2);
+        GLuint newVBO;
+        glGenBuffers(1, &newVBO);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, newVBO);
+        glBufferData(GL_COPY_WRITE_BUFFER, capacity * vertexSize, NULL, GL_STATIC_DRAW);
+        if (stream.size > 0) {
+            glBindBuffer(GL_COPY_READ_BUFFER, stream.VBO);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, stream.size * vertexSize);
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        glDeleteBuffers(1, &stream.VBO);
+        stream.VBO = newVBO;
+        stream.capacity = capacity;
+
+        // normalized coordinates, the solid format has padding after z; planar gets z = 0
+        state.BindVertexArray(stream.VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, stream.VBO);
+        glVertexAttribPointer(0, std::min(VertexComponents[update.format], 3), GL_UNSIGNED_SHORT, GL_TRUE, vertexSize, (GLvoid*)0);
+        glEnableVertexAttribArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    stream.size = update.totalVertices;
+
+    if (!update.data.empty()) {
+        glBindBuffer(GL_ARRAY_BUFFER, stream.VBO);
+        glBufferSubData(GL_ARRAY_BUFFER, update.firstVertex * vertexSize, update.data.size() * sizeof(GLushort), update.data.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+}
+
+void Renderer::CreateStreamRing(size_t capacity)
+{
+    streamRing.reset(new RingBuffer(capacity));
+    // both formats read the same buffer, items are addressed in vertices of their format
+    for (int format = 0; format < VertexFormatsCount; ++format) {
+        if (!streamVAOs[format])
+            glGenVertexArrays(1, &streamVAOs[format]);
+        GLsizei vertexSize = VertexComponents[format] * sizeof(GLushort);
+        state.BindVertexArray(streamVAOs[format]);
+        glBindBuffer(GL_ARRAY_BUFFER, streamRing->GetBuffer());
+        glVertexAttribPointer(0, std::min(VertexComponents[format], 3), GL_UNSIGNED_SHORT, GL_TRUE, vertexSize, (GLvoid*)0);
+        glEnableVertexAttribArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+}
+
+void Renderer::Draw(const FrameSnapshot& snapshot, DrawStats& stats)
+{
+    state.ClearColor(glm::vec4(0.2f, 0.3f, 0.3f, 1.0f));
+    state.ClearStencil(0);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+    state.SetEnabled(GL_STENCIL_TEST, true);
+    state.StencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+
+    if (snapshot.depthMode) {
+        // equal depth keeps the last drawn entity on top as without depth test
+        state.SetEnabled(GL_DEPTH_TEST, true);
+        state.DepthFunc(GL_LEQUAL);
+        // the ortho viewProjection only scales and moves x and y and keeps z (near 1, far -1),
+        // so the world is as left-handed as clip space: faces counter-clockwise from outside
+        // are clockwise on the screen
+        state.FrontFace(GL_CW);
+        state.CullFace(GL_BACK);
+    }
+    else {
+        state.SetEnabled(GL_DEPTH_TEST, false);
+        state.SetEnabled(GL_CULL_FACE, false);
+    }
+
+    state.UseProgram(shaderProgram);
+    glUniformMatrix4fv(viewProjectionLoc, 1, GL_FALSE, glm::value_ptr(snapshot.viewProjection));
+
+    // streamed geometry of the frame is copied to the ring at once, -1 if nothing is drawn from it
+    bool streamed = snapshot.streamBudget > 0;
+    GLintptr streamOffset = -1;
+    if (streamed && !snapshot.streamedVertices.empty()) {
+        if (!streamRing || streamRing->GetCapacity() != snapshot.streamBudget)
+            CreateStreamRing(snapshot.streamBudget);
+        size_t streamedBytes = snapshot.streamedVertices.size() * sizeof(GLushort);
+        streamOffset = streamRing->Write(snapshot.streamedVertices.data(), streamedBytes);
+        if (streamOffset >= 0)
+            stats.streamedBytes += streamedBytes;
+    }
+
+    GLuint fragmentQuery = fragmentQueries[frameIndex % 2];
+    glBeginQuery(GL_SAMPLES_PASSED, fragmentQuery);
+    glBeginQuery(GL_TIME_ELAPSED, timeQueries[frameIndex % 2]);
+
+    size_t frameTriangles = 0;
+    size_t frameEntities = 0;
+    for (const DrawItem& item : snapshot.items) {
+        if (streamed && streamOffset < 0)
+            break;
+        GLint firstVertex = item.firstVertex;
+        if (streamed)
+            firstVertex += static_cast<GLint>(streamOffset / (VertexComponents[item.format] * sizeof(GLushort)));
+
+        // items are grouped by culling and color in depth mode, so these mostly change once per group
+        state.BindVertexArray(streamed ? streamVAOs[item.format] : streams[item.format].VAO);
+        state.StencilFunc(GL_ALWAYS, item.stencilId, -1);
+        if (snapshot.depthMode)
+            state.SetEnabled(GL_CULL_FACE, item.closed);
+        glUniformMatrix4fv(transformLoc, 1, GL_FALSE, glm::value_ptr(item.transform));
+        state.Uniform4fv(colorLoc, item.color);
+
+        glDrawArrays(GL_TRIANGLES, firstVertex, item.verticesCount);
+        frameTriangles += item.verticesCount / 3;
+        ++frameEntities;
+    }
+    if (streamOffset >= 0) {
+        streamRing->Fence();
+        stats.streamStalls += streamRing->TakeStallsCount();
+    }
+    stats.skippedEntities += snapshot.skippedEntities;
+
+    glEndQuery(GL_TIME_ELAPSED);
+    glEndQuery(GL_SAMPLES_PASSED);
+    if (!snapshot.selectionOutline.empty())
+        DrawSelectionOutline(snapshot.selectionOutline);
+    GLuint previousQuery = fragmentQueries[(frameIndex + 1) % 2];
+    GLint queryAvailable = 0;
+    if (frameIndex > 0)
+        glGetQueryObjectiv(previousQuery, GL_QUERY_RESULT_AVAILABLE, &queryAvailable);
+    if (queryAvailable) {
+        GLuint64 fragments = 0;
+        glGetQueryObjectui64v(previousQuery, GL_QUERY_RESULT, &fragments);
+        stats.fragmentsCount += fragments;
+        ++stats.fragmentFramesCount;
+    }
+    GLuint previousTimeQuery = timeQueries[(frameIndex + 1) % 2];
+    queryAvailable = 0;
+    if (frameIndex > 0)
+        glGetQueryObjectiv(previousTimeQuery, GL_QUERY_RESULT_AVAILABLE, &queryAvailable);
+    if (queryAvailable) {
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(previousTimeQuery, GL_QUERY_RESULT, &elapsed);
+        stats.gpuTime += elapsed;
+        ++stats.gpuTimeFramesCount;
+    }
+
+    ++frameIndex;
+    ++stats.framesCount;
+    stats.drawnEntities += frameEntities;
+    stats.drawnTriangles += frameTriangles;
+    stats.culledEntities += snapshot.entitiesCount - frameEntities;
+    stats.simplifiedTriangles += snapshot.simplifiedTriangles;
+    for (int kind = 0; kind < DetailKindsCount; ++kind) {
+        stats.detailEntities[kind] += snapshot.detailEntities[kind];
+        stats.detailTriangles[kind] += snapshot.detailTriangles[kind];
+    }
+    stats.culledTriangles += snapshot.trianglesCount - frameTriangles - snapshot.simplifiedTriangles;
+
+    size_t issued, filtered;
+    state.TakeCounters(issued, filtered);
+    stats.stateCallsIssued += issued;
+    stats.stateCallsFiltered += filtered;
+}
+
+void Renderer::DrawSelectionOutline(const std::vector<glm::vec2>& outline)
+{
+    std::vector<GLfloat> vertices;
+    vertices.reserve(outline.size() * 3);
+    for (const glm::vec2& point : outline) {
+        vertices.push_back(point.x);
+        vertices.push_back(point.y);
+        vertices.push_back(0.0f);
+    }
+    state.BindVertexArray(outlineVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, outlineVBO);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), vertices.data(), GL_STREAM_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (GLvoid*)0);
+    glEnableVertexAttribArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // on top of the entities and left out of picking
+    state.SetEnabled(GL_DEPTH_TEST, false);
+    state.SetEnabled(GL_STENCIL_TEST, false);
+    glUniformMatrix4fv(transformLoc, 1, GL_FALSE, glm::value_ptr(glm::mat4(1.0f)));
+    state.Uniform4fv(colorLoc, glm::vec4(1.0f));
+    glDrawArrays(GL_LINE_LOOP, 0, static_cast<GLsizei>(outline.size()));
+}
+
+GLuint Renderer::ReadStencil(double xpos, double ypos) const
+{
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    GLuint index = 0;
+    glReadPixels(xpos, viewport[3] - ypos - 1, 1, 1, GL_STENCIL_INDEX, GL_UNSIGNED_INT, &index);
+    return index;
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include "FrameSnapshot.h"
+#include "GLStateCache.h"
+#include "RingBuffer.h"
+
+#include <GL/glew.h>
+
+#include <memory>
+
+// Counters accumulated by Renderer::Draw
+struct DrawStats
+{
+    size_t framesCount = 0;
+    size_t drawnEntities = 0;
+    size_t drawnTriangles = 0;
+    size_t culledEntities = 0;
+    size_t culledTriangles = 0;
+    // left out of the visible entities by their detail levels
+    size_t simplifiedTriangles = 0;
+    // drawn entities and triangles per DetailKind
+    size_t detailEntities[DetailKindsCount] = {};
+    size_t detailTriangles[DetailKindsCount] = {};
+    // GPU time of the frames, measured for gpuTimeFramesCount of them
+    GLuint64 gpuTime = 0;
+    size_t gpuTimeFramesCount = 0;
+    // shaded fragments, measured for fragmentFramesCount of the frames
+    GLuint64 fragmentsCount = 0;
+    size_t fragmentFramesCount = 0;
+    // state calls passed to GL and dropped by the state cache
+    size_t stateCallsIssued = 0;
+    size_t stateCallsFiltered = 0;
+    // streamed geometry mode: bytes written to the ring buffer, visible entities over the budget,
+    // writes that waited for the GPU
+    size_t streamedBytes = 0;
+    size_t skippedEntities = 0;
+    size_t streamStalls = 0;
+
+    void Add(const DrawStats& other);
+};
+
+// Owns the GL objects and draws frame snapshots, must be used on the thread with the current GL context
+class Renderer
+{
+public:
+    Renderer();
+    ~Renderer();
+
+    Renderer(const Renderer&) = delete;
+    Renderer& operator=(const Renderer&) = delete;
+
+    // Resizes the buffer of the update format keeping its contents, then uploads the packed vertices
+    void UpdateGeometry(const VertexUpdate& update);
+    void Draw(const FrameSnapshot& snapshot, DrawStats& stats);
+    // Stencil value of the last drawn frame at the window position, 0 if there is no entity
+    GLuint ReadStencil(double xpos, double ypos) const;
+
+private:
+    GLStateCache state;
+    GLuint shaderProgram = 0;
+    // one vertex array and buffer per vertex format, sizes in vertices
+    struct VertexStream
+    {
+        GLuint VAO = 0;
+        GLuint VBO = 0;
+        size_t capacity = 0;
+        size_t size = 0;
+    };
+    VertexStream streams[VertexFormatsCount];
+    // streamed geometry mode, created for the budget of the first streamed snapshot
+    void CreateStreamRing(size_t capacity);
+    std::unique_ptr<RingBuffer> streamRing;
+    GLuint streamVAOs[VertexFormatsCount] = {};
+    // rubber band of the snapshot, float coordinates uploaded every frame it is drawn
+    void DrawSelectionOutline(const std::vector<glm::vec2>& outline);
+    GLuint outlineVAO = 0;
+    GLuint outlineVBO = 0;
+
+    GLint transformLoc = -1;
+    GLint viewProjectionLoc = -1;
+    GLint colorLoc = -1;
+
+    // shaded fragments, read one frame late to avoid waiting for the GPU
+    GLuint fragmentQueries[2];
+    GLuint timeQueries[2];
+    size_t frameIndex = 0;
+};
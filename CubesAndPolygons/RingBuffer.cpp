@@ -0,0 +1,104 @@
+#define GLEW_STATIC
+#include "RingBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+RingBuffer::RingBuffer(size_t iCapacity) : capacity(iCapacity)
+{
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    if (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_COPY_WRITE_BUFFER, capacity, NULL, flags);
+        mapped = static_cast<GLubyte*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, capacity, flags));
+    }
+    else {
+        glBufferData(GL_COPY_WRITE_BUFFER, capacity, NULL, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+RingBuffer::~RingBuffer()
+{
+    for (Region& region : regions)
+        glDeleteSync(region.fence);
+    if (mapped) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+    glDeleteBuffers(1, &buffer);
+}
+
+GLintptr RingBuffer::Write(const void* data, size_t size)
+{
+    if (size > capacity)
+        return -1;
+
+    size_t offset = (head + 7) & ~size_t(7);
+    if (offset + size > capacity) {
+        // data is not split, the end of the buffer stays unused until the next turn
+        Fence();
+        head = pendingBegin = offset = 0;
+    }
+
+    // regions are released oldest first, that is the order the GPU finishes them
+    auto overlaps = [&](const Region& region) { return region.begin < offset + size && offset < region.end; };
+    while (std::any_of(regions.begin(), regions.end(), overlaps))
+        WaitFront();
+
+    if (mapped) {
+        memcpy(mapped + offset, data, size);
+    }
+    else {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT;
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        void* region = glMapBufferRange(GL_COPY_WRITE_BUFFER, offset, size, flags);
+        if (region) {
+            memcpy(region, data, size);
+            glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        if (!region)
+            return -1;
+    }
+
+    head = offset + size;
+    return static_cast<GLintptr>(offset);
+}
+
+void RingBuffer::Fence()
+{
+    if (head == pendingBegin)
+        return;
+
+    Region region;
+    region.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    region.begin = pendingBegin;
+    region.end = head;
+    regions.push_back(region);
+    pendingBegin = head;
+}
+
+size_t RingBuffer::TakeStallsCount()
+{
+    size_t count = stallsCount;
+    stallsCount = 0;
+    return count;
+}
+
+void RingBuffer::WaitFront()
+{
+    GLsync fence = regions.front().fence;
+    // the flush makes sure the fence reaches the GPU, otherwise the wait could last forever
+    GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    if (result == GL_TIMEOUT_EXPIRED) {
+        ++stallsCount;
+        do {
+            result = glClientWaitSync(fence, 0, 1000000);
+        } while (result == GL_TIMEOUT_EXPIRED);
+    }
+    glDeleteSync(fence);
+    regions.pop_front();
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <deque>
+
+// Fixed size GL buffer the CPU writes transient vertices into, regions are reused in order once
+// the draws reading them have finished. The buffer is mapped persistently when ARB_buffer_storage
+// is available, otherwise every write maps its region unsynchronized; fences keep both safe.
+class RingBuffer
+{
+public:
+    explicit RingBuffer(size_t capacity);
+    ~RingBuffer();
+
+    RingBuffer(const RingBuffer&) = delete;
+    RingBuffer& operator=(const RingBuffer&) = delete;
+
+    GLuint GetBuffer() const { return buffer; }
+    size_t GetCapacity() const { return capacity; }
+
+    // Copies the data to an 8 byte aligned offset and returns it, -1 if the data is larger than the buffer.
+    // Waits for the GPU if the region is still read by earlier draws.
+    GLintptr Write(const void* data, size_t size);
+    // Marks the data written since the previous fence as read by the draws issued so far
+    void Fence();
+    // Writes that had to wait for the GPU since the last call
+    size_t TakeStallsCount();
+
+private:
+    struct Region
+    {
+        GLsync fence;
+        size_t begin;
+        size_t end;
+    };
+    void WaitFront();
+
+    GLuint buffer = 0;
+    size_t capacity = 0;
+    GLubyte* mapped = nullptr;
+    size_t head = 0;
+    // start of the data written since the previous fence
+    size_t pendingBegin = 0;
+    std::deque<Region> regions;
+    size_t stallsCount = 0;
+};
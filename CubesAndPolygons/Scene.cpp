@@ -1,16 +1,346 @@
 #include "Scene.h"
+#include "ParallelFor.h"
 #include "TriangulationVisitor.h"
 
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
 
-void Scene::AddEntity(std::shared_ptr<Entity> entity)
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <unordered_map>
+
+void Scene::AddEntity(std::shared_ptr<Entity> entity, const GLfloat* triangulated)
 {
-    size_t startIndex = buffer.size();
+    PendingBatch batch;
+    batch.entities.push_back(entity);
     size_t entityAllocationSize = entity->GetTrianglesCount() * 3 * 3;
-    buffer.resize(buffer.size() + entityAllocationSize);
-    TriangulationVisitor* traingulation = new TriangulationVisitor(buffer, startIndex);
-    entity->Accept(traingulation);
-    entities.push_back(entity);
+
+    if (triangulated) {
+        batch.vertices.assign(triangulated, triangulated + entityAllocationSize);
+    }
+    else if (!lazyTriangulation) {
+        batch.vertices.resize(entityAllocationSize);
+        TriangulationVisitor traingulation(batch.vertices, 0);
+        entity->Accept(&traingulation);
+        entity->BuildDetailLevels(entity->detailLevels);
+    }
+    AddBatch(batch);
+}
+
+void Scene::AddEntities(const std::vector<std::shared_ptr<Entity>>& newEntities, const GLfloat* triangulated)
+{
+    PendingBatch batch;
+    batch.entities = newEntities;
+
+    std::vector<size_t> firstFloats;
+    firstFloats.reserve(newEntities.size());
+    size_t bufferSize = 0;
+    for (const std::shared_ptr<Entity>& entity : newEntities) {
+        firstFloats.push_back(bufferSize);
+        bufferSize += entity->GetTrianglesCount() * 3 * 3;
+    }
+
+    bool triangulate = !triangulated && !lazyTriangulation;
+    if (triangulated)
+        batch.vertices.assign(triangulated, triangulated + bufferSize);
+    else if (triangulate)
+        batch.vertices.resize(bufferSize);
+
+    // entities own disjoint ranges of the batch, so they can be triangulated independently
+    auto process = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            TriangulationVisitor traingulation(batch.vertices, firstFloats[i]);
+            newEntities[i]->Accept(&traingulation);
+            newEntities[i]->BuildDetailLevels(newEntities[i]->detailLevels);
+        }
+    };
+
+    if (triangulate)
+        ParallelFor(newEntities.size(), triangulationThreads, 1024, process);
+    AddBatch(batch);
+}
+
+void Scene::AddBatch(PendingBatch& batch)
+{
+    if (batch.entities.empty())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        pendingBatches.push_back(std::move(batch));
+    }
+    // wakes the owner thread up to commit
+    NotifyChanged();
+}
+
+void Scene::SetTriangulationThreads(unsigned threadsCount)
+{
+    triangulationThreads = threadsCount;
+}
+
+size_t Scene::CommitPendingEntities()
+{
+    std::vector<PendingBatch> batches;
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        batches.swap(pendingBatches);
+    }
+    if (batches.empty())
+        return 0;
+
+    size_t committed = 0;
+    for (PendingBatch& batch : batches) {
+        size_t firstEntity = entities.size();
+        size_t bufferSize = buffer.size();
+        for (const std::shared_ptr<Entity>& entity : batch.entities) {
+            firstVertices.push_back(static_cast<GLint>(bufferSize / 3));
+            trianglesCount += entity->GetTrianglesCount();
+            if (!streamBudget)
+                bufferSize += entity->GetTrianglesCount() * 3 * 3;
+        }
+        entities.insert(entities.end(), batch.entities.begin(), batch.entities.end());
+
+        if (streamBudget) {
+            // the triangles are dropped after they are turned into index lists
+            std::vector<GLfloat> triangulated;
+            size_t batchFloats = 0;
+            for (size_t i = firstEntity; i < entities.size(); ++i) {
+                size_t floatsCount = entities[i]->GetTrianglesCount() * 3 * 3;
+                const GLfloat* vertices = batch.vertices.data() + batchFloats;
+                if (batch.vertices.empty()) {
+                    triangulated.assign(floatsCount, 0.0f);
+                    TriangulationVisitor traingulation(triangulated, 0);
+                    entities[i]->Accept(&traingulation);
+                    entities[i]->BuildDetailLevels(entities[i]->detailLevels);
+                    vertices = triangulated.data();
+                }
+                UpdateBounds(i);
+                AssignPackedVertices(i, false);
+                AddCompactGeometry(i, vertices);
+                batchFloats += floatsCount;
+            }
+            committed += batch.entities.size();
+            continue;
+        }
+
+        // the worker builds the detail levels with the geometry, their vertices are reserved now
+        bool levelsLater = batch.vertices.empty() && triangulationWorker;
+        if (!batch.vertices.empty()) {
+            buffer.insert(buffer.end(), batch.vertices.begin(), batch.vertices.end());
+        }
+        else {
+            buffer.resize(bufferSize);
+            for (size_t i = firstEntity; i < entities.size(); ++i) {
+                if (triangulationWorker) {
+                    AddPlaceholder(i);
+                    triangulationWorker->Add(i, entities[i], IsVisible(*entities[i]));
+                }
+                else {
+                    // lazy mode was switched off after the batch was queued
+                    TriangulationVisitor traingulation(buffer, firstVertices[i] * 3);
+                    entities[i]->Accept(&traingulation);
+                    entities[i]->BuildDetailLevels(entities[i]->detailLevels);
+                }
+            }
+        }
+
+        for (size_t i = firstEntity; i < entities.size(); ++i) {
+            UpdateBounds(i);
+            AssignPackedVertices(i, levelsLater);
+        }
+        MarkDirty(firstEntity, batch.entities.size());
+        committed += batch.entities.size();
+    }
+
+    PublishView();
+    NotifyChanged();
+    return committed;
+}
+
+// new index of a removed entity
+static const size_t RemovedEntity = size_t(-1);
+
+// Moves the values of the kept entities down, remap gives their new indices
+template <typename T>
+static void EraseRemoved(std::vector<T>& values, const std::vector<size_t>& remap)
+{
+    size_t kept = 0;
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (remap[i] != RemovedEntity)
+            values[kept++] = std::move(values[i]);
+    }
+    values.resize(kept);
+}
+
+void Scene::RemoveEntities(std::vector<size_t> indices)
+{
+    std::sort(indices.begin(), indices.end());
+    indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+    indices.erase(std::lower_bound(indices.begin(), indices.end(), entities.size()), indices.end());
+    if (indices.empty())
+        return;
+
+    // the worker, the selection, the group and the kept vertex editor refer to entities by index or buffer position
+    SetSelected(0);
+    ClearGroup();
+    vertexEditor.reset();
+    FinishTriangulation();
+
+    size_t firstRemoved = indices.front();
+    std::vector<size_t> remap(entities.size(), RemovedEntity);
+    size_t keptCount = 0;
+    for (size_t i = 0, r = 0; i < entities.size(); ++i) {
+        if (r < indices.size() && indices[r] == i)
+            ++r;
+        else
+            remap[i] = keptCount++;
+    }
+
+    // streamed geometry of an entity ends where the next one of its format starts
+    std::vector<size_t> vertexEnds, indexEnds;
+    if (streamBudget) {
+        vertexEnds.resize(entities.size());
+        indexEnds.resize(entities.size());
+        size_t nextVertex[VertexFormatsCount];
+        for (int format = 0; format < VertexFormatsCount; ++format)
+            nextVertex[format] = compactVertices[format].size() / VertexComponents[format];
+        size_t nextIndex = compactIndices.size();
+        for (size_t i = entities.size(); i-- > 0;) {
+            vertexEnds[i] = nextVertex[packedVertices[i].format];
+            indexEnds[i] = nextIndex;
+            nextVertex[packedVertices[i].format] = compactGeometry[i].firstVertex;
+            nextIndex = compactGeometry[i].firstIndex;
+        }
+    }
+
+    // geometry of the kept entities moves down in the order of the entities, packed vertices of a format
+    // stay one after another; the entities before the first removed one stay where they are
+    size_t bufferEnd = 0, indicesEnd = 0;
+    size_t packedEnds[VertexFormatsCount] = {}, vertexCursors[VertexFormatsCount] = {};
+    for (size_t i = 0; i < entities.size(); ++i) {
+        size_t entityTriangles = entities[i]->GetTrianglesCount();
+        if (remap[i] == RemovedEntity) {
+            trianglesCount -= entityTriangles;
+            continue;
+        }
+        size_t k = remap[i];
+        if (!streamBudget) {
+            size_t first = firstVertices[i] * 3;
+            if (first != bufferEnd)
+                std::copy(buffer.begin() + first, buffer.begin() + first + entityTriangles * 3 * 3, buffer.begin() + bufferEnd);
+            firstVertices[k] = static_cast<GLint>(bufferEnd / 3);
+            bufferEnd += entityTriangles * 3 * 3;
+        }
+        else {
+            // indices are relative to the first vertex of the entity, so they are copied as they are
+            CompactGeometry& geometry = compactGeometry[i];
+            int format = packedVertices[i].format;
+            int components = VertexComponents[format];
+            std::vector<GLushort>& formatVertices = compactVertices[format];
+            if (geometry.firstVertex != vertexCursors[format]) {
+                std::copy(formatVertices.begin() + geometry.firstVertex * components, formatVertices.begin() + vertexEnds[i] * components,
+                    formatVertices.begin() + vertexCursors[format] * components);
+            }
+            if (geometry.firstIndex != indicesEnd)
+                std::copy(compactIndices.begin() + geometry.firstIndex, compactIndices.begin() + indexEnds[i], compactIndices.begin() + indicesEnd);
+            CompactGeometry moved = { vertexCursors[format], indicesEnd };
+            vertexCursors[format] += vertexEnds[i] - geometry.firstVertex;
+            indicesEnd += indexEnds[i] - geometry.firstIndex;
+            compactGeometry[k] = moved;
+            firstVertices[k] = firstVertices[i];
+        }
+        PackedVertices packed = packedVertices[i];
+        packed.first = static_cast<GLint>(packedEnds[packed.format]);
+        packedEnds[packed.format] += packed.count;
+        packedVertices[k] = packed;
+        entities[k] = std::move(entities[i]);
+    }
+    entities.resize(keptCount);
+    firstVertices.resize(keptCount);
+    packedVertices.resize(keptCount);
+    std::copy(packedEnds, packedEnds + VertexFormatsCount, packedVerticesCount);
+    if (!streamBudget) {
+        buffer.resize(bufferEnd);
+    }
+    else {
+        compactGeometry.resize(keptCount);
+        for (int format = 0; format < VertexFormatsCount; ++format)
+            compactVertices[format].resize(vertexCursors[format] * VertexComponents[format]);
+        compactIndices.resize(indicesEnd);
+    }
+
+    for (std::vector<size_t>& attached : nodeEntities) {
+        size_t kept = 0;
+        for (size_t index : attached) {
+            if (remap[index] != RemovedEntity)
+                attached[kept++] = remap[index];
+        }
+        attached.resize(kept);
+    }
+    EraseRemoved(entityNodes, remap);
+    grouped.resize(std::min(grouped.size(), keptCount));
+
+    // the moved geometry is uploaded again, changes queued before it stay as they are
+    for (EntityRange& range : dirtyEntities) {
+        range.count = std::min(range.first + range.count, firstRemoved) - std::min(range.first, firstRemoved);
+    }
+    dirtyEntities.erase(std::remove_if(dirtyEntities.begin(), dirtyEntities.end(),
+        [](const EntityRange& range) { return range.count == 0; }), dirtyEntities.end());
+    dirtyTriangles.erase(std::remove_if(dirtyTriangles.begin(), dirtyTriangles.end(),
+        [firstRemoved](const TriangleRange& range) { return range.entity >= firstRemoved; }), dirtyTriangles.end());
+    collisionShapes.clear();
+    if (!streamBudget)
+        MarkDirty(firstRemoved, keptCount - firstRemoved);
+
+    RebuildBoundsTree();
+    vertexGridOutdated = true;
+    vertexGridDirty.clear();
+    viewEntitiesFrom = std::min(viewEntitiesFrom, firstRemoved);
+    PublishView();
+    NotifyChanged();
+}
+
+std::shared_ptr<const SceneView> Scene::GetView() const
+{
+    return std::atomic_load(&view);
+}
+
+void Scene::PublishView()
+{
+    std::shared_ptr<const SceneView> previous = std::atomic_load(&view);
+    std::shared_ptr<SceneView> next = std::make_shared<SceneView>();
+    next->epoch = previous->epoch + 1;
+    next->entitiesCount = entities.size();
+
+    // older views keep sharing the chunks before the first changed entity, the rest are built again
+    size_t chunksCount = (entities.size() + SceneView::ChunkSize - 1) / SceneView::ChunkSize;
+    size_t firstChanged = std::min(viewEntitiesFrom / SceneView::ChunkSize, previous->chunks.size());
+    next->chunks.assign(previous->chunks.begin(), previous->chunks.begin() + firstChanged);
+    next->transforms.assign(previous->transforms.begin(), previous->transforms.begin() + firstChanged);
+    viewMovedChunks.resize(chunksCount, true);
+    for (size_t c = 0; c < chunksCount; ++c) {
+        size_t first = c * SceneView::ChunkSize;
+        size_t last = std::min(first + SceneView::ChunkSize, entities.size());
+        if (c >= firstChanged) {
+            std::shared_ptr<SceneView::Chunk> chunk = std::make_shared<SceneView::Chunk>();
+            chunk->entities.assign(entities.begin() + first, entities.begin() + last);
+            chunk->firstVertices.assign(firstVertices.begin() + first, firstVertices.begin() + last);
+            next->chunks.push_back(chunk);
+            next->transforms.push_back(nullptr);
+        }
+        if (c < firstChanged && !viewMovedChunks[c])
+            continue;
+        std::shared_ptr<SceneView::TransformChunk> transforms = std::make_shared<SceneView::TransformChunk>(last - first);
+        for (size_t i = first; i < last; ++i)
+            (*transforms)[i - first] = entities[i]->GetTransform();
+        next->transforms[c] = transforms;
+    }
+
+    viewOutdated = false;
+    viewEntitiesFrom = entities.size();
+    viewMovedChunks.assign(chunksCount, false);
+    std::atomic_store(&view, std::shared_ptr<const SceneView>(next));
 }
 
 std::shared_ptr<Entity> Scene::GetEntity(size_t index)
@@ -23,11 +353,16 @@ std::shared_ptr<Entity> Scene::GetEntity(size_t index)
     return entities[index];
 }
 
-std::vector<std::shared_ptr<Entity>>& Scene::GetEntities()
+const std::vector<std::shared_ptr<Entity>>& Scene::GetEntities() const
 {
     return entities;
 }
 
+GLint Scene::GetFirstVertex(size_t index) const
+{
+    return firstVertices[index];
+}
+
 size_t Scene::GetBufferAllocationSize() const
 {
     return buffer.size() * sizeof(GLfloat);
@@ -38,40 +373,585 @@ const GLfloat* Scene::GetBufferAsArray() const
     return buffer.data();// &buffer[0];
 }
 
+void Scene::UpdateBounds(size_t index)
+{
+    glm::vec3 minPoint, maxPoint;
+    entities[index]->GetWorldBounds(minPoint, maxPoint);
+    SetBounds(index, glm::vec2(minPoint), glm::vec2(maxPoint));
+}
+
+void Scene::SetBounds(size_t index, const glm::vec2& minPoint, const glm::vec2& maxPoint)
+{
+    // every transform change ends here, the view gets the new transform before the next frame
+    size_t chunk = index / SceneView::ChunkSize;
+    if (chunk < viewMovedChunks.size()) {
+        viewMovedChunks[chunk] = true;
+        viewOutdated = true;
+    }
+    boundsTree.Insert(index, minPoint, maxPoint);
+    if (!boundsTree.Contains(minPoint, maxPoint))
+        boundsTreeOutdated = true;
+
+    // the vertex grid follows the changed entities once it is built, many of them are cheaper to build again
+    if (!vertexGridOutdated && (vertexGridDirty.empty() || vertexGridDirty.back() != index)) {
+        vertexGridDirty.push_back(index);
+        if (vertexGridDirty.size() > entities.size() / 4 + 64) {
+            vertexGridDirty.clear();
+            vertexGridOutdated = true;
+        }
+    }
+}
+
+void Scene::GetVisibleEntities(std::vector<size_t>& visible)
+{
+    if (boundsTreeOutdated)
+        RebuildBoundsTree();
+
+    visible.clear();
+    boundsTree.Query(viewportMin, viewportMax, visible);
+    std::sort(visible.begin(), visible.end());
+}
+
+void Scene::RebuildBoundsTree()
+{
+    std::vector<glm::vec2> bounds(entities.size() * 2);
+    glm::vec2 sceneMin = viewportMin;
+    glm::vec2 sceneMax = viewportMax;
+    for (size_t i = 0; i < entities.size(); ++i) {
+        glm::vec3 minPoint, maxPoint;
+        entities[i]->GetWorldBounds(minPoint, maxPoint);
+        bounds[2 * i] = glm::vec2(minPoint);
+        bounds[2 * i + 1] = glm::vec2(maxPoint);
+        sceneMin = glm::min(sceneMin, bounds[2 * i]);
+        sceneMax = glm::max(sceneMax, bounds[2 * i + 1]);
+    }
+
+    // square region with a margin, so entities moved a bit further do not cause another rebuild
+    glm::vec2 center = (sceneMin + sceneMax) * 0.5f;
+    float halfSize = std::max(sceneMax.x - sceneMin.x, sceneMax.y - sceneMin.y);
+    boundsTree = LooseQuadTree(center - glm::vec2(halfSize), center + glm::vec2(halfSize));
+    for (size_t i = 0; i < entities.size(); ++i)
+        boundsTree.Insert(i, bounds[2 * i], bounds[2 * i + 1]);
+    boundsTreeOutdated = false;
+}
+
+void Scene::SetLazyTriangulation(bool enabled)
+{
+    // placeholders are replaced in the float buffer, which streamed mode does not keep
+    if (streamBudget)
+        enabled = false;
+    lazyTriangulation = enabled;
+    if (enabled && !triangulationWorker) {
+        triangulationWorker.reset(new TriangulationWorker());
+        triangulationWorker->SetResultCallback(changedCallback);
+    }
+    else if (!enabled && triangulationWorker) {
+        // finish queued entities in place
+        FinishTriangulation();
+        triangulationWorker.reset();
+    }
+}
+
+void Scene::FinishTriangulation()
+{
+    if (!triangulationWorker)
+        return;
+    triangulationWorker->Reprioritize([](const Entity&) { return true; });
+    while (triangulationWorker->IsBusy())
+        UpdateTriangulation();
+}
+
+void Scene::SetViewport(const glm::vec2& minPoint, const glm::vec2& maxPoint, float pixelSize)
+{
+    if (minPoint == viewportMin && maxPoint == viewportMax && pixelSize == viewportPixelSize)
+        return;
+
+    viewportMin = minPoint;
+    viewportMax = maxPoint;
+    viewportPixelSize = pixelSize;
+    if (triangulationWorker)
+        triangulationWorker->Reprioritize([this](const Entity& entity) { return IsVisible(entity); });
+    NotifyChanged();
+}
+
+void Scene::SetStreamedGeometry(size_t budget)
+{
+    if (budget)
+        SetLazyTriangulation(false);
+    streamBudget = budget;
+}
+
+bool Scene::IsGeometryStreamed() const
+{
+    return streamBudget > 0;
+}
+
+bool Scene::UpdateTriangulation()
+{
+    if (!triangulationWorker)
+        return false;
+
+    std::vector<TriangulationWorker::Result> results = triangulationWorker->TakeResults();
+    for (TriangulationWorker::Result& result : results) {
+        size_t first = firstVertices[result.index] * 3;
+        std::copy(result.vertices.begin(), result.vertices.end(), buffer.begin() + first);
+        entities[result.index]->detailLevels.swap(result.detailLevels);
+        FitDetailLevels(result.index);
+        MarkDirty(result.index, 1);
+    }
+
+    if (!results.empty())
+        NotifyChanged();
+    return !results.empty();
+}
+
+bool Scene::HasPendingTriangulation() const
+{
+    return triangulationWorker && triangulationWorker->IsBusy();
+}
+
+void Scene::TakeVertexUpdates(std::vector<VertexUpdate>& updates)
+{
+    updates.clear();
+    for (const EntityRange& range : dirtyEntities) {
+        // entities of a format are packed one after another, so a range gives one update per format
+        const size_t NoUpdate = size_t(-1);
+        size_t formatUpdates[VertexFormatsCount];
+        std::fill(formatUpdates, formatUpdates + VertexFormatsCount, NoUpdate);
+        for (size_t i = range.first; i < range.first + range.count; ++i) {
+            const PackedVertices& packed = packedVertices[i];
+            if (formatUpdates[packed.format] == NoUpdate) {
+                formatUpdates[packed.format] = updates.size();
+                updates.push_back(VertexUpdate());
+                updates.back().format = packed.format;
+                updates.back().totalVertices = packedVerticesCount[packed.format];
+                updates.back().firstVertex = packed.first;
+            }
+            VertexUpdate& update = updates[formatUpdates[packed.format]];
+            size_t offset = update.data.size();
+            update.data.resize(offset + packed.count * VertexComponents[packed.format]);
+            PackDetailLevels(i, buffer.data() + firstVertices[i] * 3, update.data.data() + offset);
+        }
+    }
+    dirtyEntities.clear();
+
+    for (const TriangleRange& range : dirtyTriangles) {
+        const PackedVertices& packed = packedVertices[range.entity];
+        updates.push_back(VertexUpdate());
+        VertexUpdate& update = updates.back();
+        update.format = packed.format;
+        update.totalVertices = packedVerticesCount[packed.format];
+        update.firstVertex = packed.first + range.first * 3;
+        update.data.resize(range.count * 3 * VertexComponents[packed.format]);
+        PackVertices(range.entity, buffer.data() + (firstVertices[range.entity] + range.first * 3) * 3, range.count * 3, update.data.data());
+    }
+    dirtyTriangles.clear();
+}
+
+void Scene::AssignPackedVertices(size_t index, bool reserveDetailLevels)
+{
+    // bounds do not change with the entity transform, so the encoding is fixed unless polygon vertices are edited
+    glm::vec3 minPoint, maxPoint;
+    entities[index]->GetBounds(minPoint, maxPoint);
+
+    PackedVertices packed;
+    packed.format = (minPoint.z == 0.0f && maxPoint.z == 0.0f) ? VertexPlanar : VertexSolid;
+    packed.first = static_cast<GLint>(packedVerticesCount[packed.format]);
+    packed.count = reserveDetailLevels ? entities[index]->GetTrianglesCount() * 3 + entities[index]->GetDetailVerticesLimit()
+        : GetPackedVerticesCount(index);
+    packed.offset = minPoint;
+    packed.scale = maxPoint - minPoint;
+    packedVertices.push_back(packed);
+    packedVerticesCount[packed.format] += packed.count;
+}
+
+size_t Scene::GetPackedVerticesCount(size_t index) const
+{
+    size_t verticesCount = entities[index]->GetTrianglesCount() * 3;
+    for (const DetailLevel& level : entities[index]->detailLevels)
+        verticesCount += level.verticesCount;
+    return verticesCount;
+}
+
+void Scene::GetDetailLevelRange(size_t index, size_t level, size_t& first, size_t& count) const
+{
+    const std::vector<DetailLevel>& levels = entities[index]->detailLevels;
+    first = 0;
+    count = entities[index]->GetTrianglesCount() * 3;
+    for (size_t k = 0; k < level; ++k) {
+        first += count;
+        count = levels[k].verticesCount;
+    }
+}
+
+size_t Scene::SelectDetailLevel(size_t index) const
+{
+    // the coarsest level that stays within a pixel of the full outline
+    const std::vector<DetailLevel>& levels = entities[index]->detailLevels;
+    size_t level = 0;
+    while (level < levels.size() && levels[level].tolerance <= viewportPixelSize)
+        ++level;
+    return level;
+}
+
+void Scene::PackDetailLevels(size_t index, const GLfloat* vertices, GLushort* packed) const
+{
+    int components = VertexComponents[packedVertices[index].format];
+    size_t verticesCount = entities[index]->GetTrianglesCount() * 3;
+    PackVertices(index, vertices, verticesCount, packed);
+    for (const DetailLevel& level : entities[index]->detailLevels) {
+        packed += verticesCount * components;
+        verticesCount = level.verticesCount;
+        PackVertices(index, level.vertices.data(), verticesCount, packed);
+    }
+}
+
+void Scene::PackVertices(size_t index, const GLfloat* vertices, size_t verticesCount, GLushort* packed) const
+{
+    const PackedVertices& encoding = packedVertices[index];
+    int components = VertexComponents[encoding.format];
+
+    glm::vec3 inverseScale;
+    for (int k = 0; k < 3; ++k)
+        inverseScale[k] = encoding.scale[k] > 0.0f ? 65535.0f / encoding.scale[k] : 0.0f;
+
+    for (size_t v = 0; v < verticesCount; ++v) {
+        for (int k = 0; k < std::min(components, 3); ++k) {
+            float value = (vertices[v * 3 + k] - encoding.offset[k]) * inverseScale[k];
+            packed[v * components + k] = static_cast<GLushort>(glm::clamp(value + 0.5f, 0.0f, 65535.0f));
+        }
+        for (int k = 3; k < components; ++k)
+            packed[v * components + k] = 0;
+    }
+}
+
+void Scene::AddCompactGeometry(size_t index, const GLfloat* vertices)
+{
+    const PackedVertices& encoding = packedVertices[index];
+    size_t verticesCount = GetPackedVerticesCount(index);
+    int components = VertexComponents[encoding.format];
+    std::vector<GLushort>& formatVertices = compactVertices[encoding.format];
+
+    CompactGeometry geometry;
+    geometry.firstVertex = formatVertices.size() / components;
+    geometry.firstIndex = compactIndices.size();
+    compactGeometry.push_back(geometry);
+
+    std::vector<GLushort> packed(verticesCount * components);
+    PackDetailLevels(index, vertices, packed.data());
+
+    // triangles share corners and detail levels share the outline points, identical packed vertices are stored once
+    std::unordered_map<uint64_t, GLuint> uniqueVertices;
+    for (size_t v = 0; v < verticesCount; ++v) {
+        const GLushort* vertex = packed.data() + v * components;
+        uint64_t key = 0;
+        for (int k = 0; k < components; ++k)
+            key = (key << 16) | vertex[k];
+        auto inserted = uniqueVertices.emplace(key, static_cast<GLuint>(uniqueVertices.size()));
+        if (inserted.second)
+            formatVertices.insert(formatVertices.end(), vertex, vertex + components);
+        compactIndices.push_back(inserted.first->second);
+    }
+    for (DetailLevel& level : entities[index]->detailLevels)
+        std::vector<GLfloat>().swap(level.vertices);
+}
+
+bool Scene::ExpandCompactGeometry(size_t index, size_t level, std::vector<GLushort>& streamed, GLint& firstVertex) const
+{
+    const PackedVertices& encoding = packedVertices[index];
+    const CompactGeometry& geometry = compactGeometry[index];
+    size_t levelFirst, verticesCount;
+    GetDetailLevelRange(index, level, levelFirst, verticesCount);
+    int components = VertexComponents[encoding.format];
+
+    // a frame gets half of the ring buffer, the other half may still be read by the previous frame;
+    // items start on 8 bytes, so the renderer can address them in vertices of either format
+    size_t limit = streamBudget / 2 / sizeof(GLushort);
+    size_t first = (streamed.size() + 3) & ~size_t(3);
+    if (first + verticesCount * components > limit)
+        return false;
+
+    streamed.resize(first + verticesCount * components);
+    const GLushort* source = compactVertices[encoding.format].data() + geometry.firstVertex * components;
+    const GLuint* indices = compactIndices.data() + geometry.firstIndex + levelFirst;
+    GLushort* target = streamed.data() + first;
+    for (size_t v = 0; v < verticesCount; ++v)
+        std::copy(source + indices[v] * components, source + (indices[v] + 1) * components, target + v * components);
+
+    firstVertex = static_cast<GLint>(first / components);
+    return true;
+}
+
+void Scene::BuildFrameSnapshot(FrameSnapshot& snapshot, bool depthMode)
+{
+    UpdateHierarchy();
+    if (viewOutdated)
+        PublishView();
+    GetVisibleEntities(visibleEntities);
+    if (depthMode) {
+        // with depth test the order does not change the picture, so entities are grouped by
+        // render state (culling, color) to save state changes, then coarse front-to-back
+        // by entity origin within a group, so early depth test rejects hidden fragments
+        std::stable_sort(visibleEntities.begin(), visibleEntities.end(), [this](size_t a, size_t b) {
+            const Entity& first = *entities[a];
+            const Entity& second = *entities[b];
+            if (first.IsClosed() != second.IsClosed())
+                return first.IsClosed();
+            const float* firstColor = first.GetColor();
+            const float* secondColor = second.GetColor();
+            if (std::lexicographical_compare(firstColor, firstColor + 4, secondColor, secondColor + 4))
+                return true;
+            if (std::lexicographical_compare(secondColor, secondColor + 4, firstColor, firstColor + 4))
+                return false;
+            return (first.groupTransform * first.translation[3]).z < (second.groupTransform * second.translation[3]).z;
+        });
+    }
+
+    snapshot.items.resize(visibleEntities.size());
+    snapshot.streamedVertices.clear();
+    snapshot.skippedEntities = 0;
+    snapshot.simplifiedTriangles = 0;
+    std::fill(snapshot.detailEntities, snapshot.detailEntities + DetailKindsCount, 0);
+    std::fill(snapshot.detailTriangles, snapshot.detailTriangles + DetailKindsCount, 0);
+    size_t itemsCount = 0;
+    for (size_t i = 0; i < visibleEntities.size(); ++i) {
+        const Entity& entity = *entities[visibleEntities[i]];
+        DrawItem& item = snapshot.items[itemsCount];
+        const PackedVertices& packed = packedVertices[visibleEntities[i]];
+        size_t level = SelectDetailLevel(visibleEntities[i]);
+        DetailKind kind = DetailFull;
+        if (level > 0)
+            kind = entity.detailLevels[level - 1].impostor ? DetailImpostor : DetailSimplified;
+        glm::mat4 placement = entity.GetTransform();
+        if (kind == DetailImpostor)
+            placement = glm::translate(glm::mat4(1.0f), glm::vec3(placement[3]));
+        item.transform = placement * glm::scale(glm::translate(glm::mat4(1.0f), packed.offset), packed.scale);
+        item.color = glm::make_vec4(entity.GetColor());
+        if (visibleEntities[i] < grouped.size() && grouped[visibleEntities[i]])
+            item.color = glm::vec4(glm::mix(glm::vec3(item.color), glm::vec3(1.0f), 0.5f), item.color.a);
+        item.format = packed.format;
+        size_t levelFirst, levelCount;
+        GetDetailLevelRange(visibleEntities[i], level, levelFirst, levelCount);
+        item.firstVertex = packed.first + static_cast<GLint>(levelFirst);
+        item.verticesCount = static_cast<GLsizei>(levelCount);
+        item.stencilId = static_cast<GLint>(visibleEntities[i] + 1);
+        item.closed = entity.IsClosed();
+        if (streamBudget && !ExpandCompactGeometry(visibleEntities[i], level, snapshot.streamedVertices, item.firstVertex)) {
+            ++snapshot.skippedEntities;
+            continue;
+        }
+        snapshot.simplifiedTriangles += entity.GetTrianglesCount() - item.verticesCount / 3;
+        ++snapshot.detailEntities[kind];
+        snapshot.detailTriangles[kind] += item.verticesCount / 3;
+        ++itemsCount;
+    }
+    snapshot.items.resize(itemsCount);
+    snapshot.streamBudget = streamBudget;
+    // z is kept as it is (near 1, far -1), so depth and the winding of closed meshes do not change
+    snapshot.viewProjection = glm::ortho(viewportMin.x, viewportMax.x, viewportMin.y, viewportMax.y, 1.0f, -1.0f);
+    snapshot.depthMode = depthMode;
+    snapshot.entitiesCount = entities.size();
+    snapshot.trianglesCount = trianglesCount;
+
+    snapshot.selectionOutline.clear();
+    if (band_open && !band_lasso) {
+        glm::vec2 corner = band_points[0], opposite = band_points[1];
+        snapshot.selectionOutline = { corner, glm::vec2(opposite.x, corner.y), opposite, glm::vec2(corner.x, opposite.y) };
+    }
+    else if (band_open) {
+        snapshot.selectionOutline = band_points;
+    }
+}
+
+bool Scene::IsVisible(const Entity& entity) const
+{
+    glm::vec3 minPoint, maxPoint;
+    entity.GetWorldBounds(minPoint, maxPoint);
+    return minPoint.x <= viewportMax.x && maxPoint.x >= viewportMin.x &&
+        minPoint.y <= viewportMax.y && maxPoint.y >= viewportMin.y;
+}
+
+void Scene::AddPlaceholder(size_t index)
+{
+    // bounding rectangle while the real geometry is not ready, the rest of the range is degenerate
+    size_t first = firstVertices[index] * 3;
+    size_t count = entities[index]->GetTrianglesCount() * 3 * 3;
+    std::fill(buffer.begin() + first, buffer.begin() + first + count, 0.0f);
+
+    glm::vec3 minPoint, maxPoint;
+    entities[index]->GetBounds(minPoint, maxPoint);
+    const GLfloat rectangle[] = {
+        minPoint.x, minPoint.y, 0.0f,  maxPoint.x, minPoint.y, 0.0f,  maxPoint.x, maxPoint.y, 0.0f,
+        minPoint.x, minPoint.y, 0.0f,  maxPoint.x, maxPoint.y, 0.0f,  minPoint.x, maxPoint.y, 0.0f
+    };
+    std::copy(rectangle, rectangle + std::min(count, sizeof(rectangle) / sizeof(GLfloat)), buffer.begin() + first);
+}
+
+void Scene::SetChangedCallback(std::function<void()> callback)
+{
+    changedCallback = callback;
+    if (triangulationWorker)
+        triangulationWorker->SetResultCallback(callback);
+}
+
+bool Scene::TakeChanged()
+{
+    return changed.exchange(false);
+}
+
+void Scene::NotifyChanged()
+{
+    changed = true;
+    if (changedCallback)
+        changedCallback();
+}
+
+void Scene::MarkDirty(size_t firstEntity, size_t count)
+{
+    for (size_t i = firstEntity; i < firstEntity + count && !collisionShapes.empty(); ++i)
+        collisionShapes.erase(i);
+    if (count == 0)
+        return;
+    if (!dirtyEntities.empty() && dirtyEntities.back().first + dirtyEntities.back().count == firstEntity) {
+        dirtyEntities.back().count += count;
+        return;
+    }
+
+    EntityRange range = { firstEntity, count };
+    dirtyEntities.push_back(range);
+}
+
 void Scene::MouseMove(float xpos, float ypos, int width, int height) {
 
+    if (band_open) {
+        glm::vec2 point = GetWorldPoint(xpos, ypos, width, height);
+        // a rectangle keeps its first corner, a lasso gets a point every few pixels
+        float pixelSize = (viewportMax.x - viewportMin.x) / width;
+        if (!band_lasso)
+            band_points.back() = point;
+        else if (glm::length(point - band_points.back()) >= 2.0f * pixelSize)
+            band_points.push_back(point);
+        NotifyChanged();
+        return;
+    }
     if (selected == -1)
         return;
 
     double xdiff = (xpos - xpos_selected);
     double ydiff = (ypos_selected - ypos);
 
-    std::shared_ptr<Entity> entity = GetEntity(selected);
-    if (rotation_mode) {
-        glm::vec4 rotationCenter =  entity->translation * glm::vec4(0.0, 0.0, 0.0, 1.0);
-        float xreal = ((xpos / width) - 0.5) * 2.0;
-        float yreal = (0.5 - (ypos / height)) * 2.0;
-        if (xreal < rotationCenter.x) {
+    if (rotation_mode && selected_vertex < 0) {
+        // the direction depends on the cursor position at every event, so it is resolved here
+        std::shared_ptr<Entity> entity = GetEntity(selected);
+        glm::vec4 rotationCenter = entity->GetTransform() * glm::vec4(0.0, 0.0, 0.0, 1.0);
+        if (group_drag)
+            rotationCenter = glm::vec4(group_center, 0.0, 1.0);
+        else if (GetEntityNode(selected) != TransformHierarchy::NoNode)
+            rotationCenter = hierarchy.GetWorldTransform(hierarchy.GetRoot(GetEntityNode(selected)))[3];
+        glm::vec2 cursor = GetWorldPoint(xpos, ypos, width, height);
+        if (cursor.x < rotationCenter.x) {
             ydiff = -ydiff;
         }
-        if (yreal > rotationCenter.y) {
+        if (cursor.y > rotationCenter.y) {
             xdiff = -xdiff;
         }
-        entity->Rotate(xdiff, ydiff);
+        pending_rotation += glm::vec2(xdiff, ydiff);
     }
     else {
-        xdiff *= 2.0f / width;
-        ydiff *= 2.0f / height;
-        entity->translation = glm::translate(entity->translation, glm::vec3(xdiff, ydiff, 0.0));
+        // cursor pixels to world units of the current viewport
+        snap_distance = SnapPixels * (viewportMax.x - viewportMin.x) / width;
+        xdiff *= (viewportMax.x - viewportMin.x) / width;
+        ydiff *= (viewportMax.y - viewportMin.y) / height;
+        pending_translation += glm::vec2(xdiff, ydiff);
     }
+    moves_pending = true;
+    ++received_moves;
 
     xpos_selected = xpos;
     ypos_selected = ypos;
 }
 
+void Scene::ApplyMouseMoves()
+{
+    if (!moves_pending)
+        return;
+
+    std::shared_ptr<Entity> entity = GetEntity(selected);
+    if (selected_vertex >= 0) {
+        MoveSelectedVertex(pending_translation);
+    }
+    else if (group_drag) {
+        MoveGroup(pending_translation, pending_rotation.x + pending_rotation.y);
+    }
+    else if (GetEntityNode(selected) != TransformHierarchy::NoNode) {
+        MoveSelectedRoot(pending_translation, pending_rotation.x + pending_rotation.y);
+    }
+    else {
+        if (pending_rotation != glm::vec2(0.0)) {
+            glm::mat4 previousRotation = entity->rotation;
+            glm::mat4 previousTranslation = entity->translation;
+            entity->Rotate(pending_rotation.x, pending_rotation.y);
+            if (collisions && !ResolveCollisions(MaxCollisionPushes)) {
+                entity->rotation = previousRotation;
+                entity->translation = previousTranslation;
+                ++blockedMoves;
+            }
+        }
+        if (pending_translation != glm::vec2(0.0)) {
+            // the cursor keeps moving from where the entity was before the last snap
+            TranslateSelected(pending_translation - snap_offset);
+            snap_offset = glm::vec2(0.0);
+            if (snapping) {
+                std::vector<VertexGrid::Vertex> moved;
+                GetWorldVertices(selected, moved);
+                if (FindSnapOffset(moved, snap_offset))
+                    entity->translation = glm::translate(entity->translation, glm::vec3(snap_offset, 0.0));
+                // snapping into another entity is not pushed out, the entity stays where the cursor took it
+                if (collisions && snap_offset != glm::vec2(0.0) && !ResolveCollisions(0)) {
+                    entity->translation = glm::translate(entity->translation, glm::vec3(-snap_offset, 0.0));
+                    snap_offset = glm::vec2(0.0);
+                }
+            }
+        }
+    }
+    if (!group_drag && GetEntityNode(selected) == TransformHierarchy::NoNode)
+        UpdateBounds(selected);
+    UpdateHierarchy();
+    NotifyChanged();
+
+    moves_pending = false;
+    pending_translation = glm::vec2(0.0);
+    pending_rotation = glm::vec2(0.0);
+    ++applied_moves;
+}
+
+void Scene::TakeMouseMoveCounters(size_t& received, size_t& applied)
+{
+    received = received_moves;
+    applied = applied_moves;
+    received_moves = applied_moves = 0;
+}
+
 void Scene::SetSelected(int index, double xpos, double ypos)
 {
-    selected = index - 1;
+    ApplyMouseMoves();
+    if (selected_vertex >= 0) {
+        FinishVertexEditing();
+        selected_vertex = -1;
+    }
+    if (selected != index - 1) {
+        selected = index - 1;
+        NotifyChanged();
+    }
+    // the group stays selected when it is released, picking an entity outside of it drops it
+    group_drag = selected >= 0 && size_t(selected) < grouped.size() && grouped[selected];
+    if (selected >= 0 && !group_drag)
+        ClearGroup();
+    // a released entity stays where it snapped
+    snap_offset = glm::vec2(0.0);
+    collision_ignored.clear();
+    if (collisions && selected >= 0)
+        FindOverlapping(collision_ignored);
     xpos_selected = xpos;
     ypos_selected = ypos;
     printf("selected %d\n", selected);
@@ -79,5 +959,700 @@ void Scene::SetSelected(int index, double xpos, double ypos)
 
 void Scene::SetRotationMode(bool switchedOn)
 {
+    ApplyMouseMoves();
     rotation_mode = switchedOn;
-}
\ No newline at end of file
+}
+bool Scene::SelectVertex(double xpos, double ypos, int width, int height)
+{
+    SetSelected(0);
+    // the vertex editor rewrites triangles in the float buffer, which streamed mode does not keep
+    // and the lazy triangulation may still overwrite
+    if (streamBudget || HasPendingTriangulation())
+        return false;
+
+    glm::vec2 cursor = GetWorldPoint(xpos, ypos, width, height);
+    float radius = VertexPickPixels * (viewportMax.x - viewportMin.x) / width;
+
+    std::vector<size_t> candidates;
+    if (boundsTreeOutdated)
+        RebuildBoundsTree();
+    boundsTree.Query(cursor - glm::vec2(radius), cursor + glm::vec2(radius), candidates);
+
+    int vertex = -1;
+    float vertexDistance = radius;
+    for (size_t index : candidates) {
+        const Polygon2D* polygon = dynamic_cast<const Polygon2D*>(entities[index].get());
+        if (!polygon)
+            continue;
+        // entities are only translated and rotated, so distances are the same in polygon coordinates
+        glm::vec2 local = glm::vec2(glm::inverse(polygon->GetTransform()) * glm::vec4(cursor, 0.0, 1.0));
+        for (size_t i = 0; i < polygon->points.size(); ++i) {
+            float distance = glm::length(polygon->points[i] - local);
+            if (distance <= vertexDistance) {
+                vertexDistance = distance;
+                vertex = static_cast<int>(i);
+                selected = static_cast<int>(index);
+            }
+        }
+    }
+    if (vertex < 0)
+        return false;
+
+    selected_vertex = vertex;
+    xpos_selected = xpos;
+    ypos_selected = ypos;
+    if (!vertexEditor || editedEntity != size_t(selected)) {
+        editedEntity = selected;
+        vertexEditor.reset(new PolygonEditor(std::static_pointer_cast<Polygon2D>(entities[selected]),
+            buffer.data() + firstVertices[selected] * 3));
+        WriteEditedTriangles();
+    }
+    vertex_target = vertexEditor->GetPolygon()->points[vertex];
+    NotifyChanged();
+    return true;
+}
+
+void Scene::MoveSelectedVertex(const glm::vec2& translation)
+{
+    auto startTime = std::chrono::steady_clock::now();
+    Entity& entity = *entities[selected];
+    // world units to polygon coordinates, the rotation is undone by its transpose
+    glm::mat4 transform = entity.GetTransform();
+    vertex_target += glm::vec2(glm::transpose(glm::mat3(transform)) * glm::vec3(translation, 0.0f));
+    glm::vec2 target = vertex_target;
+    if (snapping) {
+        std::vector<VertexGrid::Vertex> moved(1);
+        moved[0].position = glm::vec2(transform * glm::vec4(target, 0.0, 1.0));
+        glm::vec2 offset;
+        if (FindSnapOffset(moved, offset))
+            target = glm::vec2(glm::inverse(transform) * glm::vec4(moved[0].position + offset, 0.0, 1.0));
+    }
+    PolygonEditor::EditKind kind = vertexEditor->MoveVertex(selected_vertex, target);
+    ++vertexEditCounters[kind];
+    if (kind == PolygonEditor::EditRejected)
+        return;
+
+    if (!entity.detailLevels.empty()) {
+        // full geometry is drawn until the editing is finished
+        entity.detailLevels.clear();
+        detailLevelsOutdated = true;
+        MarkDirty(selected, 1);
+    }
+    WriteEditedTriangles();
+
+    glm::vec3 minPoint, maxPoint;
+    entity.GetBounds(minPoint, maxPoint);
+    PackedVertices& packed = packedVertices[selected];
+    if (glm::any(glm::lessThan(minPoint, packed.offset)) || glm::any(glm::greaterThan(maxPoint, packed.offset + packed.scale))) {
+        // the vertex left the packing bounds, the new ones get a margin so the entity is not packed again on every move
+        glm::vec3 margin = (maxPoint - minPoint) * 0.25f;
+        packed.offset = minPoint - margin;
+        packed.scale = maxPoint - minPoint + margin * 2.0f;
+        MarkDirty(selected, 1);
+    }
+
+    std::chrono::duration<double, std::milli> editTime = std::chrono::steady_clock::now() - startTime;
+    slowestVertexEdit = std::max(slowestVertexEdit, editTime.count());
+}
+
+void Scene::WriteEditedTriangles()
+{
+    collisionShapes.erase(editedEntity);
+    std::vector<size_t> changed;
+    vertexEditor->TakeChangedTriangles(changed);
+    GLfloat* vertices = buffer.data() + firstVertices[editedEntity] * 3;
+    for (size_t i = 0; i < changed.size(); ++i) {
+        vertexEditor->GetTriangle(changed[i], vertices + changed[i] * 9);
+
+        // triangles close to each other are uploaded in one range
+        const size_t MaxGap = 8;
+        if (i > 0 && changed[i] - changed[i - 1] <= MaxGap)
+            dirtyTriangles.back().count = changed[i] - dirtyTriangles.back().first + 1;
+        else
+            dirtyTriangles.push_back({ editedEntity, changed[i], 1 });
+    }
+}
+
+void Scene::FinishVertexEditing()
+{
+    if (detailLevelsOutdated) {
+        RebuildDetailLevels(editedEntity);
+        detailLevelsOutdated = false;
+    }
+}
+
+void Scene::RebuildDetailLevels(size_t index)
+{
+    entities[index]->BuildDetailLevels(entities[index]->detailLevels);
+    FitDetailLevels(index);
+    MarkDirty(index, 1);
+}
+
+void Scene::FitDetailLevels(size_t index)
+{
+    // the vertices allocated for the entity do not grow, the finest levels are dropped first
+    std::vector<DetailLevel>& levels = entities[index]->detailLevels;
+    while (!levels.empty() && GetPackedVerticesCount(index) > packedVertices[index].count)
+        levels.erase(levels.begin());
+}
+
+void Scene::TakeVertexEditCounters(size_t counts[PolygonEditor::EditKindsCount], double& slowestMilliseconds)
+{
+    std::copy(vertexEditCounters, vertexEditCounters + PolygonEditor::EditKindsCount, counts);
+    std::fill(vertexEditCounters, vertexEditCounters + PolygonEditor::EditKindsCount, 0);
+    slowestMilliseconds = slowestVertexEdit;
+    slowestVertexEdit = 0.0;
+}
+
+void Scene::SetSnapping(bool enabled)
+{
+    ApplyMouseMoves();
+    snapping = enabled;
+    snap_offset = glm::vec2(0.0);
+}
+
+bool Scene::IsSnapping() const
+{
+    return snapping;
+}
+
+void Scene::TakeSnapCounters(size_t& searches, size_t& snapped, double& slowestMilliseconds)
+{
+    searches = snapSearches;
+    snapped = snapsFound;
+    slowestMilliseconds = slowestSnap;
+    snapSearches = snapsFound = 0;
+    slowestSnap = 0.0;
+}
+
+void Scene::GetWorldVertices(size_t index, std::vector<VertexGrid::Vertex>& vertices) const
+{
+    const Entity& entity = *entities[index];
+    std::vector<glm::vec3> points;
+    entity.GetVertices(points);
+    glm::mat4 transform = entity.GetTransform();
+    for (size_t i = 0; i < points.size(); ++i) {
+        VertexGrid::Vertex vertex = { glm::vec2(transform * glm::vec4(points[i], 1.0)), uint32_t(index), uint32_t(i) };
+        vertices.push_back(vertex);
+    }
+}
+
+void Scene::UpdateVertexGrid()
+{
+    std::vector<VertexGrid::Vertex> vertices;
+    if (vertexGridOutdated || vertexGrid.IsOverlayLarge()) {
+        for (size_t i = 0; i < entities.size(); ++i)
+            GetWorldVertices(i, vertices);
+        vertexGrid.Build(vertices, entities.size());
+        vertexGridOutdated = false;
+        vertexGridDirty.clear();
+        return;
+    }
+
+    for (size_t index : vertexGridDirty) {
+        vertices.clear();
+        GetWorldVertices(index, vertices);
+        vertexGrid.Update(index, vertices);
+    }
+    vertexGridDirty.clear();
+}
+
+bool Scene::FindSnapOffset(const std::vector<VertexGrid::Vertex>& moved, glm::vec2& offset)
+{
+    auto startTime = std::chrono::steady_clock::now();
+    UpdateVertexGrid();
+
+    // the search radius shrinks to the nearest pair found so far
+    float distance = snap_distance;
+    bool found = false;
+    for (const VertexGrid::Vertex& vertex : moved) {
+        VertexGrid::Vertex nearest;
+        if (vertexGrid.FindNearest(vertex.position, distance, selected, nearest)) {
+            offset = nearest.position - vertex.position;
+            distance = glm::length(offset);
+            found = true;
+        }
+    }
+
+    ++snapSearches;
+    snapsFound += found ? 1 : 0;
+    std::chrono::duration<double, std::milli> snapTime = std::chrono::steady_clock::now() - startTime;
+    slowestSnap = std::max(slowestSnap, snapTime.count());
+    return found;
+}
+
+void Scene::SetCollisions(bool enabled)
+{
+    ApplyMouseMoves();
+    collisions = enabled;
+    collision_ignored.clear();
+    if (collisions && selected >= 0)
+        FindOverlapping(collision_ignored);
+}
+
+bool Scene::IsColliding() const
+{
+    return collisions;
+}
+
+void Scene::TakeCollisionCounters(size_t& moves, size_t& blocked, double& slowestMilliseconds)
+{
+    moves = collisionMoves;
+    blocked = blockedMoves;
+    slowestMilliseconds = slowestCollision;
+    collisionMoves = blockedMoves = 0;
+    slowestCollision = 0.0;
+}
+
+ConvexShape& Scene::GetCollisionShape(size_t index)
+{
+    const Entity& entity = *entities[index];
+    auto inserted = collisionShapes.emplace(index, ConvexShape());
+    ConvexShape& shape = inserted.first->second;
+    if (inserted.second) {
+        if (entity.IsClosed()) {
+            std::vector<glm::vec3> vertices;
+            entity.GetVertices(vertices);
+            shape.BuildFromHull(vertices);
+        }
+        else if (!streamBudget) {
+            shape.BuildFromTriangles(buffer.data() + firstVertices[index] * 3, entity.GetTrianglesCount());
+        }
+        else {
+            // streamed mode keeps no float geometry
+            std::vector<GLfloat> triangulated(entity.GetTrianglesCount() * 3 * 3);
+            TriangulationVisitor traingulation(triangulated, 0);
+            entity.Accept(&traingulation);
+            shape.BuildFromTriangles(triangulated.data(), entity.GetTrianglesCount());
+        }
+    }
+    shape.SetTransform(entity.GetTransform());
+    return shape;
+}
+
+void Scene::TranslateSelected(const glm::vec2& translation)
+{
+    Entity& entity = *entities[selected];
+    if (!collisions) {
+        entity.translation = glm::translate(entity.translation, glm::vec3(translation, 0.0));
+        return;
+    }
+
+    auto startTime = std::chrono::steady_clock::now();
+    // steps of at most half of the smaller side
+    glm::vec3 minPoint, maxPoint;
+    entity.GetWorldBounds(minPoint, maxPoint);
+    float step = 0.5f * std::min(maxPoint.x - minPoint.x, maxPoint.y - minPoint.y);
+    int steps = (step > 0.0f) ? int(std::ceil(glm::length(translation) / step)) : 1;
+    steps = glm::clamp(steps, 1, int(MaxCollisionSteps));
+
+    for (int i = 0; i < steps; ++i) {
+        glm::mat4 previousTranslation = entity.translation;
+        entity.translation = glm::translate(entity.translation, glm::vec3(translation / float(steps), 0.0));
+        if (!ResolveCollisions(MaxCollisionPushes)) {
+            entity.translation = previousTranslation;
+            ++blockedMoves;
+            break;
+        }
+    }
+
+    ++collisionMoves;
+    std::chrono::duration<double, std::milli> collisionTime = std::chrono::steady_clock::now() - startTime;
+    slowestCollision = std::max(slowestCollision, collisionTime.count());
+}
+
+bool Scene::ResolveCollisions(int maxPushes)
+{
+    // an outdated tree answers queries as well, only slower, it is rebuilt before the next frame
+    Entity& entity = *entities[selected];
+    std::vector<size_t> candidates;
+    for (int push = 0; ; ++push) {
+        ConvexShape& shape = GetCollisionShape(selected);
+        candidates.clear();
+        boundsTree.Query(shape.GetMin(), shape.GetMax(), candidates);
+
+        // the deepest overlap is pushed out first, the rest are checked again from the new position
+        glm::vec2 deepest(0.0);
+        for (size_t index : candidates) {
+            if (index == size_t(selected) || std::binary_search(collision_ignored.begin(), collision_ignored.end(), index))
+                continue;
+            glm::vec2 separation;
+            if (shape.Overlaps(GetCollisionShape(index), separation) && glm::length(separation) > glm::length(deepest))
+                deepest = separation;
+        }
+        if (deepest == glm::vec2(0.0))
+            return true;
+        if (push == maxPushes)
+            return false;
+        // a little further than touching, so rounding does not leave it overlapping
+        entity.translation = glm::translate(entity.translation, glm::vec3(deepest * 1.001f, 0.0));
+    }
+}
+
+void Scene::FindOverlapping(std::vector<size_t>& overlapping)
+{
+    if (boundsTreeOutdated)
+        RebuildBoundsTree();
+
+    ConvexShape& shape = GetCollisionShape(selected);
+    std::vector<size_t> candidates;
+    boundsTree.Query(shape.GetMin(), shape.GetMax(), candidates);
+    for (size_t index : candidates) {
+        glm::vec2 separation;
+        if (index != size_t(selected) && shape.Overlaps(GetCollisionShape(index), separation))
+            overlapping.push_back(index);
+    }
+    std::sort(overlapping.begin(), overlapping.end());
+}
+
+glm::vec2 Scene::GetWorldPoint(double xpos, double ypos, int width, int height) const
+{
+    return glm::vec2(viewportMin.x + float(xpos / width) * (viewportMax.x - viewportMin.x),
+        viewportMax.y - float(ypos / height) * (viewportMax.y - viewportMin.y));
+}
+
+void Scene::BeginBandSelection(double xpos, double ypos, int width, int height, bool lasso)
+{
+    SetSelected(0);
+    band_open = true;
+    band_lasso = lasso;
+    band_points.assign(2, GetWorldPoint(xpos, ypos, width, height));
+    if (lasso)
+        band_points.pop_back();
+}
+
+size_t Scene::EndBandSelection()
+{
+    if (!band_open)
+        return 0;
+    band_open = false;
+    ClearGroup();
+    NotifyChanged();
+
+    if (boundsTreeOutdated)
+        RebuildBoundsTree();
+    std::vector<size_t> candidates;
+    if (!band_lasso) {
+        glm::vec2 minPoint = glm::min(band_points[0], band_points[1]);
+        glm::vec2 maxPoint = glm::max(band_points[0], band_points[1]);
+        boundsTree.Query(minPoint, maxPoint, candidates);
+        for (size_t index : candidates) {
+            glm::vec2 entityMin, entityMax;
+            boundsTree.GetBounds(index, entityMin, entityMax);
+            if (glm::all(glm::lessThanEqual(minPoint, entityMin)) && glm::all(glm::lessThanEqual(entityMax, maxPoint)))
+                group.push_back(index);
+        }
+    }
+    else {
+        Lasso lasso(band_points);
+        boundsTree.Query(lasso.GetMin(), lasso.GetMax(), candidates);
+        for (size_t index : candidates) {
+            glm::vec2 entityMin, entityMax;
+            boundsTree.GetBounds(index, entityMin, entityMax);
+            if (lasso.Contains((entityMin + entityMax) * 0.5f))
+                group.push_back(index);
+        }
+    }
+    std::sort(group.begin(), group.end());
+
+    if (grouped.size() < entities.size())
+        grouped.resize(entities.size(), false);
+    groupBounds.resize(group.size() * 2);
+    glm::vec2 groupMin(0.0), groupMax(0.0);
+    for (size_t i = 0; i < group.size(); ++i) {
+        grouped[group[i]] = true;
+        boundsTree.GetBounds(group[i], groupBounds[2 * i], groupBounds[2 * i + 1]);
+        groupMin = (i == 0) ? groupBounds[2 * i] : glm::min(groupMin, groupBounds[2 * i]);
+        groupMax = (i == 0) ? groupBounds[2 * i + 1] : glm::max(groupMax, groupBounds[2 * i + 1]);
+    }
+    group_center = (groupMin + groupMax) * 0.5f;
+    return group.size();
+}
+
+bool Scene::IsBandOpen() const
+{
+    return band_open;
+}
+
+void Scene::ClearGroup()
+{
+    if (group.empty())
+        return;
+    for (size_t index : group)
+        grouped[index] = false;
+    group.clear();
+    group_drag = false;
+    NotifyChanged();
+}
+
+size_t Scene::GetGroupSize() const
+{
+    return group.size();
+}
+
+const std::vector<size_t>& Scene::GetGroup() const
+{
+    return group;
+}
+
+void Scene::TakeGroupMoveCounters(size_t& moves, double& slowestMilliseconds)
+{
+    moves = groupMoves;
+    slowestMilliseconds = slowestGroupMove;
+    groupMoves = 0;
+    slowestGroupMove = 0.0;
+}
+
+void Scene::MoveGroup(const glm::vec2& translation, float angle)
+{
+    auto startTime = std::chrono::steady_clock::now();
+    glm::mat4 rotation_z = glm::rotate(glm::mat4(1.0f), angle, glm::vec3(0.0, 0.0, 1.0));
+
+    // entities of the group are independent, so their transforms and bounds are computed on all cores;
+    // the translations are pure, turning around the center moves the origin and turns the entity,
+    // bounds are only shifted if nothing turns. Attached entities are moved by their roots below.
+    auto process = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            if (GetEntityNode(group[i]) != TransformHierarchy::NoNode)
+                continue;
+            Entity& entity = *entities[group[i]];
+            glm::vec2 origin(entity.translation[3]);
+            if (angle != 0.0f) {
+                origin = group_center + glm::vec2(rotation_z * glm::vec4(origin - group_center, 0.0, 0.0));
+                entity.rotation = rotation_z * entity.rotation;
+            }
+            origin += translation;
+            entity.translation[3] = glm::vec4(origin, entity.translation[3].z, 1.0);
+
+            if (angle == 0.0f) {
+                groupBounds[2 * i] += translation;
+                groupBounds[2 * i + 1] += translation;
+                continue;
+            }
+            glm::vec3 minPoint, maxPoint;
+            entity.GetWorldBounds(minPoint, maxPoint);
+            groupBounds[2 * i] = glm::vec2(minPoint);
+            groupBounds[2 * i + 1] = glm::vec2(maxPoint);
+        }
+    };
+
+    ParallelFor(group.size(), triangulationThreads, 4096, process);
+
+    // every root once, however many of its entities are in the group
+    glm::mat4 motion = glm::translate(glm::mat4(1.0f), glm::vec3(group_center + translation, 0.0)) * rotation_z *
+        glm::translate(glm::mat4(1.0f), glm::vec3(-group_center, 0.0));
+    std::vector<size_t> roots;
+    for (size_t i = 0; i < group.size(); ++i) {
+        size_t node = GetEntityNode(group[i]);
+        if (node == TransformHierarchy::NoNode)
+            SetBounds(group[i], groupBounds[2 * i], groupBounds[2 * i + 1]);
+        else
+            roots.push_back(hierarchy.GetRoot(node));
+    }
+    std::sort(roots.begin(), roots.end());
+    roots.erase(std::unique(roots.begin(), roots.end()), roots.end());
+    for (size_t root : roots)
+        hierarchy.SetLocalTransform(root, motion * hierarchy.GetLocalTransform(root));
+    group_center += translation;
+
+    ++groupMoves;
+    std::chrono::duration<double, std::milli> moveTime = std::chrono::steady_clock::now() - startTime;
+    slowestGroupMove = std::max(slowestGroupMove, moveTime.count());
+}
+
+size_t Scene::AddNode(size_t parent, const glm::mat4& local)
+{
+    size_t node = hierarchy.AddNode(parent, local);
+    nodeEntities.resize(hierarchy.GetNodesCount());
+    return node;
+}
+
+void Scene::SetNodeTransform(size_t node, const glm::mat4& local)
+{
+    hierarchy.SetLocalTransform(node, local);
+    NotifyChanged();
+}
+
+void Scene::AttachEntity(size_t index, size_t node)
+{
+    size_t previous = GetEntityNode(index);
+    if (previous == node)
+        return;
+    if (previous != TransformHierarchy::NoNode) {
+        std::vector<size_t>& attached = nodeEntities[previous];
+        attached.erase(std::find(attached.begin(), attached.end(), index));
+    }
+    if (entityNodes.size() <= index)
+        entityNodes.resize(index + 1, TransformHierarchy::NoNode);
+    entityNodes[index] = node;
+
+    // the placement relative to the node keeps the world transform, the node transform has to be final for it
+    UpdateHierarchy();
+    Entity& entity = *entities[index];
+    glm::mat4 groupTransform(1.0f);
+    if (node != TransformHierarchy::NoNode) {
+        nodeEntities[node].push_back(index);
+        groupTransform = hierarchy.GetWorldTransform(node);
+    }
+    glm::mat4 local = glm::inverse(groupTransform) * entity.GetTransform();
+    entity.translation = glm::translate(glm::mat4(1.0f), glm::vec3(local[3]));
+    local[3] = glm::vec4(0.0, 0.0, 0.0, 1.0);
+    entity.rotation = local;
+    entity.groupTransform = groupTransform;
+}
+
+size_t Scene::GroupSelection()
+{
+    ApplyMouseMoves();
+    std::vector<size_t> selection(group);
+    glm::vec2 center = group_center;
+    if (selection.empty() && selected >= 0) {
+        selection.push_back(selected);
+        glm::vec3 minPoint, maxPoint;
+        entities[selected]->GetWorldBounds(minPoint, maxPoint);
+        center = glm::vec2(minPoint + maxPoint) * 0.5f;
+    }
+    if (selection.empty())
+        return TransformHierarchy::NoNode;
+
+    size_t node = AddNode(TransformHierarchy::NoNode, glm::translate(glm::mat4(1.0f), glm::vec3(center, 0.0)));
+    UpdateHierarchy();
+    glm::mat4 toNode = glm::inverse(hierarchy.GetWorldTransform(node));
+    for (size_t index : selection) {
+        size_t entityNode = GetEntityNode(index);
+        if (entityNode == TransformHierarchy::NoNode) {
+            AttachEntity(index, node);
+            continue;
+        }
+        // the root is in world coordinates, under the new node it keeps its place
+        size_t root = hierarchy.GetRoot(entityNode);
+        if (root == node)
+            continue;
+        hierarchy.SetParent(root, node);
+        hierarchy.SetLocalTransform(root, toNode * hierarchy.GetLocalTransform(root));
+    }
+    UpdateHierarchy();
+    NotifyChanged();
+    return node;
+}
+
+void Scene::TakeHierarchyCounters(size_t& nodes, size_t& movedEntities, double& slowestMilliseconds)
+{
+    nodes = hierarchyNodesUpdated;
+    movedEntities = hierarchyEntitiesMoved;
+    slowestMilliseconds = slowestHierarchyUpdate;
+    hierarchyNodesUpdated = hierarchyEntitiesMoved = 0;
+    slowestHierarchyUpdate = 0.0;
+}
+
+size_t Scene::GetEntityNode(size_t index) const
+{
+    return index < entityNodes.size() ? entityNodes[index] : TransformHierarchy::NoNode;
+}
+
+void Scene::MoveSelectedRoot(const glm::vec2& translation, float angle)
+{
+    size_t root = hierarchy.GetRoot(GetEntityNode(selected));
+    glm::mat4 local = hierarchy.GetLocalTransform(root);
+    if (angle != 0.0f) {
+        glm::vec3 pivot(local[3]);
+        local = glm::translate(glm::mat4(1.0f), pivot) * glm::rotate(glm::mat4(1.0f), angle, glm::vec3(0.0, 0.0, 1.0)) *
+            glm::translate(glm::mat4(1.0f), -pivot) * local;
+    }
+    local = glm::translate(glm::mat4(1.0f), glm::vec3(translation, 0.0)) * local;
+    hierarchy.SetLocalTransform(root, local);
+}
+
+void Scene::UpdateHierarchy()
+{
+    if (!hierarchy.IsOutdated())
+        return;
+    auto startTime = std::chrono::steady_clock::now();
+    changedNodes.clear();
+    hierarchy.Update(changedNodes, triangulationThreads);
+
+    hierarchyEntities.clear();
+    for (size_t node : changedNodes)
+        hierarchyEntities.insert(hierarchyEntities.end(), nodeEntities[node].begin(), nodeEntities[node].end());
+    hierarchyBounds.resize(hierarchyEntities.size() * 2);
+    auto process = [this](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            Entity& entity = *entities[hierarchyEntities[i]];
+            entity.groupTransform = hierarchy.GetWorldTransform(entityNodes[hierarchyEntities[i]]);
+            glm::vec3 minPoint, maxPoint;
+            entity.GetWorldBounds(minPoint, maxPoint);
+            hierarchyBounds[2 * i] = glm::vec2(minPoint);
+            hierarchyBounds[2 * i + 1] = glm::vec2(maxPoint);
+        }
+    };
+    ParallelFor(hierarchyEntities.size(), triangulationThreads, 4096, process);
+    // the bounds tree and the vertex grid are not shared between threads
+    for (size_t i = 0; i < hierarchyEntities.size(); ++i)
+        SetBounds(hierarchyEntities[i], hierarchyBounds[2 * i], hierarchyBounds[2 * i + 1]);
+
+    hierarchyNodesUpdated += changedNodes.size();
+    hierarchyEntitiesMoved += hierarchyEntities.size();
+    std::chrono::duration<double, std::milli> updateTime = std::chrono::steady_clock::now() - startTime;
+    slowestHierarchyUpdate = std::max(slowestHierarchyUpdate, updateTime.count());
+    NotifyChanged();
+}
+
+size_t Scene::CombineGroup(PolygonBoolean::Operation operation)
+{
+    int clipEntity = selected;
+    SetSelected(0);
+    UpdateHierarchy();
+
+    // polygons of the group in world coordinates
+    std::vector<size_t> operands;
+    std::vector<PolygonBoolean::Ring> rings;
+    for (size_t index : group) {
+        const Polygon2D* polygon = dynamic_cast<const Polygon2D*>(entities[index].get());
+        if (!polygon || polygon->points.size() < 3)
+            continue;
+        glm::mat4 transform = polygon->GetTransform();
+        PolygonBoolean::Ring ring(polygon->points.size());
+        for (size_t i = 0; i < ring.size(); ++i)
+            ring[i] = glm::vec2(transform * glm::vec4(polygon->points[i], 0.0, 1.0));
+        operands.push_back(index);
+        rings.push_back(ring);
+    }
+    if (operands.size() < 2)
+        return 0;
+
+    std::vector<PolygonBoolean::Ring> result;
+    if (operation == PolygonBoolean::OperationUnion) {
+        PolygonBoolean combination;
+        combination.Compute(operation, rings, std::vector<PolygonBoolean::Ring>(), result);
+    }
+    else {
+        size_t clip = std::find(operands.begin(), operands.end(), size_t(clipEntity)) - operands.begin();
+        if (clip == operands.size())
+            clip = 0;
+        std::vector<PolygonBoolean::Ring> clipRings(1, rings[clip]);
+        rings.erase(rings.begin() + clip);
+
+        // pairs are independent, every chunk has its own instance and results
+        std::vector<std::vector<PolygonBoolean::Ring>> pairResults(rings.size());
+        auto process = [&](size_t begin, size_t end) {
+            PolygonBoolean combination;
+            std::vector<PolygonBoolean::Ring> subject(1);
+            for (size_t i = begin; i < end; ++i) {
+                subject[0].swap(rings[i]);
+                combination.Compute(operation, subject, clipRings, pairResults[i]);
+            }
+        };
+        ParallelFor(rings.size(), triangulationThreads, 1, process);
+
+        for (const std::vector<PolygonBoolean::Ring>& pairResult : pairResults)
+            result.insert(result.end(), pairResult.begin(), pairResult.end());
+    }
+
+    RemoveEntities(operands);
+    std::vector<std::shared_ptr<Entity>> polygons;
+    for (const PolygonBoolean::Ring& ring : result)
+        polygons.push_back(std::make_shared<Polygon2D>(ring));
+    AddEntities(polygons);
+    CommitPendingEntities();
+    return polygons.size();
+}
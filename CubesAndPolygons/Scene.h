@@ -1,45 +1,403 @@
 #pragma once
 
+#include "ConvexShape.h"
 #include "Cube.h"
+#include "FrameSnapshot.h"
+#include "Lasso.h"
+#include "LooseQuadTree.h"
 #include "Polygon2D.h"
+#include "PolygonBoolean.h"
+#include "PolygonEditor.h"
+#include "TransformHierarchy.h"
+#include "TriangulationWorker.h"
+#include "VertexGrid.h"
 
 #include <GL/glew.h>
 
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 #include <memory>
 
+// Range of consecutive entities
+struct EntityRange
+{
+    size_t first;
+    size_t count;
+};
+
+// Read-only list of the scene entities at one epoch, safe to iterate from any thread while
+// the scene is being changed. Chunks are shared between epochs, only the changed ones are copied.
+// The world transforms are copied into the view when it is published, at the latest before the next
+// frame is built; readers take them from the view, the transforms and edited polygon points of the
+// entities themselves belong to the owner thread.
+struct SceneView
+{
+    static const size_t ChunkSize = 4096;
+
+    struct Chunk
+    {
+        std::vector<std::shared_ptr<Entity>> entities;
+        std::vector<GLint> firstVertices;
+    };
+    typedef std::vector<glm::mat4> TransformChunk;
+
+    uint64_t epoch = 0;
+    size_t entitiesCount = 0;
+    std::vector<std::shared_ptr<const Chunk>> chunks;
+    // copied separately, moves do not copy the entity lists
+    std::vector<std::shared_ptr<const TransformChunk>> transforms;
+
+    const std::shared_ptr<Entity>& GetEntity(size_t index) const { return chunks[index / ChunkSize]->entities[index % ChunkSize]; }
+    GLint GetFirstVertex(size_t index) const { return chunks[index / ChunkSize]->firstVertices[index % ChunkSize]; }
+    const glm::mat4& GetTransform(size_t index) const { return (*transforms[index / ChunkSize])[index % ChunkSize]; }
+};
+
+// Entities and their geometry can be added from any thread, they are queued and moved into
+// the scene by CommitPendingEntities() on the owner thread, which does everything else.
+// Scenes share no state, so independent scenes can be processed on different threads.
 class Scene
 {
 public:
     Scene() {};
 
-    static Scene& Instance()
-    {
-        static Scene scene_instance;
-        return scene_instance;
-    }
+    Scene(const Scene&) = delete;
+    Scene& operator=(const Scene&) = delete;
 
-    void AddEntity(std::shared_ptr<Entity> entity);
-    std::shared_ptr<Entity> GetEntity(size_t index);
+    // triangulated - optional ready geometry of the entity (GetTrianglesCount() * 3 vertices),
+    // the entity comes with its detail levels then; in lazy mode they are built with the geometry
+    void AddEntity(std::shared_ptr<Entity> entity, const GLfloat* triangulated = nullptr);
+    // bulk add path: triangulation spread over hardware threads of the calling thread, one queued batch,
+    // triangulated - optional ready geometry of all entities one after another, they come with their detail levels
+    void AddEntities(const std::vector<std::shared_ptr<Entity>>& newEntities, const GLfloat* triangulated = nullptr);
+    // Threads used by AddEntities to triangulate, 0 means one per hardware core
+    void SetTriangulationThreads(unsigned threadsCount);
+    // Moves the queued entities into the scene and publishes a new view, returns the number moved
+    size_t CommitPendingEntities();
+    // Removes the entities on the owner thread, the ones after them move down to keep the order, so their
+    // indices change; their geometry is moved down and uploaded again. The selection and the group are dropped,
+    // queued lazy triangulation is finished first. Entities still pending in batches are not affected.
+    void RemoveEntities(std::vector<size_t> indices);
+    // Latest published view, readers never wait for writers
+    std::shared_ptr<const SceneView> GetView() const;
 
-    std::vector<std::shared_ptr<Entity>>& GetEntities();
+    std::shared_ptr<Entity> GetEntity(size_t index);
+    const std::vector<std::shared_ptr<Entity>>& GetEntities() const;
+    GLint GetFirstVertex(size_t index) const;
     
     size_t GetBufferAllocationSize() const;
     const GLfloat* GetBufferAsArray() const;
 
+    // Keeps the spatial index in sync after the entity transform is changed outside of Scene
+    void UpdateBounds(size_t index);
+    // Indices of entities intersecting the viewport, in the order they were added
+    void GetVisibleEntities(std::vector<size_t>& visible);
+
+    // Lazy mode: added entities get a bounding rectangle placeholder and are triangulated, with their
+    // detail levels, on a background thread, entities intersecting the viewport first
+    void SetLazyTriangulation(bool enabled);
+    // pixelSize - world units per screen pixel, selects the detail level of entities; 0 draws full geometry
+    void SetViewport(const glm::vec2& minPoint, const glm::vec2& maxPoint, float pixelSize = 0.0f);
+    // Copies finished triangulations into the buffer, returns true if the buffer changed
+    bool UpdateTriangulation();
+    bool HasPendingTriangulation() const;
+    // Streamed mode for a bounded memory footprint: entities keep only deduplicated packed vertices
+    // and index lists, the triangles of visible entities are expanded into every frame snapshot and
+    // drawn from a ring buffer of budget bytes. 0 switches it off. Set it before entities are added,
+    // lazy triangulation is not available in this mode.
+    void SetStreamedGeometry(size_t budget);
+    bool IsGeometryStreamed() const;
+    // Packed GPU vertices of the entities added or retriangulated since the last call.
+    // The float buffer stays the source of the geometry, the GPU gets 16-bit coordinates
+    // within the entity bounds, planar entities without z.
+    void TakeVertexUpdates(std::vector<VertexUpdate>& updates);
+
+    // Copies what is needed to draw the visible entities, sorted by render state and front-to-back in depth mode
+    void BuildFrameSnapshot(FrameSnapshot& snapshot, bool depthMode);
+
+    // Changes are raised by adding entities, moving them, selection, viewport and finished triangulation.
+    // The callback may be called from the triangulation thread.
+    void SetChangedCallback(std::function<void()> callback);
+    // Returns true if the scene changed since the last call
+    bool TakeChanged();
+
     //Intreaction
+    // Cursor events are accumulated and applied to the selected entity by ApplyMouseMoves() once per frame
     void MouseMove(float xpos, float ypos, int width, int height);
+    void ApplyMouseMoves();
+    // Cursor events received and transform updates applied since the last call
+    void TakeMouseMoveCounters(size_t& received, size_t& applied);
     void SetSelected(int index, double xpos = 0.0, double ypos = 0.0);
     void SetRotationMode(bool switchedOn);
+    // Vertex editing: selects the polygon vertex nearest to the cursor within a few pixels, cursor moves
+    // then drag the vertex instead of the entity. Only the triangles around the vertex are triangulated
+    // again and uploaded, detail levels are rebuilt when the selection is released.
+    // false if there is no vertex, the geometry is streamed or the scene is still being triangulated.
+    bool SelectVertex(double xpos, double ypos, int width, int height);
+    // Vertex moves applied since the last call per PolygonEditor::EditKind, and the slowest one
+    void TakeVertexEditCounters(size_t counts[PolygonEditor::EditKindsCount], double& slowestMilliseconds);
+    // Snapping: a dragged entity jumps to the position where one of its vertices meets a vertex of
+    // another entity within a few pixels, a dragged polygon vertex to the nearest vertex of another entity.
+    // The vertex grid is built when snapping is first needed and then follows the moved entities.
+    void SetSnapping(bool enabled);
+    bool IsSnapping() const;
+    // Snap searches since the last call, how many of them snapped and the slowest one
+    void TakeSnapCounters(size_t& searches, size_t& snapped, double& slowestMilliseconds);
+    // Multi-selection: a rubber band dragged over the window selects the entities whose bounds it contains,
+    // a lasso the entities whose bounds centers it surrounds; both are resolved through the bounds tree.
+    // Picking one of the selected entities then drags all of them as a group, in rotation mode they turn
+    // around the center of the group. Picking another entity clears the group, snapping and collisions
+    // apply to single entities only.
+    void BeginBandSelection(double xpos, double ypos, int width, int height, bool lasso);
+    // Replaces the group with the entities inside of the band, returns their number
+    size_t EndBandSelection();
+    bool IsBandOpen() const;
+    void ClearGroup();
+    size_t GetGroupSize() const;
+    // Indices of the grouped entities, sorted
+    const std::vector<size_t>& GetGroup() const;
+    // Group moves applied since the last call and the slowest one
+    void TakeGroupMoveCounters(size_t& moves, double& slowestMilliseconds);
+    // Collision mode: a dragged entity is pushed out of the entities it runs into, so it slides along them,
+    // and stays where it was when that fails. Footprints in the xy plane are tested: cubes as the convex
+    // hull of their projected corners, polygons as convex pieces of their triangulation. Entities the
+    // selected one already overlaps when it is picked do not block it. Vertex editing is not checked.
+    void SetCollisions(bool enabled);
+    bool IsColliding() const;
+    // Dragged moves checked since the last call, how many of them were stopped and the slowest check
+    void TakeCollisionCounters(size_t& moves, size_t& blocked, double& slowestMilliseconds);
+    // Hierarchy: entities attached to a node follow its world transform, nodes follow their parents.
+    // Dragging an attached entity moves the root of its hierarchy, so assemblies move as one; snapping
+    // and collisions are not applied to such drags. World transforms are brought up to date once per
+    // applied move and frame, only for the changed nodes and their subtrees. Scene files keep the world
+    // placement of the entities without the hierarchy.
+    // parent - TransformHierarchy::NoNode for a root; local - the transform relative to the parent,
+    // translations and rotations only like the entity transforms
+    size_t AddNode(size_t parent, const glm::mat4& local = glm::mat4(1.0f));
+    void SetNodeTransform(size_t node, const glm::mat4& local);
+    // Attaches the entity to the node, NoNode detaches it; the entity stays where it is in the world
+    void AttachEntity(size_t index, size_t node);
+    // Puts the group, or the selected entity without one, under a new node at its center. Entities already
+    // in a hierarchy bring their whole hierarchy along, so groups nest. Returns the node, NoNode if nothing is selected.
+    size_t GroupSelection();
+    // Node and entity transforms recomputed since the last call and the slowest update
+    void TakeHierarchyCounters(size_t& nodes, size_t& movedEntities, double& slowestMilliseconds);
+    // Boolean operations on the polygons of the group, in world coordinates: the union merges all of them,
+    // intersection and difference clip each of the others by the selected one, or by the first one if the
+    // selected entity is not in the group; the pairs are computed on all cores. The operands are removed
+    // and the result polygons added after the other entities, holes are joined to the outlines around them.
+    // Returns the number of result polygons, 0 without two polygons in the group.
+    size_t CombineGroup(PolygonBoolean::Operation operation);
 
 private:
     std::vector<std::shared_ptr<Entity>> entities;
 
     std::vector<GLfloat> buffer;
+    std::vector<GLint> firstVertices;
+
+    // Entities added by writer threads and waiting for CommitPendingEntities
+    struct PendingBatch
+    {
+        std::vector<std::shared_ptr<Entity>> entities;
+        // geometry of all entities, empty if they are triangulated lazily
+        std::vector<GLfloat> vertices;
+    };
+    void AddBatch(PendingBatch& batch);
+    void PublishView();
+    // Waits for the triangulation worker and copies all of its results
+    void FinishTriangulation();
+
+    std::mutex pendingMutex;
+    std::vector<PendingBatch> pendingBatches;
+    std::shared_ptr<const SceneView> view = std::make_shared<const SceneView>();
+    // changes since the view was published: the first entity added, chunks with moved entities
+    bool viewOutdated = false;
+    size_t viewEntitiesFrom = 0;
+    std::vector<bool> viewMovedChunks;
+    // read by writer threads to decide whether to triangulate
+    std::atomic<bool> lazyTriangulation { false };
+    unsigned triangulationThreads = 0;
+
+    bool IsVisible(const Entity& entity) const;
+    // Updates the bounds tree and marks the entity changed for the vertex grid
+    void SetBounds(size_t index, const glm::vec2& minPoint, const glm::vec2& maxPoint);
+    glm::vec2 GetWorldPoint(double xpos, double ypos, int width, int height) const;
+    void RebuildBoundsTree();
+    void AddPlaceholder(size_t index);
+    void MarkDirty(size_t firstEntity, size_t count);
+    // reserveDetailLevels - the levels are built later, their vertices are allocated for the most they can take
+    void AssignPackedVertices(size_t index, bool reserveDetailLevels);
+    void PackVertices(size_t index, const GLfloat* vertices, size_t verticesCount, GLushort* packed) const;
+    // Entity vertices are the full geometry followed by its detail levels, level 0 is the full geometry
+    void PackDetailLevels(size_t index, const GLfloat* vertices, GLushort* packed) const;
+    size_t GetPackedVerticesCount(size_t index) const;
+    void GetDetailLevelRange(size_t index, size_t level, size_t& first, size_t& count) const;
+    size_t SelectDetailLevel(size_t index) const;
+    void AddCompactGeometry(size_t index, const GLfloat* vertices);
+    // Appends the triangles of the entity level to the frame data, false if they exceed the frame budget
+    bool ExpandCompactGeometry(size_t index, size_t level, std::vector<GLushort>& streamed, GLint& firstVertex) const;
+    void NotifyChanged();
+    void MoveSelectedVertex(const glm::vec2& translation);
+    // Copies the triangles changed by the vertex editor into the buffer and queues their upload
+    void WriteEditedTriangles();
+    void FinishVertexEditing();
+    // Detail levels after the outline changed, as many as fit the vertices allocated for the entity
+    void RebuildDetailLevels(size_t index);
+    void FitDetailLevels(size_t index);
+    // Appends the entity vertices projected to the xy plane of the world
+    void GetWorldVertices(size_t index, std::vector<VertexGrid::Vertex>& vertices) const;
+    // Builds the vertex grid or brings the entities changed since then up to date
+    void UpdateVertexGrid();
+    // Moves and turns the group around its center, transforms and bounds are computed on all cores
+    void MoveGroup(const glm::vec2& translation, float angle);
+    // Offset from the moved vertex nearest to a vertex of another entity than the selected one to that vertex,
+    // false if no vertices are within the snap distance
+    bool FindSnapOffset(const std::vector<VertexGrid::Vertex>& moved, glm::vec2& offset);
+    // Footprint of the entity with its current transform, built on the first use
+    ConvexShape& GetCollisionShape(size_t index);
+    // Moves the selected entity, in steps with collisions so it does not jump over thin entities
+    void TranslateSelected(const glm::vec2& translation);
+    // Pushes the selected entity out of the entities it overlaps at most maxPushes times,
+    // false if it still overlaps one then
+    bool ResolveCollisions(int maxPushes);
+    // Entities overlapping the selected one, sorted
+    void FindOverlapping(std::vector<size_t>& overlapping);
+    size_t GetEntityNode(size_t index) const;
+    // Moves and turns the root of the hierarchy of the selected entity, turning around the root origin
+    void MoveSelectedRoot(const glm::vec2& translation, float angle);
+    // Computes the changed world transforms, then the transforms and bounds of their entities on all cores
+    void UpdateHierarchy();
+
+    // reused by BuildFrameSnapshot
+    std::vector<size_t> visibleEntities;
+
+    std::unique_ptr<TriangulationWorker> triangulationWorker;
+    std::vector<EntityRange> dirtyEntities;
+    // Triangles of one entity changed by vertex editing, uploaded without the rest of the entity
+    struct TriangleRange
+    {
+        size_t entity;
+        size_t first;
+        size_t count;
+    };
+    std::vector<TriangleRange> dirtyTriangles;
+
+    // Where the packed vertices of an entity are and how they are decoded
+    struct PackedVertices
+    {
+        VertexFormat format;
+        GLint first;
+        // allocated when the entity was added, detail levels may use less of it later
+        size_t count;
+        glm::vec3 offset;
+        glm::vec3 scale;
+    };
+    std::vector<PackedVertices> packedVertices;
+    size_t packedVerticesCount[VertexFormatsCount] = {};
+    size_t trianglesCount = 0;
+
+    // Streamed mode geometry, indices are relative to the first vertex of the entity
+    struct CompactGeometry
+    {
+        size_t firstVertex;
+        size_t firstIndex;
+    };
+    size_t streamBudget = 0;
+    std::vector<CompactGeometry> compactGeometry;
+    std::vector<GLushort> compactVertices[VertexFormatsCount];
+    std::vector<GLuint> compactIndices;
+    glm::vec2 viewportMin = glm::vec2(-1.0);
+    glm::vec2 viewportMax = glm::vec2(1.0);
+    float viewportPixelSize = 0.0f;
+
+    LooseQuadTree boundsTree = LooseQuadTree(glm::vec2(-2.0), glm::vec2(2.0));
+    // set when an entity leaves the tree region, the tree is rebuilt before the next query
+    bool boundsTreeOutdated = false;
+
+    std::atomic<bool> changed { true };
+    std::function<void()> changedCallback;
 
     int selected = -1;
     double xpos_selected = 0.0;
     double ypos_selected = 0.0;
     bool rotation_mode = false;
+
+    // accumulated since the last ApplyMouseMoves
+    bool moves_pending = false;
+    glm::vec2 pending_translation = glm::vec2(0.0);
+    glm::vec2 pending_rotation = glm::vec2(0.0);
+    size_t received_moves = 0;
+    size_t applied_moves = 0;
+
+    // distance from the cursor to the vertices SelectVertex picks
+    static const int VertexPickPixels = 8;
+    // vertex of the selected polygon dragged in vertex editing, -1 if the entity is dragged
+    int selected_vertex = -1;
+    // where the cursor drags the vertex, in polygon coordinates; the vertex stays behind while that is invalid
+    glm::vec2 vertex_target = glm::vec2(0.0);
+    // kept after the selection is released, so the next pick of the same polygon does not build it again
+    std::unique_ptr<PolygonEditor> vertexEditor;
+    size_t editedEntity = 0;
+    bool detailLevelsOutdated = false;
+    size_t vertexEditCounters[PolygonEditor::EditKindsCount] = {};
+    double slowestVertexEdit = 0.0;
+
+    // distance in pixels from which vertices snap
+    static const int SnapPixels = 8;
+    bool snapping = false;
+    // snap distance in world units at the last cursor event
+    float snap_distance = 0.0f;
+    // offset added to the dragged entity by the last snap, taken back before the next move
+    glm::vec2 snap_offset = glm::vec2(0.0);
+    VertexGrid vertexGrid;
+    bool vertexGridOutdated = true;
+    // entities moved or edited since the grid was updated
+    std::vector<size_t> vertexGridDirty;
+    size_t snapSearches = 0;
+    size_t snapsFound = 0;
+    double slowestSnap = 0.0;
+
+    // rubber band in world coordinates, the corners of the rectangle or the lasso points
+    bool band_open = false;
+    bool band_lasso = false;
+    std::vector<glm::vec2> band_points;
+    // selected together, sorted; grouped marks them by entity index
+    std::vector<size_t> group;
+    std::vector<bool> grouped;
+    // set when one of the group is picked, cursor moves then drag the whole group
+    bool group_drag = false;
+    glm::vec2 group_center = glm::vec2(0.0);
+    // world bounds of the group entities, 2 per entity, kept up to date by MoveGroup for the entities
+    // without a node, attached ones get theirs from UpdateHierarchy
+    std::vector<glm::vec2> groupBounds;
+    size_t groupMoves = 0;
+    double slowestGroupMove = 0.0;
+
+    static const int MaxCollisionPushes = 4;
+    static const int MaxCollisionSteps = 16;
+    bool collisions = false;
+    // dropped when the geometry of the entity changes, transforms are followed by the shapes
+    std::unordered_map<size_t, ConvexShape> collisionShapes;
+    // entities the selected one overlapped when it was picked, sorted
+    std::vector<size_t> collision_ignored;
+    size_t collisionMoves = 0;
+    size_t blockedMoves = 0;
+    double slowestCollision = 0.0;
+
+    TransformHierarchy hierarchy;
+    // node of every entity, NoNode if it is not attached; missing entries are not attached either
+    std::vector<size_t> entityNodes;
+    // attached entities of every node
+    std::vector<std::vector<size_t>> nodeEntities;
+    // reused by UpdateHierarchy
+    std::vector<size_t> changedNodes;
+    std::vector<size_t> hierarchyEntities;
+    std::vector<glm::vec2> hierarchyBounds;
+    size_t hierarchyNodesUpdated = 0;
+    size_t hierarchyEntitiesMoved = 0;
+    double slowestHierarchyUpdate = 0.0;
 };
 
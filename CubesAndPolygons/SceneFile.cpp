@@ -0,0 +1,315 @@
+#include "SceneFile.h"
+#include "TriangulationVisitor.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static uint64_t AlignSection(uint64_t offset)
+{
+    return (offset + 15) & ~uint64_t(15);
+}
+
+class RecordVisitor : public Visitor
+{
+public:
+    RecordVisitor(SceneFile::EntityRecord& iRecord, std::vector<glm::vec2>& iPoints) : record(iRecord), points(iPoints) {}
+
+    void VisitCube(const Cube* cube) override
+    {
+        record.type = SceneFile::EntityCube;
+        record.edgeLength = cube->edgeLength;
+        memcpy(record.mainAxis, glm::value_ptr(cube->mainAxis), sizeof(record.mainAxis));
+        memcpy(record.auxilaryAxis, glm::value_ptr(cube->auxilaryAxis), sizeof(record.auxilaryAxis));
+    }
+
+    void VisitPolygon2D(const Polygon2D* polygon) override
+    {
+        record.type = SceneFile::EntityPolygon2D;
+        record.firstPoint = points.size();
+        record.pointsCount = polygon->points.size();
+        points.insert(points.end(), polygon->points.begin(), polygon->points.end());
+    }
+
+private:
+    SceneFile::EntityRecord& record;
+    std::vector<glm::vec2>& points;
+};
+
+bool SceneFile::Save(const Scene& scene, const std::string& path, bool withGeometry)
+{
+    const std::vector<std::shared_ptr<Entity>>& entities = scene.GetEntities();
+    if (withGeometry && scene.HasPendingTriangulation()) {
+        std::cout << "Triangulation is not finished, saving the scene without geometry" << std::endl;
+        withGeometry = false;
+    }
+    if (withGeometry && scene.IsGeometryStreamed()) {
+        std::cout << "Streamed scenes keep no triangles, saving the scene without geometry" << std::endl;
+        withGeometry = false;
+    }
+
+    std::vector<EntityRecord> records(entities.size());
+    std::vector<LevelRecord> levels;
+    std::vector<glm::vec2> points;
+    // vertices of the detail levels, saved after the scene buffer
+    std::vector<GLfloat> levelVertices;
+    size_t bufferFloats = withGeometry ? scene.GetBufferAllocationSize() / sizeof(GLfloat) : 0;
+    for (size_t i = 0; i < entities.size(); ++i) {
+        EntityRecord& record = records[i];
+        memset(&record, 0, sizeof(record));
+        record.trianglesCount = entities[i]->GetTrianglesCount();
+        // the hierarchy is not saved, entities keep their world placement
+        const glm::mat4& group = entities[i]->groupTransform;
+        glm::mat4 translation = glm::translate(glm::mat4(1.0f), glm::vec3(group * entities[i]->translation[3]));
+        glm::mat4 rotation = glm::mat4(glm::mat3(group)) * entities[i]->rotation;
+        memcpy(record.translation, glm::value_ptr(translation), sizeof(record.translation));
+        memcpy(record.rotation, glm::value_ptr(rotation), sizeof(record.rotation));
+        record.firstVertex = withGeometry ? scene.GetFirstVertex(i) * 3 : 0;
+        if (withGeometry) {
+            record.firstLevel = levels.size();
+            record.levelsCount = entities[i]->detailLevels.size();
+            for (const DetailLevel& level : entities[i]->detailLevels) {
+                LevelRecord levelRecord;
+                memset(&levelRecord, 0, sizeof(levelRecord));
+                levelRecord.tolerance = level.tolerance;
+                levelRecord.impostor = level.impostor;
+                levelRecord.verticesCount = level.verticesCount;
+                levelRecord.firstVertex = bufferFloats + levelVertices.size();
+                levels.push_back(levelRecord);
+                levelVertices.insert(levelVertices.end(), level.vertices.begin(), level.vertices.end());
+            }
+        }
+
+        RecordVisitor visitor(record, points);
+        entities[i]->Accept(&visitor);
+    }
+
+    Header header;
+    memset(&header, 0, sizeof(header));
+    header.magic = Magic;
+    header.version = Version;
+    header.entityCount = records.size();
+    header.entitiesOffset = AlignSection(sizeof(Header));
+    header.levelsOffset = AlignSection(header.entitiesOffset + records.size() * sizeof(EntityRecord));
+    header.levelsCount = levels.size();
+    header.pointsOffset = AlignSection(header.levelsOffset + levels.size() * sizeof(LevelRecord));
+    header.pointsCount = points.size();
+    header.verticesOffset = AlignSection(header.pointsOffset + points.size() * sizeof(glm::vec2));
+    header.verticesCount = bufferFloats + levelVertices.size();
+    header.triangulationHash = withGeometry ? TriangulationVisitor::GetAlgorithmHash() : 0;
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cout << "Can't open scene file for writing: " << path << std::endl;
+        return false;
+    }
+
+    const char padding[16] = {};
+    auto writeSection = [&](uint64_t offset, const void* data, size_t size) {
+        out.write(padding, offset - static_cast<uint64_t>(out.tellp()));
+        out.write(static_cast<const char*>(data), size);
+    };
+    writeSection(0, &header, sizeof(header));
+    writeSection(header.entitiesOffset, records.data(), records.size() * sizeof(EntityRecord));
+    writeSection(header.levelsOffset, levels.data(), levels.size() * sizeof(LevelRecord));
+    writeSection(header.pointsOffset, points.data(), points.size() * sizeof(glm::vec2));
+    writeSection(header.verticesOffset, scene.GetBufferAsArray(), bufferFloats * sizeof(GLfloat));
+    out.write(reinterpret_cast<const char*>(levelVertices.data()), levelVertices.size() * sizeof(GLfloat));
+
+    return out.good();
+}
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string& path)
+{
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        file = nullptr;
+        return;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+        return;
+
+    mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping)
+        return;
+
+    data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (data)
+        size = static_cast<size_t>(fileSize.QuadPart);
+}
+
+MappedFile::~MappedFile()
+{
+    if (data)
+        UnmapViewOfFile(data);
+    if (mapping)
+        CloseHandle(mapping);
+    if (file)
+        CloseHandle(file);
+}
+#else
+MappedFile::MappedFile(const std::string& path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return;
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) == 0 && fileStat.st_size > 0) {
+        void* view = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (view != MAP_FAILED) {
+            madvise(view, fileStat.st_size, MADV_SEQUENTIAL);
+            data = static_cast<const uint8_t*>(view);
+            size = static_cast<size_t>(fileStat.st_size);
+        }
+    }
+    close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if (data)
+        munmap(const_cast<uint8_t*>(data), size);
+}
+#endif
+
+SceneFileReader::SceneFileReader(const std::string& path) : file(path)
+{
+    if (file.GetSize() < sizeof(SceneFile::Header)) {
+        std::cout << "Can't read scene file: " << path << std::endl;
+        return;
+    }
+
+    const SceneFile::Header* fileHeader = reinterpret_cast<const SceneFile::Header*>(file.GetData());
+    if (fileHeader->magic != SceneFile::Magic || fileHeader->version != SceneFile::Version) {
+        std::cout << "Unsupported scene file: " << path << std::endl;
+        return;
+    }
+
+    auto isInside = [&](uint64_t offset, uint64_t count, uint64_t itemSize) {
+        return offset <= file.GetSize() && count <= (file.GetSize() - offset) / itemSize;
+    };
+    if (!isInside(fileHeader->entitiesOffset, fileHeader->entityCount, sizeof(SceneFile::EntityRecord)) ||
+        !isInside(fileHeader->levelsOffset, fileHeader->levelsCount, sizeof(SceneFile::LevelRecord)) ||
+        !isInside(fileHeader->pointsOffset, fileHeader->pointsCount, sizeof(glm::vec2)) ||
+        !isInside(fileHeader->verticesOffset, fileHeader->verticesCount, sizeof(GLfloat))) {
+        std::cout << "Scene file is truncated: " << path << std::endl;
+        return;
+    }
+
+    header = fileHeader;
+    if (header->verticesCount > 0 && !HasGeometry())
+        std::cout << "Scene file geometry is outdated and will be triangulated again: " << path << std::endl;
+
+    records = reinterpret_cast<const SceneFile::EntityRecord*>(file.GetData() + header->entitiesOffset);
+    levels = reinterpret_cast<const SceneFile::LevelRecord*>(file.GetData() + header->levelsOffset);
+    points = reinterpret_cast<const glm::vec2*>(file.GetData() + header->pointsOffset);
+    vertices = reinterpret_cast<const GLfloat*>(file.GetData() + header->verticesOffset);
+}
+
+bool SceneFileReader::HasGeometry() const
+{
+    return IsValid() && header->verticesCount > 0 &&
+        header->triangulationHash == TriangulationVisitor::GetAlgorithmHash();
+}
+
+size_t SceneFileReader::ReadChunk(Scene& scene, size_t maxEntities)
+{
+    std::vector<std::shared_ptr<Entity>> entities;
+    std::vector<GLfloat> chunkVertices;
+    for (; entities.size() < maxEntities && !IsFinished(); ++nextEntity) {
+        const SceneFile::EntityRecord& record = records[nextEntity];
+        std::shared_ptr<Entity> entity = CreateEntity(record);
+        if (!entity) {
+            std::cout << "Skipping invalid scene record " << nextEntity << std::endl;
+            continue;
+        }
+        entities.push_back(entity);
+        if (!HasGeometry())
+            continue;
+
+        uint64_t floatsCount = uint64_t(record.trianglesCount) * 3 * 3;
+        size_t first = chunkVertices.size();
+        if (record.firstVertex <= header->verticesCount && floatsCount <= header->verticesCount - record.firstVertex) {
+            chunkVertices.insert(chunkVertices.end(), vertices + record.firstVertex, vertices + record.firstVertex + floatsCount);
+            ReadDetailLevels(record, *entity);
+        }
+        else {
+            // the whole chunk is added as one batch, so a record without geometry is triangulated here
+            chunkVertices.resize(first + floatsCount);
+            TriangulationVisitor traingulation(chunkVertices, first);
+            entity->Accept(&traingulation);
+            entity->BuildDetailLevels(entity->detailLevels);
+        }
+    }
+
+    scene.AddEntities(entities, chunkVertices.empty() ? nullptr : chunkVertices.data());
+    return entities.size();
+}
+
+std::shared_ptr<Entity> SceneFileReader::CreateEntity(const SceneFile::EntityRecord& record) const
+{
+    std::shared_ptr<Entity> entity;
+    if (record.type == SceneFile::EntityCube) {
+        entity.reset(new Cube(glm::vec3(0.0), record.edgeLength,
+            glm::make_vec3(record.mainAxis), glm::make_vec3(record.auxilaryAxis)));
+        entity->translation = glm::make_mat4(record.translation);
+    }
+    else if (record.type == SceneFile::EntityPolygon2D) {
+        if (record.pointsCount < 3 ||
+            record.firstPoint > header->pointsCount ||
+            record.pointsCount > header->pointsCount - record.firstPoint)
+            return nullptr;
+
+        std::vector<glm::vec2> polygonPoints(points + record.firstPoint, points + record.firstPoint + record.pointsCount);
+        // points are stored relative to the entity origin already
+        entity.reset(new Polygon2D(polygonPoints, glm::make_mat4(record.translation)));
+    }
+    else {
+        return nullptr;
+    }
+
+    if (entity->GetTrianglesCount() != static_cast<GLsizei>(record.trianglesCount))
+        return nullptr;
+
+    entity->rotation = glm::make_mat4(record.rotation);
+    return entity;
+}
+
+void SceneFileReader::ReadDetailLevels(const SceneFile::EntityRecord& record, Entity& entity) const
+{
+    entity.detailLevels.clear();
+    if (record.firstLevel > header->levelsCount || record.levelsCount > header->levelsCount - record.firstLevel)
+        return;
+
+    for (uint64_t k = record.firstLevel; k < record.firstLevel + record.levelsCount; ++k) {
+        const SceneFile::LevelRecord& levelRecord = levels[k];
+        uint64_t floatsCount = uint64_t(levelRecord.verticesCount) * 3;
+        if (levelRecord.firstVertex > header->verticesCount || floatsCount > header->verticesCount - levelRecord.firstVertex)
+            break;
+
+        DetailLevel level;
+        level.tolerance = levelRecord.tolerance;
+        level.impostor = levelRecord.impostor != 0;
+        level.verticesCount = static_cast<GLsizei>(levelRecord.verticesCount);
+        level.vertices.assign(vertices + levelRecord.firstVertex, vertices + levelRecord.firstVertex + floatsCount);
+        entity.detailLevels.push_back(std::move(level));
+    }
+}
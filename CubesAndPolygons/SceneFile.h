@@ -0,0 +1,125 @@
+#pragma once
+#include "Scene.h"
+
+#include <cstdint>
+#include <string>
+
+// Binary scene layout:
+//   Header | EntityRecord[entityCount] | LevelRecord[levelsCount] | glm::vec2 points[pointsCount] | GLfloat vertices[verticesCount]
+// Every section starts on a 16 byte boundary, so a mapped file can be used in place:
+// records are read directly and the vertex section is handed to the scene buffer as is.
+// The vertices of the detail levels follow the scene buffer in the vertex section.
+namespace SceneFile
+{
+    const uint32_t Magic = 0x53505043; // "CPPS"
+    const uint32_t Version = 2;
+
+    enum EntityType : uint32_t
+    {
+        EntityCube = 0,
+        EntityPolygon2D = 1
+    };
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t entityCount;
+        uint64_t entitiesOffset;
+        uint64_t pointsOffset;
+        uint64_t pointsCount;
+        uint64_t verticesOffset;
+        uint64_t verticesCount; // 0 if the file has no pre-triangulated geometry
+        uint64_t levelsOffset;
+        uint64_t levelsCount;
+        uint32_t triangulationHash; // TriangulationVisitor::GetAlgorithmHash() of the vertex section
+        uint32_t reserved;
+    };
+
+    struct EntityRecord
+    {
+        uint32_t type;
+        uint32_t trianglesCount;
+        float translation[16];
+        float rotation[16];
+        // Cube
+        double edgeLength;
+        float mainAxis[3];
+        float auxilaryAxis[3];
+        // Polygon2D
+        uint64_t firstPoint;
+        uint64_t pointsCount;
+        // index of the first float in the vertex section
+        uint64_t firstVertex;
+        // detail levels of the geometry, none in files without geometry
+        uint64_t firstLevel;
+        uint64_t levelsCount;
+    };
+
+    struct LevelRecord
+    {
+        float tolerance;
+        uint32_t impostor;
+        uint32_t verticesCount;
+        uint32_t reserved;
+        // index of the first float in the vertex section
+        uint64_t firstVertex;
+    };
+
+    static_assert(sizeof(Header) == 80, "SceneFile::Header layout changed");
+    static_assert(sizeof(EntityRecord) == 208, "SceneFile::EntityRecord layout changed");
+    static_assert(sizeof(LevelRecord) == 24, "SceneFile::LevelRecord layout changed");
+
+    bool Save(const Scene& scene, const std::string& path, bool withGeometry);
+}
+
+// Read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const uint8_t* GetData() const { return data; }
+    size_t GetSize() const { return size; }
+
+private:
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    void* file = nullptr;
+    void* mapping = nullptr;
+#endif
+};
+
+// Streams entities of a mapped scene file into a Scene in chunks,
+// so the application can stay interactive while a large file is loaded.
+class SceneFileReader
+{
+public:
+    explicit SceneFileReader(const std::string& path);
+
+    bool IsValid() const { return header != nullptr; }
+    bool IsFinished() const { return !IsValid() || nextEntity >= header->entityCount; }
+    // false also when the geometry was produced by another triangulation algorithm
+    bool HasGeometry() const;
+
+    // Adds up to maxEntities entities to the scene, returns the number added
+    size_t ReadChunk(Scene& scene, size_t maxEntities);
+
+private:
+    std::shared_ptr<Entity> CreateEntity(const SceneFile::EntityRecord& record) const;
+    // Detail levels stored with the geometry, the ones out of the file are dropped
+    void ReadDetailLevels(const SceneFile::EntityRecord& record, Entity& entity) const;
+
+    MappedFile file;
+    const SceneFile::Header* header = nullptr;
+    const SceneFile::EntityRecord* records = nullptr;
+    const SceneFile::LevelRecord* levels = nullptr;
+    const glm::vec2* points = nullptr;
+    const GLfloat* vertices = nullptr;
+    uint64_t nextEntity = 0;
+};
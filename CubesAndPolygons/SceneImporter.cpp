@@ -0,0 +1,211 @@
+#include "SceneImporter.h"
+#include "SceneFile.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <thread>
+
+namespace
+{
+    struct ChunkResult
+    {
+        std::vector<std::shared_ptr<Entity>> entities;
+        size_t verticesCount = 0;
+        size_t skippedLines = 0;
+    };
+
+    bool IsSeparator(char c)
+    {
+        return c == ' ' || c == '\t' || c == ',' || c == '\r';
+    }
+
+    void SkipSeparators(const char*& p, const char* end)
+    {
+        while (p < end && IsSeparator(*p))
+            ++p;
+    }
+
+    // the whole word only, followed by a separator, the WKT parenthesis or the line end; "cubes" or "polygonX" do not match
+    bool MatchKeyword(const char*& p, const char* end, const char* keyword)
+    {
+        const char* q = p;
+        for (; *keyword; ++keyword, ++q) {
+            if (q == end || tolower(static_cast<unsigned char>(*q)) != *keyword)
+                return false;
+        }
+        if (q < end && !IsSeparator(*q) && *q != '(')
+            return false;
+        p = q;
+        return true;
+    }
+
+    // Locale independent, does not need a null terminated input
+    bool ParseFloat(const char*& p, const char* end, float& value)
+    {
+        SkipSeparators(p, end);
+        const char* q = p;
+        bool negative = false;
+        if (q < end && (*q == '-' || *q == '+'))
+            negative = (*q++ == '-');
+
+        double mantissa = 0.0;
+        int exponent = 0;
+        bool hasDigits = false;
+        for (; q < end && *q >= '0' && *q <= '9'; ++q, hasDigits = true)
+            mantissa = mantissa * 10.0 + (*q - '0');
+        if (q < end && *q == '.') {
+            for (++q; q < end && *q >= '0' && *q <= '9'; ++q, hasDigits = true) {
+                mantissa = mantissa * 10.0 + (*q - '0');
+                --exponent;
+            }
+        }
+        if (!hasDigits)
+            return false;
+
+        if (q < end && (*q == 'e' || *q == 'E')) {
+            const char* e = q + 1;
+            bool negativeExponent = false;
+            if (e < end && (*e == '-' || *e == '+'))
+                negativeExponent = (*e++ == '-');
+            if (e < end && *e >= '0' && *e <= '9') {
+                int value = 0;
+                for (; e < end && *e >= '0' && *e <= '9'; ++e)
+                    value = std::min(value * 10 + (*e - '0'), 1000);
+                exponent += negativeExponent ? -value : value;
+                q = e;
+            }
+        }
+
+        double result = mantissa * std::pow(10.0, exponent);
+        value = static_cast<float>(negative ? -result : result);
+        p = q;
+        return true;
+    }
+
+    std::shared_ptr<Entity> ParseCube(const char* p, const char* end)
+    {
+        float values[10];
+        for (int i = 0; i < 10; ++i) {
+            if (!ParseFloat(p, end, values[i]))
+                return nullptr;
+        }
+
+        return std::shared_ptr<Entity>(new Cube(glm::vec3(values[0], values[1], values[2]), values[3],
+            glm::vec3(values[4], values[5], values[6]), glm::vec3(values[7], values[8], values[9])));
+    }
+
+    std::shared_ptr<Entity> ParsePolygon(const char* p, const char* end)
+    {
+        std::vector<glm::vec2> points;
+        SkipSeparators(p, end);
+        bool isWkt = (p < end && *p == '(');
+        if (isWkt) {
+            // outer ring only: POLYGON ((x y, x y, ...), (hole), ...)
+            while (p < end && *p == '(')
+                ++p;
+            end = std::find(p, end, ')');
+        }
+
+        glm::vec2 point;
+        while (ParseFloat(p, end, point.x)) {
+            if (!ParseFloat(p, end, point.y))
+                return nullptr;
+            points.push_back(point);
+        }
+
+        // rings in WKT repeat the first point at the end
+        if (points.size() > 1 && points.front() == points.back())
+            points.pop_back();
+        if (points.size() < 3)
+            return nullptr;
+
+        return std::shared_ptr<Entity>(new Polygon2D(points));
+    }
+
+    void ParseChunk(const char* begin, const char* end, ChunkResult& result)
+    {
+        while (begin < end) {
+            const char* lineEnd = std::find(begin, end, '\n');
+            const char* p = begin;
+            begin = (lineEnd == end) ? end : lineEnd + 1;
+
+            SkipSeparators(p, lineEnd);
+            if (p == lineEnd || *p == '#')
+                continue;
+
+            std::shared_ptr<Entity> entity;
+            if (MatchKeyword(p, lineEnd, "cube"))
+                entity = ParseCube(p, lineEnd);
+            else if (MatchKeyword(p, lineEnd, "polygon"))
+                entity = ParsePolygon(p, lineEnd);
+
+            if (!entity) {
+                ++result.skippedLines;
+                continue;
+            }
+            result.verticesCount += entity->GetTrianglesCount() * 3;
+            result.entities.push_back(entity);
+        }
+    }
+}
+
+size_t SceneImporter::Import(Scene& scene, const std::string& path, unsigned threadsCount)
+{
+    MappedFile file(path);
+    if (!file.GetData()) {
+        std::cout << "Can't read scene file: " << path << std::endl;
+        return 0;
+    }
+
+    auto startTime = std::chrono::steady_clock::now();
+
+    if (threadsCount == 0)
+        threadsCount = std::max(1u, std::thread::hardware_concurrency());
+
+    // every chunk owns the lines starting inside it
+    const char* data = reinterpret_cast<const char*>(file.GetData());
+    const char* dataEnd = data + file.GetSize();
+    std::vector<const char*> bounds(threadsCount + 1, dataEnd);
+    bounds[0] = data;
+    for (unsigned i = 1; i < threadsCount; ++i) {
+        const char* p = std::max(bounds[i - 1], data + file.GetSize() * i / threadsCount);
+        if (p > data && p[-1] != '\n') {
+            p = std::find(p, dataEnd, '\n');
+            if (p != dataEnd)
+                ++p;
+        }
+        bounds[i] = p;
+    }
+
+    std::vector<ChunkResult> results(threadsCount);
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < threadsCount; ++i)
+        threads.emplace_back(ParseChunk, bounds[i], bounds[i + 1], std::ref(results[i]));
+    for (std::thread& thread : threads)
+        thread.join();
+
+    auto parsedTime = std::chrono::steady_clock::now();
+
+    std::vector<std::shared_ptr<Entity>> entities;
+    size_t verticesCount = 0;
+    size_t skippedLines = 0;
+    for (ChunkResult& result : results) {
+        entities.insert(entities.end(), result.entities.begin(), result.entities.end());
+        verticesCount += result.verticesCount;
+        skippedLines += result.skippedLines;
+    }
+    scene.AddEntities(entities);
+
+    auto endTime = std::chrono::steady_clock::now();
+    double parseSeconds = std::max(std::chrono::duration<double>(parsedTime - startTime).count(), 1e-9);
+    double totalSeconds = std::max(std::chrono::duration<double>(endTime - startTime).count(), 1e-9);
+    std::cout << "Imported " << entities.size() << " entities (" << skippedLines << " lines skipped) from " << path
+        << ": parsing " << file.GetSize() / parseSeconds / (1024.0 * 1024.0) << " MB/s, "
+        << verticesCount / totalSeconds << " vertices/s added to the scene, "
+        << threadsCount << " threads" << std::endl;
+
+    return entities.size();
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include "Scene.h"
+
+#include <string>
+
+// Imports entities from a line-oriented text file, one entity per line:
+//   cube cx cy cz edge mx my mz ax ay az
+//   polygon x1 y1 x2 y2 x3 y3 ...
+//   POLYGON ((x1 y1, x2 y2, x3 y3, ...))   - WKT, holes are ignored
+// Values may be separated by spaces, tabs or commas, '#' starts a comment line.
+// The file is split into chunks parsed in parallel, then added with Scene::AddEntities,
+// so it can run on a background thread while the scene is used.
+class SceneImporter
+{
+public:
+    // threadsCount == 0 means one thread per hardware core, returns the number of imported entities
+    static size_t Import(Scene& scene, const std::string& path, unsigned threadsCount = 0);
+};
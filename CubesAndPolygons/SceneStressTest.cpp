@@ -0,0 +1,183 @@
+#include "SceneStressTest.h"
+#include "Scene.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <thread>
+
+namespace
+{
+    // the writer and the sequence number of every entity are kept in its z, which moves do not change
+    const size_t MaxSequence = 1 << 20;
+
+    size_t Fail(size_t& failures, const std::string& message)
+    {
+        if (failures++ < 10)
+            std::cout << "scene stress: " << message << std::endl;
+        return failures;
+    }
+}
+
+size_t SceneStressTest::Run(unsigned writersCount, size_t batchesCount, size_t batchSize)
+{
+    auto startTime = std::chrono::steady_clock::now();
+    size_t totalEntities = writersCount * batchesCount * batchSize;
+    if (batchesCount * batchSize > MaxSequence) {
+        std::cout << "scene stress: at most " << MaxSequence << " entities per writer" << std::endl;
+        return 1;
+    }
+
+    Scene scene;
+    // writers triangulate on their own threads already
+    scene.SetTriangulationThreads(1);
+
+    std::atomic<unsigned> writersDone { 0 };
+    auto write = [&](unsigned writer) {
+        std::mt19937 random(writer + 1);
+        std::uniform_real_distribution<float> unit(-0.95f, 0.95f);
+        std::vector<std::shared_ptr<Entity>> batch;
+        for (size_t b = 0; b < batchesCount; ++b) {
+            batch.clear();
+            for (size_t i = 0; i < batchSize; ++i) {
+                size_t sequence = b * batchSize + i;
+                std::vector<glm::vec2> points;
+                size_t pointsCount = 3 + sequence % 4;
+                for (size_t k = 0; k < pointsCount; ++k) {
+                    float angle = 6.2831853f * k / pointsCount;
+                    points.push_back(0.01f * glm::vec2(std::cos(angle), std::sin(angle)));
+                }
+                glm::vec3 origin(unit(random), unit(random), float(writer * MaxSequence + sequence));
+                batch.push_back(std::make_shared<Polygon2D>(points, glm::translate(glm::mat4(1.0f), origin)));
+            }
+            scene.AddEntities(batch);
+        }
+        ++writersDone;
+    };
+
+    // reads every view it gets like a render loop would, the checks cover the entities added since the last one
+    size_t failures = 0;
+    size_t viewsRead = 0;
+    double slowestRead = 0.0;
+    std::atomic<bool> finished { false };
+    std::shared_ptr<const SceneView> finalView;
+    auto read = [&]() {
+        std::shared_ptr<const SceneView> previous = scene.GetView();
+        std::vector<size_t> nextSequence(writersCount, 0);
+        size_t checked = 0;
+        for (;;) {
+            bool last = finished;
+            std::shared_ptr<const SceneView> view = scene.GetView();
+            auto readStart = std::chrono::steady_clock::now();
+            if (view != previous) {
+                if (view->epoch <= previous->epoch)
+                    Fail(failures, "epoch " + std::to_string(view->epoch) + " after " + std::to_string(previous->epoch));
+                if (view->entitiesCount < previous->entitiesCount)
+                    Fail(failures, "entities count went back");
+                size_t chunksCount = (view->entitiesCount + SceneView::ChunkSize - 1) / SceneView::ChunkSize;
+                if (view->chunks.size() != chunksCount || view->transforms.size() != chunksCount) {
+                    Fail(failures, "chunks do not cover the entities");
+                    previous = view;
+                    if (last)
+                        break;
+                    continue;
+                }
+                for (size_t c = 0; c < view->chunks.size(); ++c) {
+                    if (view->chunks[c]->entities.size() != view->transforms[c]->size())
+                        Fail(failures, "transforms do not match the chunk");
+                }
+                // nothing is removed, so the full chunks of the older view are shared as they are
+                for (size_t c = 0; c < previous->entitiesCount / SceneView::ChunkSize; ++c) {
+                    if (view->chunks[c] != previous->chunks[c])
+                        Fail(failures, "full chunk " + std::to_string(c) + " was copied");
+                }
+
+                for (size_t i = checked; i < view->entitiesCount; ++i) {
+                    if (!view->GetEntity(i)) {
+                        Fail(failures, "missing entity " + std::to_string(i));
+                        continue;
+                    }
+                    GLint expected = i == 0 ? 0 : view->GetFirstVertex(i - 1) + view->GetEntity(i - 1)->GetTrianglesCount() * 3;
+                    if (view->GetFirstVertex(i) != expected)
+                        Fail(failures, "first vertex of entity " + std::to_string(i));
+                    size_t code = size_t(view->GetTransform(i)[3].z);
+                    size_t writer = code / MaxSequence, sequence = code % MaxSequence;
+                    if (writer >= writersCount || sequence != nextSequence[writer]++)
+                        Fail(failures, "entity " + std::to_string(i) + " out of order");
+                }
+                checked = view->entitiesCount;
+                for (unsigned writer = 0; writer < writersCount; ++writer) {
+                    if (nextSequence[writer] % batchSize != 0)
+                        Fail(failures, "a batch of writer " + std::to_string(writer) + " is split between views");
+                }
+            }
+
+            // a pass over the whole view, as a frame would make
+            size_t inside = 0;
+            for (size_t i = 0; i < view->entitiesCount; ++i) {
+                const glm::mat4& transform = view->GetTransform(i);
+                inside += std::abs(transform[3].x) <= 1.0f && std::abs(transform[3].y) <= 1.0f;
+            }
+            if (inside > view->entitiesCount)
+                Fail(failures, "impossible count");
+            std::chrono::duration<double, std::milli> readTime = std::chrono::steady_clock::now() - readStart;
+            slowestRead = std::max(slowestRead, readTime.count());
+            ++viewsRead;
+            previous = view;
+            if (last)
+                break;
+        }
+        finalView = previous;
+    };
+
+    std::vector<std::thread> writers;
+    for (unsigned writer = 0; writer < writersCount; ++writer)
+        writers.emplace_back(write, writer);
+    std::thread reader(read);
+
+    // the owner thread: commits, moves a few entities and builds a frame, as the main loop does
+    std::mt19937 random(0);
+    FrameSnapshot snapshot;
+    size_t framesCount = 0;
+    double slowestFrame = 0.0;
+    for (bool writing = true; writing;) {
+        writing = writersDone < writersCount;
+        auto frameStart = std::chrono::steady_clock::now();
+        scene.CommitPendingEntities();
+        size_t entitiesCount = scene.GetEntities().size();
+        for (int move = 0; move < 16 && entitiesCount > 0; ++move) {
+            size_t index = random() % entitiesCount;
+            std::shared_ptr<Entity> entity = scene.GetEntity(index);
+            entity->translation = glm::translate(entity->translation, glm::vec3(0.001f, -0.001f, 0.0f));
+            scene.UpdateBounds(index);
+        }
+        scene.BuildFrameSnapshot(snapshot, false);
+        std::chrono::duration<double, std::milli> frameTime = std::chrono::steady_clock::now() - frameStart;
+        slowestFrame = std::max(slowestFrame, frameTime.count());
+        ++framesCount;
+    }
+    for (std::thread& writer : writers)
+        writer.join();
+    scene.CommitPendingEntities();
+    finished = true;
+    reader.join();
+
+    if (finalView->entitiesCount != totalEntities)
+        Fail(failures, "the last view has " + std::to_string(finalView->entitiesCount) + " of " + std::to_string(totalEntities) + " entities");
+    for (size_t i = 0; i < finalView->entitiesCount; ++i) {
+        if (finalView->GetTransform(i) != scene.GetEntity(i)->GetTransform())
+            Fail(failures, "the last view has an old transform of entity " + std::to_string(i));
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    std::cout << "scene stress: " << writersCount << " writers added " << totalEntities << " entities in "
+        << seconds * 1000.0 << " ms (" << totalEntities / seconds << " entities/s); owner built " << framesCount
+        << " frames, slowest " << slowestFrame << " ms; reader checked " << viewsRead << " views, slowest pass "
+        << slowestRead << " ms; " << failures << " failed checks" << std::endl;
+    return failures;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+
+// Writer threads add entities to one scene while the owner thread commits them, moves some of them and
+// builds frames, and a reader thread iterates every published view. The reader checks that views never
+// go back, that chunks of older views stay as they were, that first vertices follow the triangle counts
+// and that batches appear whole and in the order their writer added them.
+class SceneStressTest
+{
+public:
+    // returns the number of failed checks
+    static size_t Run(unsigned writersCount = 4, size_t batchesCount = 1000, size_t batchSize = 64);
+};
@@ -0,0 +1,236 @@
+#include "SelectionTest.h"
+#include "Cube.h"
+#include "FrameSnapshot.h"
+#include "Lasso.h"
+#include "Polygon2D.h"
+#include "Scene.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace
+{
+    // points closer than this to an outline may be taken either way by rounding
+    const float Tolerance = 1e-5f;
+
+    size_t Fail(size_t& failures, const std::string& message)
+    {
+        if (failures++ < 10)
+            std::cout << "selection: " << message << std::endl;
+        return failures;
+    }
+
+    // outline around the origin with the given radius function, counter-clockwise
+    template <typename Radius>
+    std::vector<glm::vec2> MakeOutline(size_t pointsCount, Radius radius)
+    {
+        std::vector<glm::vec2> points;
+        for (size_t i = 0; i < pointsCount; ++i) {
+            float angle = 6.2831853f * i / pointsCount;
+            float r = radius(i);
+            points.push_back(glm::vec2(r * std::cos(angle), r * std::sin(angle)));
+        }
+        return points;
+    }
+
+    // even-odd rule over every edge, in double
+    bool IsInside(const std::vector<glm::vec2>& outline, const glm::vec2& point)
+    {
+        bool inside = false;
+        for (size_t i = 0; i < outline.size(); ++i) {
+            glm::dvec2 a(outline[i]), b(outline[(i + 1) % outline.size()]);
+            if ((a.y > point.y) != (b.y > point.y) && point.x < a.x + (point.y - a.y) * (b.x - a.x) / (b.y - a.y))
+                inside = !inside;
+        }
+        return outline.size() > 2 && inside;
+    }
+
+    bool IsNearOutline(const std::vector<glm::vec2>& outline, const glm::vec2& point)
+    {
+        for (size_t i = 0; i < outline.size(); ++i) {
+            glm::vec2 a = outline[i], edge = outline[(i + 1) % outline.size()] - a;
+            float along = glm::dot(edge, edge) > 0.0f ? glm::clamp(glm::dot(point - a, edge) / glm::dot(edge, edge), 0.0f, 1.0f) : 0.0f;
+            if (glm::length(a + along * edge - point) < Tolerance)
+                return true;
+        }
+        return false;
+    }
+
+    // scattered points cross themselves all over, stars and noisy ellipses are drawn by hand
+    size_t CheckLassos(size_t outlinesCount, size_t& failures)
+    {
+        std::mt19937 random(8);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+        size_t checked = 0;
+        for (size_t o = 0; o < outlinesCount; ++o) {
+            std::vector<glm::vec2> outline;
+            size_t pointsCount = 3 + random() % 400;
+            if (o % 3 == 0) {
+                for (size_t i = 0; i < pointsCount; ++i)
+                    outline.push_back(glm::vec2(unit(random), unit(random)));
+            }
+            else if (o % 3 == 1) {
+                outline = MakeOutline(pointsCount, [&](size_t i) { return (i % 2) ? 0.3f + 0.2f * unit(random) : 0.9f; });
+            }
+            else {
+                // two turns around, the inner one smaller, so the outline crosses itself
+                for (size_t i = 0; i < pointsCount; ++i) {
+                    float angle = 2.0f * 6.2831853f * i / pointsCount, r = (i < pointsCount / 2) ? 0.9f : 0.6f;
+                    outline.push_back(glm::vec2(r * std::cos(angle), 0.5f * r * std::sin(angle)) + 0.01f * glm::vec2(unit(random), unit(random)));
+                }
+            }
+
+            Lasso lasso(outline);
+            for (size_t p = 0; p < 2000; ++p) {
+                glm::vec2 point(unit(random) * 1.1f, unit(random) * 1.1f);
+                // some points exactly at the height of an outline point, where edges start and end
+                if (p % 10 == 0)
+                    point.y = outline[random() % outline.size()].y;
+                if (lasso.Contains(point) != IsInside(outline, point) && !IsNearOutline(outline, point))
+                    Fail(failures, "outline " + std::to_string(o) + " of " + std::to_string(outline.size()) + " points has ("
+                        + std::to_string(point.x) + ", " + std::to_string(point.y) + ") " + (lasso.Contains(point) ? "inside" : "outside"));
+                ++checked;
+            }
+        }
+        return checked;
+    }
+}
+
+size_t SelectionTest::Run(size_t entitiesCount, size_t movesCount, size_t outlinesCount)
+{
+    size_t failures = 0;
+    std::ostringstream report;
+    report << "selection: " << CheckLassos(outlinesCount, failures) << " points tested with " << outlinesCount << " lassos; ";
+
+    // small cubes and triangles spread over the window
+    std::mt19937 random(6);
+    std::uniform_real_distribution<float> unit(-0.95f, 0.95f);
+    std::vector<std::shared_ptr<Entity>> entities;
+    for (size_t i = 0; i < entitiesCount; ++i) {
+        glm::vec3 center(unit(random), unit(random), 0.0f);
+        if (i % 2)
+            entities.push_back(std::make_shared<Cube>(center, 0.004, glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+        else
+            entities.push_back(std::make_shared<Polygon2D>(MakeOutline(3, [](size_t) { return 0.003f; }),
+                glm::translate(glm::mat4(1.0f), center)));
+    }
+
+    Scene scene;
+    scene.AddEntities(entities);
+    scene.CommitPendingEntities();
+    const int Width = 800, Height = 800;
+    scene.SetViewport(glm::vec2(-1.0f), glm::vec2(1.0f), 2.0f / Width);
+
+    // the outline of the open band as the frame draws it, then the group against the world bounds of every entity;
+    // entities whose bounds reach within the tolerance of the outline may go either way
+    FrameSnapshot snapshot;
+    auto select = [&](const char* name, bool lasso, double& time) {
+        scene.BuildFrameSnapshot(snapshot, false);
+        std::vector<glm::vec2> outline = snapshot.selectionOutline;
+        auto startTime = std::chrono::steady_clock::now();
+        size_t selected = scene.EndBandSelection();
+        time += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+        glm::vec2 bandMin(0.0), bandMax(0.0);
+        for (size_t i = 0; i < outline.size(); ++i) {
+            bandMin = (i == 0) ? outline[i] : glm::min(bandMin, outline[i]);
+            bandMax = (i == 0) ? outline[i] : glm::max(bandMax, outline[i]);
+        }
+        const std::vector<size_t>& group = scene.GetGroup();
+        if (selected != group.size())
+            Fail(failures, std::string(name) + " returned " + std::to_string(selected) + " for a group of " + std::to_string(group.size()));
+        for (size_t index = 0; index < entitiesCount; ++index) {
+            glm::vec3 minPoint, maxPoint;
+            entities[index]->GetWorldBounds(minPoint, maxPoint);
+            glm::vec2 entityMin(minPoint), entityMax(maxPoint);
+            bool expected, ambiguous;
+            if (lasso) {
+                glm::vec2 center = (entityMin + entityMax) * 0.5f;
+                expected = IsInside(outline, center);
+                ambiguous = IsNearOutline(outline, center);
+            }
+            else {
+                expected = glm::all(glm::lessThanEqual(bandMin, entityMin)) && glm::all(glm::lessThanEqual(entityMax, bandMax));
+                ambiguous = glm::any(glm::lessThan(glm::abs(glm::vec4(entityMin - bandMin, entityMax - bandMax)), glm::vec4(Tolerance)));
+            }
+            if (std::binary_search(group.begin(), group.end(), index) != expected && !ambiguous)
+                Fail(failures, std::string(name) + (expected ? " missed entity " : " took entity ") + std::to_string(index));
+        }
+        return selected;
+    };
+
+    // an ellipse drawn with the cursor
+    double lassoTime = 0.0;
+    auto startTime = std::chrono::steady_clock::now();
+    scene.BeginBandSelection(300.0, 200.0, Width, Height, true);
+    for (int i = 1; i <= 200; ++i) {
+        float angle = 6.2831853f * i / 200;
+        scene.MouseMove(400.0f + 100.0f * std::cos(angle), 400.0f - 200.0f * std::sin(angle), Width, Height);
+    }
+    lassoTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    size_t lassoSelected = select("lasso", true, lassoTime);
+
+    double bandTime = 0.0;
+    startTime = std::chrono::steady_clock::now();
+    scene.BeginBandSelection(0.0, 0.0, Width, Height, false);
+    scene.MouseMove(float(Width), float(Height), Width, Height);
+    bandTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    size_t bandSelected = select("rubber band", false, bandTime);
+
+    // drag everything by a pixel per frame, every entity moves as much as the others; then turn it
+    std::vector<glm::vec2> positions;
+    for (const std::shared_ptr<Entity>& entity : entities)
+        positions.push_back(glm::vec2(entity->GetTransform()[3]));
+    size_t moves;
+    double slowestMove, slowestTurn;
+    scene.SetSelected(1, 0.0, 0.0);
+    for (size_t move = 1; move <= movesCount; ++move) {
+        scene.MouseMove(float(move), float(move), Width, Height);
+        scene.ApplyMouseMoves();
+    }
+    scene.TakeGroupMoveCounters(moves, slowestMove);
+    glm::vec2 offset = glm::vec2(entities[0]->GetTransform()[3]) - positions[0];
+    for (size_t index = 0; index < entitiesCount; ++index) {
+        bool grouped = std::binary_search(scene.GetGroup().begin(), scene.GetGroup().end(), index);
+        glm::vec2 moved = glm::vec2(entities[index]->GetTransform()[3]) - positions[index];
+        if (glm::length(moved - (grouped ? offset : glm::vec2(0.0f))) > Tolerance)
+            Fail(failures, "entity " + std::to_string(index) + " moved by (" + std::to_string(moved.x) + ", " + std::to_string(moved.y) + ")");
+    }
+    scene.SetRotationMode(true);
+    for (size_t move = 1; move <= movesCount; ++move) {
+        scene.MouseMove(float(movesCount + 2 * move), float(movesCount), Width, Height);
+        scene.ApplyMouseMoves();
+    }
+    scene.SetRotationMode(false);
+    scene.TakeGroupMoveCounters(moves, slowestTurn);
+    scene.SetSelected(0);
+
+    // after the moves the bounds have changed: a band dragged from its lower right corner and a star drawn
+    // in one stroke, whose middle is surrounded twice and left out
+    scene.BeginBandSelection(600.0, 500.0, Width, Height, false);
+    scene.MouseMove(150.0f, 250.0f, Width, Height);
+    size_t movedBandSelected = select("rubber band after the moves", false, bandTime);
+    scene.BeginBandSelection(400.0, 100.0, Width, Height, true);
+    for (int i = 1; i <= 500; ++i) {
+        // every stroke goes to the corner after the next one
+        float from = 1.5707963f + 2.5132741f * (i / 100), to = from + 2.5132741f;
+        glm::vec2 point = 300.0f * glm::mix(glm::vec2(std::cos(from), std::sin(from)), glm::vec2(std::cos(to), std::sin(to)), (i % 100) / 100.0f);
+        scene.MouseMove(400.0f + point.x, 400.0f - point.y, Width, Height);
+    }
+    size_t starSelected = select("star lasso after the moves", true, lassoTime);
+
+    std::cout << report.str() << entitiesCount << " entities, lasso selected " << lassoSelected << " and " << starSelected
+        << " in " << lassoTime << " ms, rubber band " << bandSelected << " and " << movedBandSelected << " in " << bandTime
+        << " ms; group moved in " << slowestMove << " ms, turned in " << slowestTurn << " ms at most per frame; "
+        << failures << " failed checks" << std::endl;
+    return failures;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+
+// Checks Lasso::Contains on random and self-intersecting outlines against a crossing count over all
+// of their edges. Then selects entities of a large scene with lassos and rubber bands, before and after
+// dragging and turning the selected group, times them and compares every group with the entities
+// whose world bounds are inside of the band, or whose bounds center is inside of the lasso.
+class SelectionTest
+{
+public:
+    // returns the number of failed checks
+    static size_t Run(size_t entitiesCount = 120000, size_t movesCount = 60, size_t outlinesCount = 200);
+};
@@ -0,0 +1,183 @@
+#include "TransformHierarchy.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <atomic>
+
+// used by reference in containers and conditional expressions
+const size_t TransformHierarchy::NoNode;
+
+size_t TransformHierarchy::AddNode(size_t parent, const glm::mat4& local)
+{
+    size_t node = parents.size();
+    parents.push_back(parent);
+    slots.push_back(ids.size());
+    ids.push_back(node);
+    parentSlots.push_back(parent == NoNode ? NoNode : slots[parent]);
+    locals.push_back(local);
+    worlds.push_back(glm::mat4(1.0f));
+    dirty.push_back(1);
+    recomputed.push_back(0);
+    ++dirtyCount;
+    // the new slot follows its parent, but the levels are known only after sorting
+    orderOutdated = true;
+    return node;
+}
+
+void TransformHierarchy::SetParent(size_t node, size_t parent)
+{
+    // a node can not go below itself
+    for (size_t ancestor = parent; ancestor != NoNode; ancestor = parents[ancestor]) {
+        if (ancestor == node)
+            return;
+    }
+    if (parents[node] == parent)
+        return;
+    parents[node] = parent;
+    size_t slot = slots[node];
+    if (!dirty[slot]) {
+        dirty[slot] = 1;
+        ++dirtyCount;
+    }
+    orderOutdated = true;
+}
+
+size_t TransformHierarchy::GetParent(size_t node) const
+{
+    return parents[node];
+}
+
+size_t TransformHierarchy::GetRoot(size_t node) const
+{
+    while (parents[node] != NoNode)
+        node = parents[node];
+    return node;
+}
+
+void TransformHierarchy::SetLocalTransform(size_t node, const glm::mat4& local)
+{
+    size_t slot = slots[node];
+    locals[slot] = local;
+    if (!dirty[slot]) {
+        dirty[slot] = 1;
+        ++dirtyCount;
+    }
+    if (!orderOutdated) {
+        size_t level = std::upper_bound(levelStarts.begin(), levelStarts.end(), slot) - levelStarts.begin() - 1;
+        firstDirtyLevel = std::min(firstDirtyLevel, level);
+    }
+}
+
+const glm::mat4& TransformHierarchy::GetLocalTransform(size_t node) const
+{
+    return locals[slots[node]];
+}
+
+const glm::mat4& TransformHierarchy::GetWorldTransform(size_t node) const
+{
+    return worlds[slots[node]];
+}
+
+void TransformHierarchy::Update(std::vector<size_t>& changed, unsigned threadsCount)
+{
+    if (orderOutdated)
+        Reorder();
+    if (dirtyCount == 0)
+        return;
+
+    // a level needs only the worlds of the level above it, which are all final by then; levels above the
+    // first dirty one are skipped, the pass stops at a level without changes once no dirty nodes are left
+    size_t level = firstDirtyLevel;
+    size_t dirtyLeft = dirtyCount;
+    for (; level + 1 < levelStarts.size(); ++level) {
+        size_t first = levelStarts[level];
+        std::atomic<size_t> levelRecomputed(0), levelDirty(0);
+        auto process = [&](size_t begin, size_t end) {
+            size_t chunkRecomputed = 0, chunkDirty = 0;
+            for (size_t slot = first + begin; slot < first + end; ++slot) {
+                size_t parent = parentSlots[slot];
+                if (!dirty[slot] && (parent == NoNode || !recomputed[parent]))
+                    continue;
+                worlds[slot] = (parent == NoNode) ? locals[slot] : worlds[parent] * locals[slot];
+                chunkDirty += dirty[slot];
+                dirty[slot] = 0;
+                recomputed[slot] = 1;
+                ++chunkRecomputed;
+            }
+            levelRecomputed += chunkRecomputed;
+            levelDirty += chunkDirty;
+        };
+        ParallelFor(levelStarts[level + 1] - first, threadsCount, 4096, process);
+        dirtyLeft -= levelDirty;
+        if (levelRecomputed == 0 && dirtyLeft == 0)
+            break;
+    }
+
+    // the flags are cleared for the next pass, which may start at a deeper level
+    size_t last = levelStarts[std::min(level + 1, levelStarts.size() - 1)];
+    for (size_t slot = levelStarts[firstDirtyLevel]; slot < last; ++slot) {
+        if (recomputed[slot]) {
+            changed.push_back(ids[slot]);
+            recomputed[slot] = 0;
+        }
+    }
+    dirtyCount = 0;
+    firstDirtyLevel = levelStarts.size();
+}
+
+void TransformHierarchy::Reorder()
+{
+    orderOutdated = false;
+    size_t count = parents.size();
+
+    // depth of every node, each chain is walked up to the first node with a known depth
+    std::vector<size_t> depths(count, NoNode);
+    std::vector<size_t> chain;
+    size_t levelsCount = 0;
+    for (size_t node = 0; node < count; ++node) {
+        size_t ancestor = node;
+        while (ancestor != NoNode && depths[ancestor] == NoNode) {
+            chain.push_back(ancestor);
+            ancestor = parents[ancestor];
+        }
+        size_t depth = (ancestor == NoNode) ? 0 : depths[ancestor] + 1;
+        while (!chain.empty()) {
+            depths[chain.back()] = depth++;
+            chain.pop_back();
+        }
+        levelsCount = std::max(levelsCount, depths[node] + 1);
+    }
+
+    // counting sort by depth, nodes of a level keep their previous order
+    levelStarts.assign(levelsCount + 1, 0);
+    for (size_t node = 0; node < count; ++node)
+        ++levelStarts[depths[node] + 1];
+    for (size_t level = 1; level < levelStarts.size(); ++level)
+        levelStarts[level] += levelStarts[level - 1];
+
+    std::vector<size_t> levelFill(levelStarts.begin(), levelStarts.end() - 1);
+    std::vector<size_t> orderedIds(count);
+    std::vector<size_t> newSlots(count);
+    std::vector<glm::mat4> orderedLocals(count), orderedWorlds(count);
+    std::vector<uint8_t> orderedDirty(count);
+    for (size_t slot = 0; slot < count; ++slot) {
+        size_t node = ids[slot];
+        size_t newSlot = levelFill[depths[node]]++;
+        orderedIds[newSlot] = node;
+        newSlots[node] = newSlot;
+        orderedLocals[newSlot] = locals[slot];
+        orderedWorlds[newSlot] = worlds[slot];
+        orderedDirty[newSlot] = dirty[slot];
+    }
+    ids.swap(orderedIds);
+    slots.swap(newSlots);
+    locals.swap(orderedLocals);
+    worlds.swap(orderedWorlds);
+    dirty.swap(orderedDirty);
+    recomputed.assign(count, 0);
+    firstDirtyLevel = 0;
+    for (size_t slot = 0; slot < count; ++slot) {
+        size_t parent = parents[ids[slot]];
+        parentSlots[slot] = (parent == NoNode) ? NoNode : slots[parent];
+    }
+}
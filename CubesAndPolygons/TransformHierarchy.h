@@ -0,0 +1,58 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// Group nodes of the scene hierarchy, every node has a transform relative to its parent.
+// World transforms are computed level by level from the roots, a level reads only the finished
+// level above it, so its nodes are processed in parallel. Nodes are kept in level order with
+// parents before children, so the pass walks the arrays forward; only nodes changed since the
+// last pass and their subtrees are recomputed.
+class TransformHierarchy
+{
+public:
+    static const size_t NoNode = size_t(-1);
+
+    // parent - NoNode for a root, returns the id of the node
+    size_t AddNode(size_t parent, const glm::mat4& local = glm::mat4(1.0f));
+    // The local transform is kept, so the subtree moves with the new parent
+    void SetParent(size_t node, size_t parent);
+    size_t GetParent(size_t node) const;
+    size_t GetRoot(size_t node) const;
+    size_t GetNodesCount() const { return parents.size(); }
+
+    void SetLocalTransform(size_t node, const glm::mat4& local);
+    const glm::mat4& GetLocalTransform(size_t node) const;
+    // as of the last Update()
+    const glm::mat4& GetWorldTransform(size_t node) const;
+
+    bool IsOutdated() const { return dirtyCount > 0 || orderOutdated; }
+    // Recomputes the world transforms of the changed nodes and their subtrees, appends the ids
+    // of the nodes whose world transform changed; threadsCount == 0 means one per hardware core
+    void Update(std::vector<size_t>& changed, unsigned threadsCount = 0);
+
+private:
+    // Sorts the nodes by their depth after nodes were added or moved to other parents
+    void Reorder();
+
+    // by id
+    std::vector<size_t> parents;
+    std::vector<size_t> slots;
+
+    // by slot in level order
+    std::vector<size_t> ids;
+    std::vector<size_t> parentSlots;
+    std::vector<glm::mat4> locals;
+    std::vector<glm::mat4> worlds;
+    // written from several threads, so not a vector<bool>; recomputed is set only during Update
+    std::vector<uint8_t> dirty;
+    std::vector<uint8_t> recomputed;
+    // slots of level l are levelStarts[l] .. levelStarts[l + 1]
+    std::vector<size_t> levelStarts;
+    size_t dirtyCount = 0;
+    // no level above it has dirty nodes
+    size_t firstDirtyLevel = 0;
+    bool orderOutdated = false;
+};
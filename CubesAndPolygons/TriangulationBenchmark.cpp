@@ -0,0 +1,124 @@
+#include "TriangulationBenchmark.h"
+#include "Polygon2D.h"
+#include "TriangulationVisitor.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace
+{
+    enum Workload
+    {
+        WorkloadSmall,
+        WorkloadConvex,
+        WorkloadMonotone,
+        WorkloadStar,
+        WorkloadMixed,
+        WorkloadsCount
+    };
+
+    const char* WorkloadNames[WorkloadsCount] = { "triangles and quads", "convex", "monotone", "star", "mixed" };
+
+    // outline around the origin with the given radius function, counter-clockwise
+    template <typename Radius>
+    std::vector<glm::vec2> MakeOutline(size_t pointsCount, Radius radius)
+    {
+        std::vector<glm::vec2> points;
+        for (size_t i = 0; i < pointsCount; ++i) {
+            float angle = 6.2831853f * i / pointsCount;
+            float r = radius(i);
+            points.push_back(glm::vec2(r * std::cos(angle), r * std::sin(angle)));
+        }
+        return points;
+    }
+
+    std::vector<glm::vec2> MakePolygon(Workload workload, std::mt19937& random)
+    {
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        if (workload == WorkloadMixed) {
+            // shares of our scenes: mostly small and convex, few general outlines
+            float share = unit(random);
+            workload = share < 0.4f ? WorkloadSmall : share < 0.7f ? WorkloadConvex : share < 0.9f ? WorkloadMonotone : WorkloadStar;
+        }
+
+        switch (workload) {
+        case WorkloadSmall:
+            return MakeOutline(3 + random() % 2, [](size_t) { return 0.1f; });
+        case WorkloadConvex:
+            return MakeOutline(5 + random() % 60, [](size_t) { return 0.1f; });
+        case WorkloadMonotone: {
+            // x rises along the bottom and falls along the top, heights are random
+            size_t half = 4 + random() % 30;
+            std::vector<glm::vec2> points;
+            for (size_t i = 0; i <= half; ++i)
+                points.push_back(glm::vec2(0.01f * i, -0.1f * unit(random) - (i > 0 && i < half ? 0.01f : 0.0f)));
+            for (size_t i = half; i-- > 1;)
+                points.push_back(glm::vec2(0.01f * i + 0.005f, 0.1f * unit(random) + 0.01f));
+            return points;
+        }
+        default:
+            return MakeOutline(8 + random() % 40, [&](size_t i) { return (i % 2) ? 0.05f + 0.05f * unit(random) : 0.1f; });
+        }
+    }
+
+    double Triangulate(const std::vector<std::shared_ptr<Polygon2D>>& polygons, bool fastPaths, bool exactPredicates, size_t counts[])
+    {
+        std::vector<GLfloat> buffer;
+        TriangulationVisitor::TakePolygonCounters(counts);
+        auto startTime = std::chrono::steady_clock::now();
+        for (const std::shared_ptr<Polygon2D>& polygon : polygons) {
+            buffer.resize(polygon->GetTrianglesCount() * 3 * 3);
+            TriangulationVisitor triangulation(buffer, 0);
+            triangulation.SetFastPaths(fastPaths);
+            triangulation.SetExactPredicates(exactPredicates);
+            polygon->Accept(&triangulation);
+        }
+        auto endTime = std::chrono::steady_clock::now();
+        TriangulationVisitor::TakePolygonCounters(counts);
+        return std::chrono::duration<double, std::milli>(endTime - startTime).count();
+    }
+
+    // polygons triangulated differently with the float cross product than with the robust predicates
+    size_t CountPredicateDifferences(const std::vector<std::shared_ptr<Polygon2D>>& polygons)
+    {
+        size_t differences = 0;
+        std::vector<size_t> exact, plain;
+        for (const std::shared_ptr<Polygon2D>& polygon : polygons) {
+            TriangulationVisitor::TriangulatePolygon(polygon->points, exact);
+            TriangulationVisitor::TriangulatePolygon(polygon->points, plain, true, false);
+            differences += exact != plain;
+        }
+        return differences;
+    }
+}
+
+void TriangulationBenchmark::Run(size_t polygonsCount)
+{
+    std::mt19937 random(1);
+    for (int workload = 0; workload < WorkloadsCount; ++workload) {
+        std::vector<std::shared_ptr<Polygon2D>> polygons;
+        size_t trianglesCount = 0;
+        for (size_t i = 0; i < polygonsCount; ++i) {
+            std::vector<glm::vec2> points = MakePolygon(static_cast<Workload>(workload), random);
+            polygons.push_back(std::make_shared<Polygon2D>(points));
+            trianglesCount += polygons.back()->GetTrianglesCount();
+        }
+
+        size_t counts[TriangulationVisitor::PolygonClassesCount];
+        double plainTime = Triangulate(polygons, true, false, counts);
+        double generalTime = Triangulate(polygons, false, true, counts);
+        double fastTime = Triangulate(polygons, true, true, counts);
+        std::cout << WorkloadNames[workload] << ": " << polygonsCount << " polygons, " << trianglesCount << " triangles, "
+            << counts[TriangulationVisitor::PolygonConvex] << " convex, "
+            << counts[TriangulationVisitor::PolygonMonotone] << " monotone, "
+            << counts[TriangulationVisitor::PolygonGeneral] << " general; "
+            << "ear clipping " << generalTime << " ms, with fast paths " << fastTime << " ms ("
+            << generalTime / std::max(fastTime, 1e-6) << "x); float cross products in place of the robust predicates "
+            << plainTime << " ms, " << CountPredicateDifferences(polygons) << " polygons triangulated differently" << std::endl;
+    }
+}
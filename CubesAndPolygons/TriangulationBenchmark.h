@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstddef>
+
+// Times polygon triangulation on generated workloads: triangles and quads, convex outlines,
+// monotone outlines, star shaped outlines and a mix of all, with the convex and monotone
+// fast paths, with the general ear clipper only and with the float cross product in place
+// of the robust predicates, which also counts the polygons it triangulates differently
+class TriangulationBenchmark
+{
+public:
+    static void Run(size_t polygonsCount = 100000);
+};
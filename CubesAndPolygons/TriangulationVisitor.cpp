@@ -1,72 +1,201 @@
 #include "TriangulationVisitor.h"
 #include "Cube.h"
 #include "Polygon2D.h"
+#include "Predicates.h"
+
+#include <algorithm>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-static int isVertexInsideNewPoly(int n, const std::vector<glm::vec2> &p)
-{
-    glm::vec2 v = p[n];
-    std::vector<glm::vec2> a;
+std::atomic<size_t> TriangulationVisitor::polygonCounters[TriangulationVisitor::PolygonClassesCount];
 
-    for (size_t i = 0; i < p.size(); i++)
-        if (i != n)
-            a.push_back(p[i]);
+namespace
+{
+    struct ExactPredicate
+    {
+        static double Orient(const glm::vec2& a, const glm::vec2& b, const glm::vec2& c)
+        {
+            return Predicates::Orient2D(a, b, c);
+        }
 
-    int c = 1;
+        static bool InTriangle(const glm::vec2& a, const glm::vec2& b, const glm::vec2& c, const glm::vec2& p, int orientation)
+        {
+            return Predicates::InTriangle(a, b, c, p, orientation);
+        }
+    };
 
-    for (size_t i = 0, j = a.size() - 1; i < a.size(); j = i++) 
+    // The float cross product of the original ear test, its sign is wrong when the rounding error is larger than the result
+    struct CrossPredicate
     {
-        if ((((a[i].y <= v.y) && (v.y < a[j].y)) || ((a[j].y <= v.y) && (v.y < a[i].y))) && (v.x > (a[j].x - a[i].x) * (v.y - a[i].y) / (a[j].y - a[i].y) + a[i].x))
-            c = !c;
-    }
+        static double Orient(const glm::vec2& o, const glm::vec2& a, const glm::vec2& b)
+        {
+            return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+        }
 
-    return c;
+        static bool InTriangle(const glm::vec2& a, const glm::vec2& b, const glm::vec2& c, const glm::vec2& p, int orientation)
+        {
+            if (p.x < std::min(a.x, std::min(b.x, c.x)) || p.x > std::max(a.x, std::max(b.x, c.x)) ||
+                p.y < std::min(a.y, std::min(b.y, c.y)) || p.y > std::max(a.y, std::max(b.y, c.y)))
+                return false;
+            return Orient(a, b, p) * orientation >= 0.0 && Orient(b, c, p) * orientation >= 0.0 && Orient(c, a, p) * orientation >= 0.0;
+        }
+    };
 }
 
-static int isEdgeIntersect(int n, const std::vector<glm::vec2> &p)
+// Direction changes of a coordinate around the ring, 2 for a monotone outline. Equal neighbours
+// do not change the direction, strict is cleared if there are any.
+static int CountDirectionChanges(const std::vector<glm::vec2>& p, int axis, bool& strict)
 {
-    glm::vec2 v = p[n];
-    std::vector<glm::vec2> a;
-
-    for (size_t i = 0; i < p.size(); i++)
-        if (i != n)
-            a.push_back(p[i]);
-
-    int c = 0, cnt = a.size(), prev = (cnt + (n - 1)) % cnt, next = n % cnt;
-
-    glm::vec2 v1 = a[prev], v2 = a[next];
-
-    for (size_t i = 0, j = cnt - 1; i < cnt; j = i++)
-    {
-        if (prev == i || prev == j || next == i || next == j)
+    int changes = 0;
+    int firstSign = 0, lastSign = 0;
+    strict = true;
+    for (size_t i = 0; i < p.size(); ++i) {
+        float delta = p[(i + 1) % p.size()][axis] - p[i][axis];
+        if (delta == 0.0f) {
+            strict = false;
             continue;
+        }
+        int sign = delta > 0.0f ? 1 : -1;
+        if (lastSign != 0 && sign != lastSign)
+            ++changes;
+        if (firstSign == 0)
+            firstSign = sign;
+        lastSign = sign;
+    }
+    return changes + (lastSign != firstSign ? 1 : 0);
+}
 
-        glm::vec2 v4 = a[j], v3 = a[i];
+// One pass over the outline: convex if all turns have the same sign and it winds once
+// (x changes direction twice at most, which rules out stars), monotone if a coordinate
+// strictly rises along one chain and falls along the other
+template <typename Predicate>
+TriangulationVisitor::PolygonClass TriangulationVisitor::ClassifyPolygon(const std::vector<glm::vec2>& p, int& monotoneAxis)
+{
+    if (p.size() <= 3)
+        return PolygonConvex;
+
+    int turnSign = 0;
+    bool convex = true;
+    for (size_t i = 0; i < p.size() && convex; ++i) {
+        double turn = Predicate::Orient(p[i], p[(i + 1) % p.size()], p[(i + 2) % p.size()]);
+        int sign = (turn > 0.0) - (turn < 0.0);
+        if (sign != 0 && turnSign != 0 && sign != turnSign)
+            convex = false;
+        if (sign != 0)
+            turnSign = sign;
+    }
 
-        float denominator = ((v4.y - v3.y) * (v2.x - v1.x)) - ((v4.x - v3.x) * (v2.y - v1.y));
+    bool strict[2];
+    int changes[2] = { CountDirectionChanges(p, 0, strict[0]), CountDirectionChanges(p, 1, strict[1]) };
+    if (convex && turnSign != 0 && changes[0] <= 2 && changes[1] <= 2)
+        return PolygonConvex;
 
-        if (!denominator)
-            continue;
+    // the chains are merged by the coordinate, so it must not repeat along a chain
+    for (int axis = 0; axis < 2; ++axis) {
+        if (changes[axis] == 2 && strict[axis]) {
+            monotoneAxis = axis;
+            return PolygonMonotone;
+        }
+    }
+    return PolygonGeneral;
+}
 
-        float ua = (((v4.x - v3.x) * (v1.y - v3.y)) - ((v4.y - v3.y) * (v1.x - v3.x))) / denominator;
-        float ub = (((v2.x - v1.x) * (v1.y - v3.y)) - ((v2.y - v1.y) * (v1.x - v3.x))) / denominator;
+// Stack based triangulation of an x-monotone outline, triangles as point indices
+template <typename Predicate>
+void TriangulationVisitor::TriangulateMonotone(const std::vector<glm::vec2>& p, std::vector<size_t>& triangles)
+{
+    size_t count = p.size();
+    size_t left = 0, right = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (p[i].x < p[left].x)
+            left = i;
+        if (p[i].x > p[right].x)
+            right = i;
+    }
 
-        if (ua >= 0 && ua <= 1 && ub >= 0 && ub <= 1)
-        {
-            c = 1;
-            break;
+    // going forward from the leftmost point walks the lower chain of a counter-clockwise outline
+    const int Upper = 1, Lower = -1;
+    int forwardChain = FindOrientation<Predicate>(p) > 0 ? Lower : Upper;
+
+    // merge both chains by x, the ends belong to both
+    std::vector<std::pair<size_t, int>> sorted;
+    sorted.reserve(count);
+    sorted.push_back({ left, 0 });
+    size_t forward = (left + 1) % count;
+    size_t backward = (left + count - 1) % count;
+    while (forward != right || backward != right) {
+        bool takeForward = backward == right || (forward != right && p[forward].x <= p[backward].x);
+        if (takeForward) {
+            sorted.push_back({ forward, forwardChain });
+            forward = (forward + 1) % count;
+        }
+        else {
+            sorted.push_back({ backward, -forwardChain });
+            backward = (backward + count - 1) % count;
+        }
+    }
+    sorted.push_back({ right, 0 });
+
+    auto addTriangle = [&](size_t a, size_t b, size_t c) {
+        triangles.push_back(a);
+        triangles.push_back(b);
+        triangles.push_back(c);
+    };
+
+    std::vector<std::pair<size_t, int>> stack = { sorted[0], sorted[1] };
+    for (size_t j = 2; j + 1 < sorted.size(); ++j) {
+        const std::pair<size_t, int>& current = sorted[j];
+        if (current.second != stack.back().second) {
+            // every stack vertex sees the current one across the polygon
+            for (size_t k = 0; k + 1 < stack.size(); ++k)
+                addTriangle(current.first, stack[k].first, stack[k + 1].first);
+            std::pair<size_t, int> previous = stack.back();
+            stack.assign({ previous, current });
+        }
+        else {
+            std::pair<size_t, int> last = stack.back();
+            stack.pop_back();
+            // cut ears while the diagonal to the stack top lies inside, the middle vertex is then convex
+            while (!stack.empty() &&
+                Predicate::Orient(p[stack.back().first], p[current.first], p[last.first]) * current.second > 0.0) {
+                addTriangle(current.first, last.first, stack.back().first);
+                last = stack.back();
+                stack.pop_back();
+            }
+            stack.push_back(last);
+            stack.push_back(current);
         }
     }
 
-    return c;
+    size_t end = sorted.back().first;
+    for (size_t k = 0; k + 1 < stack.size(); ++k)
+        addTriangle(end, stack[k].first, stack[k + 1].first);
 }
 
-static int isVertexEar(int n, const std::vector<glm::vec2> &p)
+uint32_t TriangulationVisitor::GetAlgorithmHash()
 {
-    return (isVertexInsideNewPoly(n, p) && !isEdgeIntersect(n, p));
+    static const uint32_t hash = []() {
+        std::vector<glm::vec2> points = { glm::vec2(0.0, -0.4), glm::vec2(0.1, 0.2), glm::vec2(-0.1, -0.2), glm::vec2(-0.2, -0.2),
+            glm::vec2(0.3, 0.1), glm::vec2(0.2, 0.3) };
+        Polygon2D polygon(points);
+        Cube cube(glm::vec3(0.0), 0.3, glm::vec3(1.0, 0.5, -1.0), glm::vec3(0.0, 0.2, 0.0));
+
+        std::vector<GLfloat> reference((polygon.GetTrianglesCount() + cube.GetTrianglesCount()) * 3 * 3);
+        TriangulationVisitor triangulation(reference, 0);
+        polygon.Accept(&triangulation);
+        cube.Accept(&triangulation);
+
+        // FNV-1a
+        uint32_t value = 2166136261u ^ Version;
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(reference.data());
+        for (size_t i = 0; i < reference.size() * sizeof(GLfloat); ++i)
+            value = (value ^ bytes[i]) * 16777619u;
+        return value;
+    }();
+
+    return hash;
 }
 
 void TriangulationVisitor::VisitCube(const Cube* cube)
@@ -76,65 +205,156 @@ void TriangulationVisitor::VisitCube(const Cube* cube)
         cube->auxilaryAxis.length() < precision)
         return;
 
-    glm::vec3 axis1 = cube->mainAxis;
-    glm::vec3 axis2 = glm::cross(axis1, cube->auxilaryAxis);
-    glm::vec3 axis3 = glm::cross(axis1, axis2);
-
-    std::vector<glm::vec3> points(8);
-
-    double half_edge = cube->edgeLength / 2.0;
-    axis1 = glm::normalize(axis1);
-    axis1 *= half_edge;
-    axis2 = glm::normalize(axis2);
-    axis2 *= half_edge;
-    axis3 = glm::normalize(axis3);
-    axis3 *= half_edge;
-
-    glm::vec3 origin(0.0, 0.0, 0.0);
-    points[0] = origin + axis1 + axis2 + axis3;
-    points[1] = origin + axis1 + axis2 - axis3;
-    points[2] = origin + axis1 - axis2 + axis3;
-    points[3] = origin + axis1 - axis2 - axis3;
-    points[4] = origin - axis1 + axis2 + axis3;
-    points[5] = origin - axis1 + axis2 - axis3;
-    points[6] = origin - axis1 - axis2 + axis3;
-    points[7] = origin - axis1 - axis2 - axis3;
-
-    AddRectangleToBuffer(points[0], points[1], points[2], points[3]);
-    AddRectangleToBuffer(points[1], points[5], points[3], points[7]);
-    AddRectangleToBuffer(points[5], points[4], points[7], points[6]);
-    AddRectangleToBuffer(points[4], points[0], points[6], points[2]);
-    AddRectangleToBuffer(points[0], points[4], points[1], points[5]);
-    AddRectangleToBuffer(points[6], points[2], points[7], points[3]);
+    std::vector<glm::vec3> points;
+    cube->GetVertices(points);
+
+    AddFaceToBuffer(points[0], points[1], points[2], points[3]);
+    AddFaceToBuffer(points[1], points[5], points[3], points[7]);
+    AddFaceToBuffer(points[5], points[4], points[7], points[6]);
+    AddFaceToBuffer(points[4], points[0], points[6], points[2]);
+    AddFaceToBuffer(points[0], points[4], points[1], points[5]);
+    AddFaceToBuffer(points[6], points[2], points[7], points[3]);
 }
 
 void TriangulationVisitor::VisitPolygon2D(const Polygon2D* polygon)
 {
-    std::vector<glm::vec2> vertices = polygon->points;
+    const std::vector<glm::vec2>& points = polygon->points;
+    std::vector<size_t> triangles;
+    PolygonClass polygonClass = TriangulatePolygon(points, triangles, fastPaths, exactPredicates);
+    polygonCounters[polygonClass].fetch_add(1, std::memory_order_relaxed);
 
-    for (size_t t = vertices.size() - 1, i = 0, j = 1; i < vertices.size(); t = i++, j = (i + 1) % vertices.size())
-    {
-        if (vertices.size() == 3)
-        {
-            AddVertexToBuffer(glm::vec3(vertices[0], 0.0));
-            AddVertexToBuffer(glm::vec3(vertices[1], 0.0));
-            AddVertexToBuffer(glm::vec3(vertices[2], 0.0));
-            break;
-        }
+    for (size_t index : triangles)
+        AddVertexToBuffer(glm::vec3(points[index], 0.0));
+}
 
-        if (isVertexEar(i, vertices))
-        {
-            AddVertexToBuffer(glm::vec3(vertices[t], 0.0));
-            AddVertexToBuffer(glm::vec3(vertices[i], 0.0));
-            AddVertexToBuffer(glm::vec3(vertices[j], 0.0));
+TriangulationVisitor::PolygonClass TriangulationVisitor::TriangulatePolygon(const std::vector<glm::vec2>& points,
+    std::vector<size_t>& triangles, bool fastPaths, bool exactPredicates)
+{
+    return exactPredicates ? Triangulate<ExactPredicate>(points, triangles, fastPaths)
+        : Triangulate<CrossPredicate>(points, triangles, fastPaths);
+}
+
+template <typename Predicate>
+TriangulationVisitor::PolygonClass TriangulationVisitor::Triangulate(const std::vector<glm::vec2>& points,
+    std::vector<size_t>& triangles, bool fastPaths)
+{
+    triangles.clear();
+    triangles.reserve(points.size() < 3 ? 0 : (points.size() - 2) * 3);
+    int monotoneAxis = -1;
+    PolygonClass polygonClass = fastPaths ? ClassifyPolygon<Predicate>(points, monotoneAxis) : PolygonGeneral;
+
+    if (polygonClass == PolygonConvex) {
+        TriangulateFan(points, triangles);
+    }
+    else if (polygonClass == PolygonMonotone && monotoneAxis == 1) {
+        // the algorithm works on x, y monotone outlines are swapped
+        std::vector<glm::vec2> swapped;
+        swapped.reserve(points.size());
+        for (const glm::vec2& point : points)
+            swapped.push_back(glm::vec2(point.y, point.x));
+        TriangulateMonotone<Predicate>(swapped, triangles);
+    }
+    else if (polygonClass == PolygonMonotone) {
+        TriangulateMonotone<Predicate>(points, triangles);
+    }
+    else {
+        TriangulateEars<Predicate>(points, triangles);
+    }
+    return polygonClass;
+}
 
-            vertices.erase(vertices.begin() + i, vertices.begin() + i + 1);
+void TriangulationVisitor::TakePolygonCounters(size_t counts[PolygonClassesCount])
+{
+    for (int i = 0; i < PolygonClassesCount; ++i)
+        counts[i] = polygonCounters[i].exchange(0, std::memory_order_relaxed);
+}
 
-            t = vertices.size() - 1;
-            i = 0;
-            j = 1;
+void TriangulationVisitor::TriangulateFan(const std::vector<glm::vec2>& points, std::vector<size_t>& triangles)
+{
+    for (size_t i = 1; i + 1 < points.size(); ++i) {
+        triangles.push_back(0);
+        triangles.push_back(i);
+        triangles.push_back(i + 1);
+    }
+}
+
+template <typename Predicate>
+void TriangulationVisitor::TriangulateEars(const std::vector<glm::vec2>& points, std::vector<size_t>& triangles)
+{
+    // remaining outline as a linked ring
+    size_t count = points.size();
+    std::vector<size_t> previous(count), next(count);
+    for (size_t i = 0; i < count; ++i) {
+        previous[i] = (i + count - 1) % count;
+        next[i] = (i + 1) % count;
+    }
+    int orientation = FindOrientation<Predicate>(points);
+
+    auto addTriangle = [&](size_t a, size_t b, size_t c) {
+        triangles.push_back(a);
+        triangles.push_back(b);
+        triangles.push_back(c);
+    };
+
+    // a convex corner is an ear if no other remaining vertex is in its closed triangle;
+    // a collinear corner is cut off as a zero area triangle
+    auto isEar = [&](size_t corner) {
+        size_t a = previous[corner], c = next[corner];
+        double turn = Predicate::Orient(points[a], points[corner], points[c]) * orientation;
+        if (turn < 0.0)
+            return false;
+        if (turn == 0.0)
+            return true;
+        for (size_t v = next[c]; v != a; v = next[v]) {
+            const glm::vec2& point = points[v];
+            if (point == points[a] || point == points[corner] || point == points[c])
+                continue;
+            if (Predicate::InTriangle(points[a], points[corner], points[c], point, orientation))
+                return false;
+        }
+        return true;
+    };
+
+    size_t remaining = count;
+    size_t corner = 0;
+    size_t tested = 0;
+    while (remaining > 3) {
+        // a lap without an ear means the outline intersects itself, the corner is cut anyway
+        // so the triangle count is always complete
+        if (isEar(corner) || tested >= remaining) {
+            size_t a = previous[corner], c = next[corner];
+            addTriangle(a, corner, c);
+            next[a] = c;
+            previous[c] = a;
+            --remaining;
+            tested = 0;
+            // the neighbours may have become ears
+            corner = a;
+        }
+        else {
+            corner = next[corner];
+            ++tested;
         }
     }
+    addTriangle(previous[corner], corner, next[corner]);
+}
+
+int TriangulationVisitor::GetOrientation(const std::vector<glm::vec2>& points)
+{
+    return FindOrientation<ExactPredicate>(points);
+}
+
+// Orientation at the lowest leftmost vertex, which is convex, 1 for counter-clockwise
+template <typename Predicate>
+int TriangulationVisitor::FindOrientation(const std::vector<glm::vec2>& p)
+{
+    size_t lowest = 0;
+    for (size_t i = 1; i < p.size(); ++i) {
+        if (p[i].x < p[lowest].x || (p[i].x == p[lowest].x && p[i].y < p[lowest].y))
+            lowest = i;
+    }
+    double turn = Predicate::Orient(p[(lowest + p.size() - 1) % p.size()], p[lowest], p[(lowest + 1) % p.size()]);
+    return turn < 0.0 ? -1 : 1;
 }
 
 void TriangulationVisitor::AddVertexToBuffer(const glm::vec3& point)
@@ -161,4 +381,15 @@ void TriangulationVisitor::AddRectangleToBuffer(
     AddVertexToBuffer(p3);
     AddVertexToBuffer(p2);
     AddVertexToBuffer(p4);
+}
+
+void TriangulationVisitor::AddFaceToBuffer(
+    const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, const glm::vec3& p4)
+{
+    // p1 and p4 are opposite corners of the rectangle
+    glm::vec3 normal = glm::cross(p2 - p1, p3 - p1);
+    if (glm::dot(normal, p1 + p4) >= 0.0f)
+        AddRectangleToBuffer(p1, p2, p3, p4);
+    else
+        AddRectangleToBuffer(p1, p3, p2, p4);
 }
\ No newline at end of file
@@ -1,10 +1,12 @@
 #pragma once
 #include "Visitor.h"
 
+#include <atomic>
+#include <cstdint>
 #include <vector>
 
 #include <GL/glew.h>
-#include <glm/detail/type_vec.hpp>
+#include <glm/glm.hpp>
 
 class TriangulationVisitor : public Visitor
 {
@@ -12,14 +14,60 @@ public:
     TriangulationVisitor(std::vector<GLfloat>& iBuffer, size_t iIndex) : buffer(iBuffer), index(iIndex) {}
 
     void VisitCube(const Cube *cube) override;
+    // Convex outlines are fanned and monotone ones triangulated along their chains in O(n),
+    // only the rest goes to the general ear clipper
     void VisitPolygon2D(const Polygon2D* polygon) override;
 
+    // false sends every polygon to the ear clipper, for comparisons
+    void SetFastPaths(bool enabled) { fastPaths = enabled; }
+    // false replaces the robust predicates with the plain cross product used before them, for comparisons
+    void SetExactPredicates(bool enabled) { exactPredicates = enabled; }
+
+    enum PolygonClass
+    {
+        PolygonConvex = 0,
+        PolygonMonotone = 1,
+        PolygonGeneral = 2,
+        PolygonClassesCount = 3
+    };
+    // Polygons of every class triangulated by all visitors since the last call
+    static void TakePolygonCounters(size_t counts[PolygonClassesCount]);
+
+    // Identifies the generated geometry, pre-triangulated data with another hash must be triangulated again.
+    // Combines Version with the output for reference shapes, so unversioned changes are detected as well.
+    static uint32_t GetAlgorithmHash();
+    static const uint32_t Version = 4;
+
+    // Triangles of the outline as point indices, 3 per triangle, the ones VisitPolygon2D writes
+    static PolygonClass TriangulatePolygon(const std::vector<glm::vec2>& points, std::vector<size_t>& triangles,
+        bool fastPaths = true, bool exactPredicates = true);
+    // 1 for a counter-clockwise outline, -1 for a clockwise one
+    static int GetOrientation(const std::vector<glm::vec2>& points);
+
 private:
+    // Predicate - Orient and InTriangle of the robust predicates or of the float cross product,
+    // chosen once per polygon
+    template <typename Predicate>
+    static PolygonClass Triangulate(const std::vector<glm::vec2>& points, std::vector<size_t>& triangles, bool fastPaths);
+    template <typename Predicate>
+    static PolygonClass ClassifyPolygon(const std::vector<glm::vec2>& points, int& monotoneAxis);
+    template <typename Predicate>
+    static void TriangulateMonotone(const std::vector<glm::vec2>& points, std::vector<size_t>& triangles);
+    static void TriangulateFan(const std::vector<glm::vec2>& points, std::vector<size_t>& triangles);
+    template <typename Predicate>
+    static void TriangulateEars(const std::vector<glm::vec2>& points, std::vector<size_t>& triangles);
+    template <typename Predicate>
+    static int FindOrientation(const std::vector<glm::vec2>& points);
     void AddVertexToBuffer(const glm::vec3& point);
     void AddTriangleToBuffer(const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3);
     void AddRectangleToBuffer(const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, const glm::vec3& p4);
+    // Face of a closed mesh around the origin, counter-clockwise when seen from outside
+    void AddFaceToBuffer(const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, const glm::vec3& p4);
 
     double precision = 1e-10;
+    bool fastPaths = true;
+    bool exactPredicates = true;
+    static std::atomic<size_t> polygonCounters[PolygonClassesCount];
     std::vector<GLfloat>& buffer;
     size_t index;
 };
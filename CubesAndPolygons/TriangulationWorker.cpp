@@ -0,0 +1,95 @@
+#include "TriangulationWorker.h"
+#include "TriangulationVisitor.h"
+
+TriangulationWorker::TriangulationWorker()
+{
+    thread = std::thread(&TriangulationWorker::Run, this);
+}
+
+TriangulationWorker::~TriangulationWorker()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopped = true;
+    }
+    condition.notify_all();
+    thread.join();
+}
+
+void TriangulationWorker::Add(size_t index, std::shared_ptr<Entity> entity, bool visible)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Task task = { index, entity };
+        if (visible)
+            visibleTasks.push_back(task);
+        else
+            hiddenTasks.push_back(task);
+    }
+    condition.notify_one();
+}
+
+void TriangulationWorker::Reprioritize(const std::function<bool(const Entity&)>& isVisible)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::deque<Task> tasks;
+    tasks.swap(visibleTasks);
+    tasks.insert(tasks.end(), hiddenTasks.begin(), hiddenTasks.end());
+    hiddenTasks.clear();
+
+    for (Task& task : tasks) {
+        if (isVisible(*task.entity))
+            visibleTasks.push_back(task);
+        else
+            hiddenTasks.push_back(task);
+    }
+}
+
+std::vector<TriangulationWorker::Result> TriangulationWorker::TakeResults()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<Result> taken;
+    taken.swap(results);
+    return taken;
+}
+
+bool TriangulationWorker::IsBusy() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return !visibleTasks.empty() || !hiddenTasks.empty() || tasksInProgress > 0 || !results.empty();
+}
+
+void TriangulationWorker::SetResultCallback(std::function<void()> callback)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    resultCallback = callback;
+}
+
+void TriangulationWorker::Run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        condition.wait(lock, [this]() { return stopped || !visibleTasks.empty() || !hiddenTasks.empty(); });
+        if (stopped)
+            return;
+
+        std::deque<Task>& tasks = visibleTasks.empty() ? hiddenTasks : visibleTasks;
+        Task task = tasks.front();
+        tasks.pop_front();
+        ++tasksInProgress;
+        lock.unlock();
+
+        Result result;
+        result.index = task.index;
+        result.vertices.resize(task.entity->GetTrianglesCount() * 3 * 3);
+        TriangulationVisitor triangulation(result.vertices, 0);
+        task.entity->Accept(&triangulation);
+        task.entity->BuildDetailLevels(result.detailLevels);
+
+        lock.lock();
+        --tasksInProgress;
+        results.push_back(std::move(result));
+        if (results.size() == 1 && resultCallback)
+            resultCallback();
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "Entity.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Triangulates entities and builds their detail levels on a background thread.
+// Entities marked visible are processed first, results are collected by the owner with TakeResults().
+class TriangulationWorker
+{
+public:
+    struct Result
+    {
+        size_t index;
+        std::vector<GLfloat> vertices;
+        std::vector<DetailLevel> detailLevels;
+    };
+
+    TriangulationWorker();
+    ~TriangulationWorker();
+
+    void Add(size_t index, std::shared_ptr<Entity> entity, bool visible);
+    // Splits the queued entities again, isVisible is called on the calling thread
+    void Reprioritize(const std::function<bool(const Entity&)>& isVisible);
+    std::vector<Result> TakeResults();
+    // true while there are queued entities or results not taken yet
+    bool IsBusy() const;
+    // Called on the worker thread when results become available after the last TakeResults()
+    void SetResultCallback(std::function<void()> callback);
+
+private:
+    struct Task
+    {
+        size_t index;
+        std::shared_ptr<Entity> entity;
+    };
+
+    void Run();
+
+    std::deque<Task> visibleTasks;
+    std::deque<Task> hiddenTasks;
+    std::vector<Result> results;
+    size_t tasksInProgress = 0;
+    std::function<void()> resultCallback;
+
+    mutable std::mutex mutex;
+    std::condition_variable condition;
+    bool stopped = false;
+    std::thread thread;
+};
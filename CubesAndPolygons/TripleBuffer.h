@@ -0,0 +1,39 @@
+#pragma once
+
+#include <atomic>
+
+// Lock-free single producer / single consumer triple buffer.
+// The producer fills GetWriteBuffer() and publishes it, the consumer always takes the latest
+// published buffer; neither side ever waits for the other and skipped buffers are reused.
+template <typename T>
+class TripleBuffer
+{
+public:
+    T& GetWriteBuffer() { return buffers[writeIndex]; }
+
+    void Publish()
+    {
+        writeIndex = middle.exchange(writeIndex | FreshBit) & IndexMask;
+    }
+
+    // Returns true if a buffer was published since the last call, GetReadBuffer() is that buffer then
+    bool Acquire()
+    {
+        if (!(middle.load() & FreshBit))
+            return false;
+        readIndex = middle.exchange(readIndex) & IndexMask;
+        return true;
+    }
+
+    const T& GetReadBuffer() const { return buffers[readIndex]; }
+
+private:
+    static const int IndexMask = 3;
+    static const int FreshBit = 4;
+
+    T buffers[3];
+    int writeIndex = 0;
+    int readIndex = 1;
+    // index of the buffer between the producer and the consumer, with FreshBit if it was not read yet
+    std::atomic<int> middle { 2 };
+};
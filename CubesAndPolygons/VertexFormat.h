@@ -0,0 +1,27 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <vector>
+
+// Vertex formats of the GPU buffers. Coordinates are 16-bit unsigned normalized values
+// within the entity bounds, the entity transform decodes them.
+enum VertexFormat
+{
+    VertexPlanar = 0, // x, y of entities with all vertices at z == 0
+    VertexSolid = 1,  // x, y, z and padding to 8 bytes
+    VertexFormatsCount = 2
+};
+
+// Components stored per vertex
+const int VertexComponents[VertexFormatsCount] = { 2, 4 };
+
+// Packed vertices of consecutive entities of one format, produced by Scene::TakeVertexUpdates
+struct VertexUpdate
+{
+    VertexFormat format;
+    // vertices of the format in the whole scene
+    size_t totalVertices;
+    size_t firstVertex;
+    std::vector<GLushort> data;
+};
@@ -0,0 +1,171 @@
+#include "VertexGrid.h"
+
+#include <algorithm>
+#include <cmath>
+
+void VertexGrid::Build(const std::vector<Vertex>& vertices, size_t entitiesCount)
+{
+    overlay.clear();
+    entityCells.clear();
+    overlayCount = 0;
+    verticesCount = vertices.size();
+    stale.assign(entitiesCount, false);
+    packedCounts.assign(entitiesCount, 0);
+
+    glm::vec2 minPoint(0.0f), maxPoint(0.0f);
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        minPoint = (i == 0) ? vertices[i].position : glm::min(minPoint, vertices[i].position);
+        maxPoint = (i == 0) ? vertices[i].position : glm::max(maxPoint, vertices[i].position);
+    }
+
+    // about two vertices per cell if they were spread evenly, clusters only make some cells fuller
+    glm::vec2 extent = glm::max(maxPoint - minPoint, glm::vec2(1e-6f));
+    cellSize = std::sqrt(extent.x * extent.y * 2.0f / std::max<size_t>(vertices.size(), 1));
+    cellSize = std::max(cellSize, std::max(extent.x, extent.y) / 4096.0f);
+    origin = minPoint;
+    dimensions = glm::ivec2(extent / cellSize) + glm::ivec2(1);
+
+    // counting sort by cell
+    cellStarts.assign(size_t(dimensions.x) * dimensions.y + 1, 0);
+    for (const Vertex& vertex : vertices) {
+        glm::ivec2 cell = GetCell(vertex.position);
+        ++cellStarts[size_t(cell.y) * dimensions.x + cell.x + 1];
+        ++packedCounts[vertex.entity];
+    }
+    for (size_t c = 1; c < cellStarts.size(); ++c)
+        cellStarts[c] += cellStarts[c - 1];
+
+    cellVertices.resize(vertices.size());
+    std::vector<uint32_t> cellFill(cellStarts.begin(), cellStarts.end() - 1);
+    for (const Vertex& vertex : vertices) {
+        glm::ivec2 cell = GetCell(vertex.position);
+        cellVertices[cellFill[size_t(cell.y) * dimensions.x + cell.x]++] = vertex;
+    }
+}
+
+void VertexGrid::Update(size_t entity, const std::vector<Vertex>& vertices)
+{
+    if (entity >= stale.size()) {
+        stale.resize(entity + 1, false);
+        packedCounts.resize(entity + 1, 0);
+    }
+    if (!stale[entity]) {
+        // the packed vertices stay in place and are skipped from now on
+        stale[entity] = true;
+        verticesCount -= packedCounts[entity];
+    }
+
+    std::vector<uint64_t>& cells = entityCells[entity];
+    for (uint64_t key : cells) {
+        auto found = overlay.find(key);
+        if (found == overlay.end())
+            continue;
+        std::vector<Vertex>& cellVertices = found->second;
+        size_t kept = 0;
+        for (size_t i = 0; i < cellVertices.size(); ++i) {
+            if (cellVertices[i].entity != entity)
+                cellVertices[kept++] = cellVertices[i];
+        }
+        overlayCount -= cellVertices.size() - kept;
+        verticesCount -= cellVertices.size() - kept;
+        cellVertices.resize(kept);
+        if (cellVertices.empty())
+            overlay.erase(found);
+    }
+
+    cells.clear();
+    for (const Vertex& vertex : vertices) {
+        uint64_t key = GetCellKey(GetCell(vertex.position));
+        std::vector<Vertex>& cellVertices = overlay[key];
+        if (cellVertices.empty() || cellVertices.back().entity != entity)
+            cells.push_back(key);
+        cellVertices.push_back(vertex);
+    }
+    // a cell is listed again if the entity comes back to it, repeated keys are harmless
+    overlayCount += vertices.size();
+    verticesCount += vertices.size();
+}
+
+bool VertexGrid::FindNearest(const glm::vec2& point, float radius, size_t excluded, Vertex& nearest) const
+{
+    float nearestDistance = radius * radius;
+    bool found = false;
+    VisitCells(point, radius, [&](const Vertex& vertex) {
+        if (vertex.entity == excluded)
+            return;
+        glm::vec2 offset = vertex.position - point;
+        float distance = glm::dot(offset, offset);
+        if (distance <= nearestDistance) {
+            nearestDistance = distance;
+            nearest = vertex;
+            found = true;
+        }
+    });
+    return found;
+}
+
+void VertexGrid::Query(const glm::vec2& point, float radius, std::vector<Vertex>& result) const
+{
+    VisitCells(point, radius, [&](const Vertex& vertex) {
+        glm::vec2 offset = vertex.position - point;
+        if (glm::dot(offset, offset) <= radius * radius)
+            result.push_back(vertex);
+    });
+}
+
+bool VertexGrid::IsOverlayLarge() const
+{
+    return overlayCount > 4096 && overlayCount * 4 > verticesCount;
+}
+
+glm::ivec2 VertexGrid::GetCell(const glm::vec2& point) const
+{
+    glm::vec2 cell = glm::floor((point - origin) / cellSize);
+    // far away points share the border cells of the packed grid, then the exact distance decides
+    return glm::ivec2(glm::clamp(cell, glm::vec2(-1e9f), glm::vec2(1e9f)));
+}
+
+uint64_t VertexGrid::GetCellKey(const glm::ivec2& cell)
+{
+    return (uint64_t(uint32_t(cell.x)) << 32) | uint32_t(cell.y);
+}
+
+template <typename Visit>
+void VertexGrid::VisitCells(const glm::vec2& point, float radius, Visit visit) const
+{
+    glm::ivec2 first = GetCell(point - glm::vec2(radius));
+    glm::ivec2 last = GetCell(point + glm::vec2(radius));
+
+    // packed cells, points outside of the grid were put in its border cells
+    glm::ivec2 packedFirst = glm::clamp(first, glm::ivec2(0), dimensions - glm::ivec2(1));
+    glm::ivec2 packedLast = glm::clamp(last, glm::ivec2(0), dimensions - glm::ivec2(1));
+    if (!cellVertices.empty() && first.x <= packedLast.x && last.x >= packedFirst.x && first.y <= packedLast.y && last.y >= packedFirst.y) {
+        for (int y = packedFirst.y; y <= packedLast.y; ++y) {
+            size_t row = size_t(y) * dimensions.x;
+            for (uint32_t i = cellStarts[row + packedFirst.x]; i < cellStarts[row + packedLast.x + 1]; ++i) {
+                if (!stale[cellVertices[i].entity])
+                    visit(cellVertices[i]);
+            }
+        }
+    }
+
+    if (overlay.empty())
+        return;
+    // a wide query goes over the overlay cells instead of the empty ones around them
+    if (uint64_t(int64_t(last.x) - first.x + 1) * uint64_t(int64_t(last.y) - first.y + 1) > overlay.size()) {
+        for (const std::pair<const uint64_t, std::vector<Vertex>>& cell : overlay) {
+            for (const Vertex& vertex : cell.second)
+                visit(vertex);
+        }
+        return;
+    }
+    for (int y = first.y; y <= last.y; ++y) {
+        for (int x = first.x; x <= last.x; ++x) {
+            auto found = overlay.find(GetCellKey(glm::ivec2(x, y)));
+            if (found == overlay.end())
+                continue;
+            for (const Vertex& vertex : found->second)
+                visit(vertex);
+        }
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Uniform grid over world space vertices of all entities, for nearest vertex and radius queries.
+// The bulk is a packed grid built at once with cells sized for a few vertices each. Entities
+// changed later are marked stale there and kept in a hashed overlay of the same cells, so a
+// moved entity costs only its own vertices; the owner rebuilds when the overlay gets large.
+class VertexGrid
+{
+public:
+    struct Vertex
+    {
+        glm::vec2 position;
+        uint32_t entity;
+        // of the vertex in Entity::GetVertices()
+        uint32_t index;
+    };
+
+    // Replaces everything, vertices of an entity are one after another
+    void Build(const std::vector<Vertex>& vertices, size_t entitiesCount);
+    // Replaces the vertices of one entity, the entity may be new
+    void Update(size_t entity, const std::vector<Vertex>& vertices);
+
+    // Nearest vertex of an entity other than excluded within the radius, false if there is none
+    bool FindNearest(const glm::vec2& point, float radius, size_t excluded, Vertex& nearest) const;
+    // Appends the vertices within the radius
+    void Query(const glm::vec2& point, float radius, std::vector<Vertex>& result) const;
+
+    size_t GetVerticesCount() const { return verticesCount; }
+    float GetCellSize() const { return cellSize; }
+    // true once the overlay holds a quarter of the vertices, queries slow down from then on
+    bool IsOverlayLarge() const;
+
+    static const size_t NoEntity = size_t(-1);
+
+private:
+    glm::ivec2 GetCell(const glm::vec2& point) const;
+    static uint64_t GetCellKey(const glm::ivec2& cell);
+    // Calls visit for the vertices in the cells overlapping the square around the point
+    template <typename Visit>
+    void VisitCells(const glm::vec2& point, float radius, Visit visit) const;
+
+    float cellSize = 1.0f;
+    glm::vec2 origin = glm::vec2(0.0);
+    glm::ivec2 dimensions = glm::ivec2(0);
+    // packed grid: vertices of cell c are cellVertices[cellStarts[c] .. cellStarts[c + 1])
+    std::vector<uint32_t> cellStarts;
+    std::vector<Vertex> cellVertices;
+    // entities whose vertices in the packed grid are outdated
+    std::vector<bool> stale;
+    // vertices of every entity in the packed grid
+    std::vector<uint32_t> packedCounts;
+
+    std::unordered_map<uint64_t, std::vector<Vertex>> overlay;
+    // overlay cells holding vertices of every entity
+    std::unordered_map<size_t, std::vector<uint64_t>> entityCells;
+    size_t overlayCount = 0;
+    size_t verticesCount = 0;
+};
@@ -0,0 +1,156 @@
+#include "VertexGridTest.h"
+#include "VertexGrid.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    const size_t EntityVertices = 8;
+
+    size_t Fail(size_t& failures, const std::string& message)
+    {
+        if (failures++ < 10)
+            std::cout << "vertex grid: " << message << std::endl;
+        return failures;
+    }
+
+    float GetDistance(const glm::vec2& a, const glm::vec2& b)
+    {
+        glm::vec2 offset = a - b;
+        return glm::dot(offset, offset);
+    }
+
+    // compares one query with a pass over all vertices; ties may pick any of the nearest vertices
+    void Check(const VertexGrid& grid, const std::vector<VertexGrid::Vertex>& vertices, const glm::vec2& point,
+        float radius, size_t excluded, size_t& failures)
+    {
+        float nearestDistance = radius * radius;
+        bool found = false;
+        size_t inside = 0;
+        for (const VertexGrid::Vertex& vertex : vertices) {
+            float distance = GetDistance(vertex.position, point);
+            inside += distance <= radius * radius ? 1 : 0;
+            if (vertex.entity != excluded && distance <= nearestDistance) {
+                nearestDistance = distance;
+                found = true;
+            }
+        }
+
+        std::string where = "query at (" + std::to_string(point.x) + ", " + std::to_string(point.y) + ")";
+        VertexGrid::Vertex nearest;
+        if (grid.FindNearest(point, radius, excluded, nearest) != found) {
+            Fail(failures, where + (found ? " missed a vertex" : " found a vertex out of the radius"));
+        }
+        else if (found) {
+            const VertexGrid::Vertex& current = vertices[nearest.entity * EntityVertices + nearest.index];
+            if (nearest.entity == excluded)
+                Fail(failures, where + " found the excluded entity " + std::to_string(excluded));
+            else if (current.position != nearest.position)
+                Fail(failures, where + " found an old position of entity " + std::to_string(nearest.entity));
+            else if (GetDistance(nearest.position, point) != nearestDistance)
+                Fail(failures, where + " found a vertex farther than the nearest one");
+        }
+
+        std::vector<VertexGrid::Vertex> result;
+        grid.Query(point, radius, result);
+        size_t current = 0;
+        for (const VertexGrid::Vertex& vertex : result)
+            current += vertices[vertex.entity * EntityVertices + vertex.index].position == vertex.position ? 1 : 0;
+        if (result.size() != inside || current != inside)
+            Fail(failures, where + " returned " + std::to_string(result.size()) + " vertices, " + std::to_string(current)
+                + " of them current, of " + std::to_string(inside) + " within the radius");
+    }
+}
+
+size_t VertexGridTest::Run(size_t entitiesCount, size_t queriesCount, size_t checksCount)
+{
+    // 8 vertices per entity, every other entity in a small cluster in the middle so cells fill unevenly
+    std::mt19937 random(3);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::normal_distribution<float> spread(0.0f, 0.01f);
+    std::vector<VertexGrid::Vertex> vertices;
+    for (size_t entity = 0; entity < entitiesCount; ++entity) {
+        glm::vec2 center(unit(random), unit(random));
+        if (entity % 2)
+            center *= 0.05f;
+        for (size_t i = 0; i < EntityVertices; ++i) {
+            VertexGrid::Vertex vertex = { center + glm::vec2(spread(random), spread(random)), uint32_t(entity), uint32_t(i) };
+            vertices.push_back(vertex);
+        }
+    }
+
+    VertexGrid grid;
+    auto startTime = std::chrono::steady_clock::now();
+    grid.Build(vertices, entitiesCount);
+    double buildTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+    // snap radii of a few pixels, half of the queries in the cluster; every few queries are checked afterwards
+    size_t failures = 0;
+    size_t checkEvery = std::max<size_t>(1, queriesCount / std::max<size_t>(checksCount, 1));
+    std::ostringstream report;
+    auto query = [&]() {
+        std::mt19937 queries(4);
+        size_t found = 0;
+        double totalTime = 0.0, slowestTime = 0.0;
+        for (size_t q = 0; q < queriesCount; ++q) {
+            glm::vec2 point(unit(queries) * 1.1f, unit(queries) * 1.1f);
+            if (q % 2)
+                point *= 0.05f;
+            float radius = 0.002f * (q % 5 + 1);
+            VertexGrid::Vertex nearest;
+            auto queryStart = std::chrono::steady_clock::now();
+            found += grid.FindNearest(point, radius, q % entitiesCount, nearest) ? 1 : 0;
+            double time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - queryStart).count();
+            totalTime += time;
+            slowestTime = std::max(slowestTime, time);
+            if (checksCount > 0 && q % checkEvery == 0)
+                Check(grid, vertices, point, radius, q % entitiesCount, failures);
+        }
+        report << found << " found, " << totalTime / queriesCount << " ms per nearest query, slowest " << slowestTime << " ms";
+    };
+
+    report << "vertex grid: " << vertices.size() << " vertices built in " << buildTime << " ms; ";
+    query();
+
+    // dragged entities go to the overlay, until the scene would rebuild the grid
+    size_t movesCount = 0;
+    double updateTime = 0.0;
+    std::vector<VertexGrid::Vertex> moved;
+    std::vector<glm::vec2> movedFrom, movedTo;
+    std::vector<size_t> movedEntities;
+    while (!grid.IsOverlayLarge() && movesCount < entitiesCount) {
+        size_t entity = random() % entitiesCount;
+        glm::vec2 offset(unit(random) * 0.3f, unit(random) * 0.3f);
+        moved.assign(vertices.begin() + entity * EntityVertices, vertices.begin() + (entity + 1) * EntityVertices);
+        if (movedFrom.size() < checksCount) {
+            movedFrom.push_back(moved[0].position);
+            movedTo.push_back(moved[0].position + offset);
+            movedEntities.push_back(entity);
+        }
+        for (VertexGrid::Vertex& vertex : moved)
+            vertex.position += offset;
+        std::copy(moved.begin(), moved.end(), vertices.begin() + entity * EntityVertices);
+        auto updateStart = std::chrono::steady_clock::now();
+        grid.Update(entity, moved);
+        updateTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - updateStart).count();
+        ++movesCount;
+    }
+    report << "; " << movesCount << " entity moves, " << updateTime / std::max<size_t>(movesCount, 1)
+        << " ms per move, then ";
+    query();
+
+    // queries where moved entities were and where they went, stale cells of the packed grid would show there;
+    // at the new place the moved entity itself is excluded, as when it snaps to others
+    for (size_t c = 0; c < movedFrom.size(); ++c) {
+        Check(grid, vertices, movedFrom[c], 0.004f, VertexGrid::NoEntity, failures);
+        Check(grid, vertices, movedTo[c], 0.004f, movedEntities[c], failures);
+    }
+    std::cout << report.str() << "; " << failures << " failed checks" << std::endl;
+    return failures;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+
+// Builds the vertex grid of snapping over clustered entities, moves entities into its overlay until the
+// scene would rebuild it and times nearest queries before and after. A share of the queries is checked
+// against a search over all vertices: the nearest distance, the excluded entity, radius queries and
+// that no moved entity is found where it was.
+class VertexGridTest
+{
+public:
+    // returns the number of failed checks
+    static size_t Run(size_t entitiesCount = 125000, size_t queriesCount = 10000, size_t checksCount = 500);
+};